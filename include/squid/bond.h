@@ -0,0 +1,31 @@
+#pragma once
+#include <stdint.h>
+#include "squid/snet.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bonded links.
+ *
+ * Several physical links to the same peer behind one squid_platform_t.
+ * Whole frames are spread round-robin over the member links, each with a
+ * one-byte bond sequence so the receiver can put them back in order and
+ * drop late duplicates.  A member that fails to send, or stays silent
+ * while the others deliver dead_frames envelopes, is taken out of
+ * rotation and probed now and then until it delivers again.
+ *
+ * Both peers must use a bond with the same number of members.  Hooks
+ * not related to the wire (get_tick, malloc, free) come from links[0].
+ */
+#define SQUID_BOND_MAX 4u
+
+int      squid_bond_init(const squid_platform_t *links, uint8_t n,
+                         uint8_t gap_ticks,   /* 0 = default (2) */
+                         uint8_t dead_frames, /* 0 = default (8) */
+                         squid_platform_t *out);
+uint8_t  squid_bond_links_up(void);           /* bit i set => member i up */
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,49 @@
+#pragma once
+#include <stdint.h>
+#include "squid/snet.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Multi-drop half-duplex bus (SNET_CFG_BUS), e.g. RS-485.
+ *
+ * One controller and up to 31 nodes share one line.  Every frame travels
+ * in an envelope whose header carries a node address, so each node sees
+ * only its own traffic.  The controller runs one engine per node (see
+ * snet_engine_use), and each of them keeps its own session, sequence and
+ * ACK state.  A node runs a single engine.
+ *
+ * Only the holder of the turn transmits.  The controller starts with it.
+ * It sends what its engines queued for any node, then grants the turn
+ * to the next node in rotation.  That node sends up to two frames and
+ * passes the turn back, with an empty envelope if it has nothing.  A
+ * node that does not answer within turn_ticks is skipped this round.
+ * One node is served per turn, so engine timeouts should cover a full
+ * round of every node.
+ *
+ * Bus envelopes hold 20-byte frames, so bus engines do not offer
+ * SNET_FEAT_LONG or SNET_FEAT_SHORT.  Hooks not related to the wire
+ * (get_tick, malloc, free) come from phys.  One bus per process (or
+ * thread with squid_mt), driven from one thread.
+ */
+#define SQUID_BUS_CONTROLLER 0u
+#define SQUID_BUS_ADDR_MAX   31u
+
+/* addr: SQUID_BUS_CONTROLLER or this node's address 1..31;
+ * turn_ticks: 0 = default (2) */
+int      squid_bus_init(const squid_platform_t *phys, uint8_t addr,
+                        uint8_t turn_ticks, squid_platform_t *out);
+
+/* controller: engine serving node addr; snet_init it with *out */
+int      squid_bus_attach(uint8_t addr, squid_engine_t *eng);
+
+/* move envelopes and turns; call from the main loop after snet_burst */
+void     squid_bus_poll(void);
+
+/* controller: bit a set => node a answered its last turn */
+uint32_t squid_bus_nodes_up(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,124 @@
+#pragma once
+
+/* Compile-time configuration.
+ *
+ * Set options with -D on the compiler command line, or collect them in
+ * a header named by SQUID_CONFIG_FILE (-DSQUID_CONFIG_FILE='"cfg.h"'),
+ * which is included first.  The library and the application must be
+ * built with the same settings.
+ *
+ * The basic frame (20 bytes, 15 payload) and the 5-byte short control
+ * frame (SNET_FEAT_SHORT) are fixed by the wire format.  Long DATA
+ * frames carry up to SNET_CFG_LONG payload bytes once both sides offer
+ * SNET_FEAT_LONG.
+ */
+#ifdef SQUID_CONFIG_FILE
+#include SQUID_CONFIG_FILE
+#endif
+
+/* sockets open at once, 1..255 (local fds 1..SNET_CFG_CHANNELS) */
+#ifndef SNET_CFG_CHANNELS
+#define SNET_CFG_CHANNELS     15
+#endif
+
+/* highest wire channel id, 15..255.  Ids above 14 take an extra byte
+ * per frame and need SNET_FEAT_XCH on both sides; 15 keeps the plain
+ * 4-bit channel field.  Sizes a byte table of SNET_CFG_CH_MAX + 1. */
+#ifndef SNET_CFG_CH_MAX
+#define SNET_CFG_CH_MAX       255
+#endif
+
+/* queue model:
+ *   0  heap: sockets and queued blocks come from the malloc/free hooks
+ *   1  static: sockets live in the engine context, each with a TX and
+ *      an RX ring of SNET_CFG_QUEUE_BYTES; malloc/free may be NULL */
+#ifndef SNET_CFG_STATIC
+#define SNET_CFG_STATIC       0
+#endif
+
+#ifndef SNET_CFG_QUEUE_BYTES
+#define SNET_CFG_QUEUE_BYTES  64
+#endif
+
+/* PING keepalive (squid_timing_t.ping_ticks); 0 drops the sender side,
+ * PINGs from the peer are still answered */
+#ifndef SNET_CFG_KEEPALIVE
+#define SNET_CFG_KEEPALIVE    1
+#endif
+
+/* round-robin over channels with queued data; 0 serves the open
+ * sockets in list order (newest first) */
+#ifndef SNET_CFG_RR
+#define SNET_CFG_RR           1
+#endif
+
+/* stream sources and sinks (squid_stream_send/recv) */
+#ifndef SNET_CFG_STREAM
+#define SNET_CFG_STREAM       1
+#endif
+
+/* bytes buffered between snet_rx_isr_push() and _rx, power of 2 up to
+ * 128; 0 = receive through recv_char only */
+#ifndef SNET_CFG_ISR_RING
+#define SNET_CFG_ISR_RING     0
+#endif
+
+/* largest payload of a long DATA frame (SNET_FEAT_LONG), 16..240;
+ * 0 = short frames only.  Sizes rx_buf and last_sent. */
+#ifndef SNET_CFG_LONG
+#define SNET_CFG_LONG         120
+#endif
+
+/* in-frame Reed-Solomon FEC, offered with SNET_FEAT_FEC (fec.c, 0.5 KB
+ * of tables) */
+#ifndef SNET_CFG_FEC
+#define SNET_CFG_FEC          1
+#endif
+
+/* RPC layer (squid/rpc.h): calls in flight per squid_rpc_t, and the
+ * largest request or response payload; both size caller storage */
+#ifndef SNET_CFG_RPC_SLOTS
+#define SNET_CFG_RPC_SLOTS    8
+#endif
+
+#ifndef SNET_CFG_RPC_MAX
+#define SNET_CFG_RPC_MAX      128
+#endif
+
+/* multi-drop bus (squid/bus.h): nodes a controller serves, up to 31;
+ * 1 is enough on a node, 0 = no bus mode */
+#ifndef SNET_CFG_BUS
+#define SNET_CFG_BUS          16
+#endif
+
+/* latency histograms for snet_burst, RX, TX, send and recv, timed with
+ * a clock the application installs (snet_prof_clock) */
+#ifndef SNET_CFG_PROFILE
+#define SNET_CFG_PROFILE      0
+#endif
+
+#if SNET_CFG_LONG != 0 && (SNET_CFG_LONG < 16 || SNET_CFG_LONG > 240)
+#error "SNET_CFG_LONG must be 0 or 16..240"
+#endif
+
+#if SNET_CFG_ISR_RING != 0 && \
+    (SNET_CFG_ISR_RING > 128 || (SNET_CFG_ISR_RING & (SNET_CFG_ISR_RING - 1)))
+#error "SNET_CFG_ISR_RING must be 0 or a power of 2 up to 128"
+#endif
+
+#if SNET_CFG_CHANNELS < 1 || SNET_CFG_CHANNELS > 255
+#error "SNET_CFG_CHANNELS must be 1..255"
+#endif
+
+#if SNET_CFG_RPC_SLOTS < 1 || SNET_CFG_RPC_SLOTS > 255 || \
+    SNET_CFG_RPC_MAX < 1 || SNET_CFG_RPC_MAX > 65000
+#error "SNET_CFG_RPC_SLOTS must be 1..255, SNET_CFG_RPC_MAX 1..65000"
+#endif
+
+#if SNET_CFG_BUS < 0 || SNET_CFG_BUS > 31
+#error "SNET_CFG_BUS must be 0..31"
+#endif
+
+#if SNET_CFG_CH_MAX < 15 || SNET_CFG_CH_MAX > 255
+#error "SNET_CFG_CH_MAX must be 15..255"
+#endif
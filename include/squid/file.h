@@ -0,0 +1,49 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "squid/socket.h"
+
+/* Host-side stream callbacks for squid_stream_send/recv (POSIX).
+ *
+ *   int fd = open("disk.img", O_RDONLY);
+ *   squid_stream_send(s, squid_file_read, &fd, resume_at, size);
+ *
+ * File callbacks take a pointer to the file descriptor as ctx and use
+ * pread/pwrite at the stream offset, so a resumed transfer needs no
+ * seeking.  squid_mem_read serves a memory region (e.g. an mmap of the
+ * file); ctx is its base address.  Strict -std=c99 builds need
+ * _XOPEN_SOURCE 700 (or similar) defined for pread/pwrite.
+ */
+static inline int squid_file_read(void *ctx, uint32_t off,
+                                  uint8_t *buf, uint16_t max)
+{
+    ssize_t n;
+    do n = pread(*(int*)ctx, buf, max, (off_t)off);
+    while (n < 0 && errno == EINTR);
+    return n > 0 ? (int)n : -1;         /* EOF before end is an error too */
+}
+
+static inline int squid_file_write(void *ctx, uint32_t off,
+                                   const uint8_t *buf, uint16_t len)
+{
+    while (len) {
+        ssize_t n = pwrite(*(int*)ctx, buf, len, (off_t)off);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        buf += n;
+        off += (uint32_t)n;
+        len  = (uint16_t)(len - n);
+    }
+    return 0;
+}
+
+static inline int squid_mem_read(void *ctx, uint32_t off,
+                                 uint8_t *buf, uint16_t max)
+{
+    memcpy(buf, (const uint8_t*)ctx + off, max);
+    return max;
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <stdint.h>
+#include "squid/socket.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Request/response RPC over one socket.
+ *
+ * Each message is a 6-byte header and up to SNET_CFG_RPC_MAX payload
+ * bytes, queued as one block:
+ *
+ *   request   ['Q'][id lo][id hi][method][len lo][len hi][payload]
+ *   response  ['R'][id lo][id hi][status][len lo][len hi][payload]
+ *
+ * A caller may have SNET_CFG_RPC_SLOTS requests in flight; responses
+ * are matched by id, so they complete in any order.  Both sides call
+ * squid_rpc_poll() from the main loop (after snet_burst): it reads what
+ * has arrived, runs the done and serve callbacks, and expires calls
+ * whose deadline passed.  Times are in any unit the application likes,
+ * as long as now and the timeouts agree; they wrap like the tick.
+ *
+ * A server gets each request in its serve callback and answers with
+ * squid_rpc_reply(), then or later: requests may be answered out of
+ * order.  Without a serve callback requests get SQUID_RPC_ST_NOMETHOD.
+ *
+ * The state lives in caller storage and only uses the socket API, so
+ * it works with any engine; poll it with its engine current.
+ */
+#define SQUID_RPC_HDR           6u
+
+/* status byte in a response; 0..0xEF are the application's */
+#define SQUID_RPC_ST_OK         0x00u
+#define SQUID_RPC_ST_NOMETHOD   0xFEu   /* no server, or method unknown */
+#define SQUID_RPC_ST_TOOBIG     0xFFu   /* request over SNET_CFG_RPC_MAX */
+
+/* local completions, not on the wire */
+#define SQUID_RPC_TIMEOUT       (-1)    /* no response before the deadline */
+
+typedef struct squid_rpc squid_rpc_t;
+
+/* response or timeout for call id: status is a SQUID_RPC_ST_* byte or
+ * SQUID_RPC_TIMEOUT; data is valid during the call only */
+typedef void (*squid_rpc_done_fn)(squid_rpc_t *r, uint16_t id, int status,
+                                  const uint8_t *data, uint16_t len, void *arg);
+
+/* request id to answer with squid_rpc_reply(), now or later */
+typedef void (*squid_rpc_serve_fn)(squid_rpc_t *r, uint16_t id, uint8_t method,
+                                   const uint8_t *data, uint16_t len, void *arg);
+
+typedef struct {
+    uint16_t          id;           /* 0 = free */
+    uint32_t          deadline;
+    uint8_t           timed;        /* 0 = no deadline */
+    squid_rpc_done_fn done;
+    void             *arg;
+} squid_rpc_call_t;
+
+struct squid_rpc {
+    int                fd;
+    uint16_t           last_id;
+    squid_rpc_call_t   call[SNET_CFG_RPC_SLOTS];
+    squid_rpc_serve_fn serve;
+    void              *serve_arg;
+    uint8_t            in[SQUID_RPC_HDR + SNET_CFG_RPC_MAX];
+    uint16_t           in_len;      /* bytes of the current message */
+    uint16_t           skip;        /* payload bytes still to discard */
+};
+
+void squid_rpc_init(squid_rpc_t *r, int fd);   /* fd bound/connected */
+void squid_rpc_serve(squid_rpc_t *r, squid_rpc_serve_fn fn, void *arg);
+
+/* queue a request; returns its id (1..65535), SQUID_EAGAIN when the
+ * socket is full, or -1 (no free slot, too long, bad socket) */
+int  squid_rpc_call(squid_rpc_t *r, uint8_t method,
+                    const uint8_t *data, uint16_t len,
+                    uint32_t now, uint32_t timeout,
+                    squid_rpc_done_fn done, void *arg);
+
+/* answer request id; SQUID_EAGAIN when the socket is full (try again
+ * later with the same id), -1 on error */
+int  squid_rpc_reply(squid_rpc_t *r, uint16_t id, uint8_t status,
+                     const uint8_t *data, uint16_t len);
+
+/* drop a call without its callback (its response is ignored) */
+void squid_rpc_cancel(squid_rpc_t *r, uint16_t id);
+
+/* read, dispatch and expire; returns the calls still in flight */
+int  squid_rpc_poll(squid_rpc_t *r, uint32_t now);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,34 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "squid/snet.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Shared-memory link for peers on one host (Linux, library squid_shm).
+ *
+ * Both processes open the same name.  The first creates the segment, the
+ * second joins it; each direction is a lock-free single-producer ring,
+ * so send_char/recv_char are plain memory accesses instead of syscalls.
+ * A reader with nothing to do sleeps in squid_shm_wait() on a futex that
+ * the writer wakes at the end of a frame.
+ *
+ * squid_shm_feed() hands all pending bytes to snet_feed() in at most two
+ * runs; recv_char is then not needed but still works.  Hooks not related
+ * to the wire (get_tick, malloc, free) come from base.  One link per
+ * process.
+ */
+#define SQUID_SHM_RING 65536u   /* bytes per direction, power of 2 */
+
+int     squid_shm_open(const char *name, const squid_platform_t *base,
+                       squid_platform_t *out);  /* 0 = created, 1 = joined, -1 */
+void    squid_shm_close(void);                  /* creator also unlinks */
+int     squid_shm_unlink(const char *name);     /* remove a stale segment */
+size_t  squid_shm_feed(void);                   /* bytes handed to snet_feed */
+int     squid_shm_wait(int timeout_ms);         /* 1 = input pending, 0 = timeout */
+
+#ifdef __cplusplus
+}
+#endif
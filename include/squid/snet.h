@@ -1,6 +1,8 @@
 #pragma once
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include "squid/config.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -8,8 +10,10 @@ extern "C" {
 
 /* Platform hooks (required). */
 typedef struct {
-    int     (*send_char)(uint8_t c); /* return 0 on success */
-    int     (*recv_char)(void);      /* return next byte, or -1 if none */
+    int     (*send_char)(uint8_t c); /* return 0 on success, non-zero = no
+                                        room: offered again next burst */
+    int     (*recv_char)(void);      /* return next byte, or -1 if none;
+                                        may be NULL with SNET_CFG_ISR_RING */
     uint8_t (*get_tick)(void);       /* 8-bit tick counter (wraps) */
     void*   (*malloc)(uint16_t n);
     void    (*free)(void* p);
@@ -27,10 +31,115 @@ typedef struct {
 typedef squid_platform_t snet_platform_t;
 typedef squid_timing_t   snet_timing_t;
 
+/* Optional protocol features.  Each side offers a set in HELLO; the
+ * active set is the intersection, so a peer that offers nothing (or an
+ * older peer) keeps the plain protocol. */
+#define SNET_FEAT_PACK   0x01u  /* pack several channels into one DATA frame */
+#define SNET_FEAT_RESUME 0x02u  /* keep seq state + unacked frame across HELLO */
+#define SNET_FEAT_FEC    0x04u  /* RS parity in DATA/ACK/PING: 2 bad bytes repaired,
+                                   11-byte payload (SNET_CFG_FEC) */
+#define SNET_FEAT_LONG   0x08u  /* DATA frames grow up to SNET_CFG_LONG bytes of
+                                   payload on a clean line (not over a bond) */
+#define SNET_FEAT_XCH    0x10u  /* channel ids 15..SNET_CFG_CH_MAX, one extra
+                                   byte per frame or pack record */
+#define SNET_FEAT_SHORT  0x20u  /* ACK and PING as 5-byte frames (not over
+                                   a bond) */
+
 /* Engine control (low-level). */
 void     snet_init(const squid_platform_t *plat, const squid_timing_t *tm);
 void     snet_burst(void);              /* process at most one RX and one TX */
 bool     snet_link_is_up(void);
+bool     snet_idle(void);               /* no timer running: poll may sleep */
+void     snet_set_features(uint8_t feat); /* offer; call after snet_init */
+uint8_t  snet_features(void);             /* negotiated set while link is up */
+uint8_t  snet_tx_payload(void);           /* DATA payload limit in use now */
+
+/* Transmit pacing.  rate: bytes per tick this side can take, 0 = no
+ * limit; gap: idle ticks it needs between two frames.  Both are offered
+ * in HELLO, and each side then sends at the lower rate and the longer
+ * gap of the two settings.  Frames are paced whole: a frame starts once
+ * the rate allows and the gap has passed, so keep the gap well below
+ * the peer's timeout_ticks.  Call after snet_init. */
+void     snet_set_pace(uint8_t rate, uint8_t gap);
+
+/* Buffered receive.  Decodes every frame in data in one pass, plus a
+ * frame left partial by the previous call or by recv_char; a trailing
+ * partial frame is kept for the next call.  Use it instead of feeding
+ * bytes through recv_char, then call snet_burst() to transmit. */
+void     snet_feed(const uint8_t *data, size_t len);
+
+#if SNET_CFG_ISR_RING
+/* Interrupt-driven receive (SNET_CFG_ISR_RING).
+ *
+ * Call from the UART receive interrupt with each byte; snet_burst()
+ * drains the ring before asking recv_char.  One producer (the ISR) and
+ * one consumer (the main loop) share it without locks, so the main loop
+ * may be busy for SNET_CFG_ISR_RING byte times without an overrun.
+ * Returns 0, or -1 when the ring is full (the byte is lost like line
+ * noise).  Bytes go to the current engine: call snet_init() before
+ * enabling the interrupt and do not switch engines while it is on.
+ */
+int      snet_rx_isr_push(uint8_t c);
+#endif
+
+/* Interrupt- or DMA-driven transmit.
+ *
+ * With a TX callback installed the engine stops calling send_char.  It
+ * calls fn (from snet_burst) each time a frame is ready; the driver
+ * enables its TX-empty interrupt or starts DMA and takes the bytes with
+ * snet_tx_pull(), which returns the next one or -1 once the frame is
+ * out.  The next frame is built only after that.  snet_tx_pull() is
+ * safe from an interrupt against the main loop.  Install after
+ * snet_init(); NULL returns to send_char.
+ */
+void     snet_on_tx_ready(void (*fn)(void));
+int      snet_tx_pull(void);
+
+/* Engine instances.
+ *
+ * Engine and socket calls act on the current engine, by default one
+ * built-in instance.  snet_engine_use() makes caller storage of
+ * snet_engine_size() bytes current (zero it before its snet_init);
+ * NULL selects the built-in one again.  In the default library a
+ * switch copies the context, and an engine's storage is only up to
+ * date while it is not current.  The squid_mt library keeps the
+ * selection per thread without copying, so threads can run engines in
+ * parallel; an engine may move between threads but must not be used
+ * by two at once.
+ */
+typedef struct snet_ctx squid_engine_t;
+
+size_t          snet_engine_size(void);
+void            snet_engine_use(squid_engine_t *eng);
+squid_engine_t *snet_engine_current(void);  /* NULL = built-in */
+
+#if SNET_CFG_PROFILE
+/* Profiling (SNET_CFG_PROFILE).
+ *
+ * With a clock installed, each probe adds its duration to a log2
+ * histogram of the current engine.  The clock can count cycles, timer
+ * ticks or nanoseconds; it only has to be monotonic modulo 2^32.
+ * Install it after snet_init(); NULL stops timing (one test per probe).
+ * p99 is the upper edge of the bucket holding the 99th percentile,
+ * capped at max.
+ */
+#define SNET_PROF_BURST   0u    /* snet_burst() */
+#define SNET_PROF_RX      1u    /* one RX step inside it */
+#define SNET_PROF_TX      2u    /* one TX step inside it */
+#define SNET_PROF_SEND    3u    /* squid_send/sendv */
+#define SNET_PROF_RECV    4u    /* squid_recv/recvv */
+#define SNET_PROF_N       5u
+
+typedef struct {
+    uint32_t count;
+    uint32_t max;
+    uint32_t p99;
+} snet_prof_stat_t;
+
+void     snet_prof_clock(uint32_t (*now)(void));
+int      snet_prof_get(uint8_t probe, snet_prof_stat_t *st);
+void     snet_prof_reset(void);
+#endif
 
 #ifdef __cplusplus
 }
@@ -1,5 +1,6 @@
 #pragma once
 #include <stdint.h>
+#include "squid/config.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -8,17 +9,128 @@ extern "C" {
 /* Multiplexed socket API.
  *
  * squid_open() returns a local handle (fd-like). You then bind/connect
- * that socket to a wire channel (1..15), which acts like a "port".
+ * that socket to a wire channel (1..SNET_CFG_CH_MAX), which acts like a
+ * "port".
  *
  * Received blocks are queued per bound socket and copied out on recv.
+ *
+ * A channel is bound by one socket, or subscribed by any number: every
+ * subscriber receives every payload that arrives after it subscribed,
+ * through its own read position.  On the heap model each payload is
+ * stored once and freed when the last subscriber has read it.  DATA is
+ * accepted only when every subscriber has room (RXCAP, ring), so the
+ * slowest reader paces the channel.  All of them may send.  Subscribing
+ * drops what the socket had queued; closing or rebinding a subscriber
+ * drops its unread share.  A stream sink cannot be attached to one.
  */
-int      squid_open(void);              /* returns fd 1..15, or -1 */
+#define  SQUID_EAGAIN  (-2)   /* send would exceed a cap or the budget */
+
+int      squid_open(void);              /* fd 1..SNET_CFG_CHANNELS, or -1 */
 int      squid_bind(int fd, uint8_t ch);
 int      squid_connect(int fd, uint8_t ch);
+int      squid_subscribe(int fd, uint8_t ch);
 void     squid_close(int fd);
 int      squid_send(int fd, const uint8_t *data, uint16_t len);
 int      squid_recv(int fd, uint8_t *buf, uint16_t max);
 
+/* Scatter/gather I/O.
+ *
+ * squid_sendv() gathers all segments straight into one queued block, so
+ * the whole message is accepted or rejected as a unit (tx_cap included).
+ * squid_recvv() scatters queued RX bytes across the segments in order;
+ * the segment lengths may add up past 64 KB.  Both return the total
+ * byte count, or -1.
+ */
+typedef struct {
+    uint8_t *base;
+    uint16_t len;
+} squid_iovec_t;
+
+int      squid_sendv(int fd, const squid_iovec_t *iov, uint8_t cnt);
+int      squid_recvv(int fd, const squid_iovec_t *iov, uint8_t cnt);
+
+/* Delivery-confirmed sends.
+ *
+ * Every byte queued on a socket has an offset; the ticket of a send is
+ * the offset just past its last byte.  A ticket is delivered once the
+ * peer has ACKed the DATA frame carrying that byte, so all earlier
+ * tickets are delivered too.  The delivered callback runs (from
+ * snet_burst) when the delivered offset advances while a confirmed send
+ * is open, and when open bytes are lost.  Bytes are lost only when a new,
+ * not resumed, session drops the DATA frame that was in flight; tickets
+ * that may cover those bytes report -1.  After several losses, every
+ * ticket from the first loss to the last reports -1, so a lost ticket
+ * never reads as delivered.
+ */
+typedef void (*squid_delivered_fn)(int fd, uint32_t delivered, void *arg);
+
+int      squid_send_confirmed(int fd, const uint8_t *data, uint16_t len,
+                              uint32_t *ticket);
+int      squid_delivered(int fd, uint32_t ticket); /* 1 yes, 0 not yet, -1 lost */
+void     squid_on_delivered(squid_delivered_fn fn, void *arg);
+
+/* Socket options and memory limits.
+ *
+ * A send that does not fit under TXCAP, in a static ring or under the
+ * budget returns SQUID_EAGAIN and queues nothing.  Once the TX queue is
+ * at or below TXLOWAT and the same send would fit, the writable callback
+ * runs (from snet_burst) for that socket.  A send that could never fit
+ * (longer than TXCAP, the ring or the budget) returns -1.
+ *
+ * The budget bounds all queued bytes of the engine, TX and RX, block
+ * headers included (squid_mem_used).  Received DATA that would go over
+ * it is answered "busy", like RXCAP.
+ */
+#define  SQUID_SO_TXCAP     1   /* TX queue limit in bytes, 0 = none */
+#define  SQUID_SO_RXCAP     2   /* RX queue limit ("busy" above), 0 = none */
+#define  SQUID_SO_TXLOWAT   3   /* writable once the TX queue is <= this */
+#define  SQUID_SO_TXQUEUED  4   /* bytes in the TX queue (read-only) */
+#define  SQUID_SO_RXQUEUED  5   /* bytes in the RX queue (read-only) */
+
+int      squid_setsockopt(int fd, int opt, uint16_t val);
+int      squid_getsockopt(int fd, int opt, uint16_t *val);
+
+typedef void (*squid_writable_fn)(int fd, void *arg);
+void     squid_on_writable(squid_writable_fn fn, void *arg);
+void     squid_set_budget(uint32_t bytes);      /* 0 = unlimited */
+uint32_t squid_mem_used(void);
+
+/* Streams (SNET_CFG_STREAM).
+ *
+ * A source is read on demand: whenever the socket's TX queue is empty
+ * and a DATA frame has room, the engine asks for the bytes at `off`.
+ * A file of any size goes out without being queued.  It should return
+ * 1..max bytes, or -1, which stops the stream.
+ *
+ * A sink gets each received payload at its stream offset instead of the
+ * RX queue.  It returns 0, or -1, which stops the sink (later payloads
+ * go to the RX queue).
+ *
+ * The sender's acked offset counts bytes the peer has taken.  That is the
+ * checkpoint to keep.  The receiver's written offset is at most one frame
+ * ahead of it (a DATA whose ACK was lost).  Resuming a transfer means
+ * restarting both ends from the receiver's offset.  A new (not resumed)
+ * session after the transfer started stops the source: the peer's
+ * position is unknown, so squid_stream_pos() reports -1 until the app
+ * restarts it.
+ */
+#if SNET_CFG_STREAM
+typedef int (*squid_read_fn)(void *ctx, uint32_t off, uint8_t *buf, uint16_t max);
+typedef int (*squid_write_fn)(void *ctx, uint32_t off, const uint8_t *buf, uint16_t len);
+
+/* stream [off, end) from rd; rd == NULL detaches */
+int      squid_stream_send(int fd, squid_read_fn rd, void *ctx,
+                           uint32_t off, uint32_t end);
+/* raise the end of a running source (data appended since); never lower */
+int      squid_stream_extend(int fd, uint32_t end);
+/* hand payloads to wr, first one at off; wr == NULL detaches */
+int      squid_stream_recv(int fd, squid_write_fn wr, void *ctx, uint32_t off);
+/* acked (TX) and written (RX) offsets; either pointer may be NULL.
+ * Returns 1 while the source has bytes not yet acked, 0 when idle or
+ * done, -1 for a bad fd or a stopped source or sink. */
+int      squid_stream_pos(int fd, uint32_t *acked, uint32_t *written);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
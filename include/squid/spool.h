@@ -0,0 +1,64 @@
+#pragma once
+#include <stdint.h>
+#include "squid/socket.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Disk-backed TX spool for one socket (POSIX, library squid_spool).
+ *
+ * Writes go to a memory-mapped file instead of the TX queue, so a long
+ * outage costs disk, not heap, and a restarted process finds its backlog
+ * where it left it.  The file is a fixed-size ring: a 64-byte header with
+ * the oldest unACKed position (head) and the append position (tail),
+ * then `capacity` data bytes.  The socket streams the ring as a stream
+ * source (SNET_CFG_STREAM), so DATA frames read straight from the
+ * mapping, and squid_spool_poll() moves head past what the peer ACKed,
+ * making room for new writes.
+ *
+ *   squid_spool_t sp;
+ *   squid_spool_open(&sp, "/var/spool/log.sq", 1u << 24);
+ *   squid_spool_attach(&sp, fd);           // fd connected
+ *   ...
+ *   squid_spool_write(&sp, rec, len);      // instead of squid_send
+ *   snet_burst();
+ *   squid_spool_poll(&sp);
+ *
+ * Delivery is at least once: after a new (not resumed) session the
+ * spool resends from head, which may repeat the last frame the peer took
+ * before its ACK was lost.  Head and tail are stored in the mapping, so
+ * they survive a process crash; squid_spool_sync() (and close) flushes
+ * them to disk for power loss.
+ */
+#define SQUID_SPOOL_HDR 64u
+
+typedef struct {
+    int       file;                 /* open descriptor, -1 = closed */
+    uint8_t  *map;                  /* header, then the data ring */
+    uint32_t  cap;                  /* data bytes */
+    int       fd;                   /* socket, 0 = not attached */
+    uint32_t  base;                 /* ring position of stream offset 0 */
+    uint32_t  end;                  /* stream end handed to the engine */
+} squid_spool_t;
+
+/* create (capacity bytes) or reopen an existing spool; a reopened file
+ * keeps its own capacity and backlog.  0 = ok, -1 = error (errno). */
+int      squid_spool_open(squid_spool_t *sp, const char *path, uint32_t capacity);
+void     squid_spool_close(squid_spool_t *sp);      /* syncs, unmaps */
+int      squid_spool_sync(squid_spool_t *sp);
+
+/* stream the backlog on socket fd, oldest unACKed byte first */
+int      squid_spool_attach(squid_spool_t *sp, int fd);
+
+/* append; len bytes or SQUID_EAGAIN when the ring is full (poll after
+ * ACKs frees room), -1 when len can never fit */
+int      squid_spool_write(squid_spool_t *sp, const uint8_t *data, uint32_t len);
+
+/* after snet_burst(): release ACKed bytes, hand new ones to the engine,
+ * restart after a lost session.  Returns bytes not yet ACKed, or -1. */
+int32_t  squid_spool_poll(squid_spool_t *sp);
+
+#ifdef __cplusplus
+}
+#endif
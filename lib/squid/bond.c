@@ -0,0 +1,223 @@
+/* lib/squid/bond.c – several physical links behind one platform. */
+#include "internal.h"
+#include "squid/bond.h"
+
+/* bonded link context (single instance) */
+SNET_TLS snet_bond_t g_bond;
+
+#define BOND_PROBE_EVERY 16u    /* frames between probes of a down member */
+#define BOND_STALE_MAX   4u     /* old envelopes in a row => peer restarted */
+
+static uint8_t _now(void)
+{
+    return g_bond.links[0].get_tick();
+}
+
+/* ---- finish the envelope a refused byte cut short on member i ---- */
+static int _flush(uint8_t i)
+{
+    snet_bond_link_t *m = &g_bond.link[i];
+    while (m->tx_left) {
+        if (g_bond.links[i].send_char(m->tx_buf[SNET_BOND_ENV - m->tx_left]) != 0)
+            return -1;
+        m->tx_left--;
+    }
+    return 0;
+}
+
+/* ---- send one envelope on member i; 0 on success.  The peer splits a
+ * member's bytes into envelopes by count, so after a refused byte the
+ * rest is kept and sent before anything else on that member ---- */
+static int _put_env(uint8_t i)
+{
+    snet_bond_link_t *m = &g_bond.link[i];
+    if (_flush(i) != 0) return -1;
+    for (uint8_t k = 0; k < SNET_BOND_ENV; k++) {
+        if (g_bond.links[i].send_char(g_bond.tx_env[k]) == 0) continue;
+        if (k) {
+            memcpy(m->tx_buf, g_bond.tx_env, SNET_BOND_ENV);
+            m->tx_left = (uint8_t)(SNET_BOND_ENV - k);
+        }
+        return -1;
+    }
+    return 0;
+}
+
+/* ---- dispatch the assembled envelope ---- */
+static void _dispatch(void)
+{
+    uint8_t sent = 0;
+    for (uint8_t i = 0; i < g_bond.n; i++)
+        if (g_bond.link[i].tx_left) (void)_flush(i);
+    for (uint8_t k = 1; k <= g_bond.n && !sent; k++) {
+        uint8_t i = (uint8_t)((g_bond.tx_rr + k) % g_bond.n);
+        if (!g_bond.link[i].up) continue;
+        if (_put_env(i) == 0) { g_bond.tx_rr = i; sent = 1; }
+        else g_bond.link[i].up = 0u;
+    }
+
+    /* probe a down member with a copy; duplicates are dropped by bseq */
+    if (++g_bond.tx_count >= BOND_PROBE_EVERY || !sent) {
+        g_bond.tx_count = 0;
+        for (uint8_t i = 0; i < g_bond.n; i++)
+            if (!g_bond.link[i].up) (void)_put_env(i);
+    }
+    g_bond.tx_seq++;
+}
+
+static int _bond_send(uint8_t c)
+{
+    if (g_bond.tx_pos == 0) g_bond.tx_env[g_bond.tx_pos++] = g_bond.tx_seq;
+    g_bond.tx_env[g_bond.tx_pos++] = c;
+    if (g_bond.tx_pos >= SNET_BOND_ENV) {
+        g_bond.tx_pos = 0;
+        _dispatch();
+    }
+    return 0;   /* a frame no member could take is lost like line noise */
+}
+
+/* ---- place a received envelope into the reorder window ---- */
+static void _hold(const uint8_t *env)
+{
+    uint8_t seq = env[0];
+    if (!g_bond.rx_synced) {
+        g_bond.rx_synced = 1u;
+        g_bond.rx_next = seq;
+    }
+
+    uint8_t d = (uint8_t)(seq - g_bond.rx_next);
+    if (d >= 0x80u) {                   /* late duplicate or old frame */
+        if (++g_bond.rx_stale < BOND_STALE_MAX) return;
+        g_bond.hold_mask = 0u;          /* peer bond restarted: resync */
+        g_bond.rx_next = seq;
+        d = 0;
+    } else if (d >= SNET_BOND_WIN) {    /* lost too much: jump ahead */
+        g_bond.hold_mask = 0u;
+        g_bond.rx_next = seq;
+        d = 0;
+    }
+    g_bond.rx_stale = 0u;
+
+    uint8_t slot = (uint8_t)(seq & (SNET_BOND_WIN - 1u));
+    if (g_bond.hold_mask & (1u << slot)) return;    /* duplicate */
+    if (!g_bond.hold_mask) g_bond.hold_tick = _now();
+    memcpy(g_bond.hold[slot], &env[1], SNET_FRAME_BYTES);
+    g_bond.hold_seq[slot] = seq;
+    g_bond.hold_mask |= (uint8_t)(1u << slot);
+}
+
+/* ---- move the next in-order frame to out[]; skip a gap on timeout ---- */
+static bool _release(void)
+{
+    if (!g_bond.hold_mask) return false;
+
+    uint8_t slot = (uint8_t)(g_bond.rx_next & (SNET_BOND_WIN - 1u));
+    if (!(g_bond.hold_mask & (1u << slot))) {
+        if ((uint8_t)(_now() - g_bond.hold_tick) < g_bond.gap_ticks)
+            return false;
+        /* the missing frame is lost: continue at the oldest held one */
+        for (uint8_t d = 1; d < SNET_BOND_WIN; d++) {
+            slot = (uint8_t)((g_bond.rx_next + d) & (SNET_BOND_WIN - 1u));
+            if (g_bond.hold_mask & (1u << slot)) {
+                g_bond.rx_next = (uint8_t)(g_bond.rx_next + d);
+                break;
+            }
+        }
+    }
+
+    memcpy(g_bond.out, g_bond.hold[slot], SNET_FRAME_BYTES);
+    g_bond.out_pos = 0;
+    g_bond.out_len = SNET_FRAME_BYTES;
+    g_bond.hold_mask &= (uint8_t)~(1u << slot);
+    g_bond.rx_next++;
+    g_bond.hold_tick = _now();          /* next gap starts now */
+    return true;
+}
+
+/* ---- members silent while another one talks go out of rotation ---- */
+static void _count_silence(uint8_t from)
+{
+    for (uint8_t i = 0; i < g_bond.n; i++) {
+        snet_bond_link_t *m = &g_bond.link[i];
+        if (i == from || m->missed >= g_bond.dead_frames) continue;
+        if (++m->missed >= g_bond.dead_frames) m->up = 0u;
+    }
+}
+
+/* ---- read member bytes until one envelope completes ---- */
+static bool _poll_links(void)
+{
+    for (uint8_t i = 0; i < g_bond.n; i++) {
+        snet_bond_link_t *m = &g_bond.link[i];
+        int b;
+        while ((b = g_bond.links[i].recv_char()) >= 0) {
+            uint8_t c = (uint8_t)b;
+            if (m->pos == 1 && c != SNET_STX) {
+                m->buf[0] = c;          /* not a frame start: new BSEQ */
+                continue;
+            }
+            m->buf[m->pos++] = c;
+            if (m->pos < SNET_BOND_ENV) continue;
+
+            m->pos = 0;
+            m->up = 1u;
+            m->missed = 0u;
+            _count_silence(i);
+            _hold(m->buf);
+            return true;
+        }
+    }
+    return false;
+}
+
+static int _bond_recv(void)
+{
+    for (;;) {
+        if (g_bond.out_pos < g_bond.out_len) return g_bond.out[g_bond.out_pos++];
+        if (_release()) continue;
+        if (!_poll_links()) return -1;
+    }
+}
+
+static uint8_t _bond_tick(void)         { return _now(); }
+static void   *_bond_malloc(uint16_t n) { return g_bond.links[0].malloc(n); }
+static void    _bond_free(void *p)      { g_bond.links[0].free(p); }
+
+int squid_bond_init(const squid_platform_t *links, uint8_t n,
+                    uint8_t gap_ticks, uint8_t dead_frames,
+                    squid_platform_t *out)
+{
+    if (!links || !out || n == 0 || n > SNET_BOND_MAX) return -1;
+    for (uint8_t i = 0; i < n; i++)
+        if (!links[i].send_char || !links[i].recv_char) return -1;
+    if (!links[0].get_tick) return -1;
+    if (!SNET_CFG_STATIC && (!links[0].malloc || !links[0].free)) return -1;
+
+    memset(&g_bond, 0, sizeof(g_bond));
+    g_bond.links       = links;
+    g_bond.n           = n;
+    g_bond.gap_ticks   = gap_ticks ? gap_ticks : 2u;
+    g_bond.dead_frames = dead_frames ? dead_frames : 8u;
+    for (uint8_t i = 0; i < n; i++) g_bond.link[i].up = 1u;
+    g_bond.tx_rr = (uint8_t)(n - 1u);   /* first frame goes to member 0 */
+
+    out->send_char = _bond_send;
+    out->recv_char = _bond_recv;
+    out->get_tick  = _bond_tick;
+    out->malloc    = _bond_malloc;
+    out->free      = _bond_free;
+    return 0;
+}
+
+bool snet_bond_carries(const snet_platform_t *p)
+{
+    return p && p->send_char == _bond_send;
+}
+
+uint8_t squid_bond_links_up(void)
+{
+    uint8_t mask = 0;
+    for (uint8_t i = 0; i < g_bond.n; i++)
+        if (g_bond.link[i].up) mask |= (uint8_t)(1u << i);
+    return mask;
+}
@@ -0,0 +1,110 @@
+/* lib/squid/bulk.c – buffered receive: every frame in a buffer per call.
+ *
+ * Hosts read many frames per syscall.  Instead of one recv_char call and
+ * state check per byte, candidates are found with memchr (word-wide or
+ * SIMD in any serious libc), checked for ETX and hashed over 64-bit
+ * words, and handled in place.  Only a frame split across calls goes
+ * through rx_buf.  Long DATA frames are sized from their header and
+ * checked by CRC instead.
+ */
+#include "internal.h"
+
+#define F_HSH   (SNET_FRAME_BYTES - 2)
+#define F_ETX   (SNET_FRAME_BYTES - 1)
+
+/* XOR of bytes 1..17: two unaligned 64-bit loads, folded, + byte 17 */
+static uint8_t _hash64(const uint8_t *f)
+{
+    uint64_t a, b;
+    memcpy(&a, f + 1, sizeof(a));
+    memcpy(&b, f + 9, sizeof(b));
+    a ^= b;
+    a ^= a >> 32;
+    a ^= a >> 16;
+    a ^= a >> 8;
+    return (uint8_t)((uint8_t)a ^ f[F_HSH - 1]);
+}
+
+static bool _plain_ok(const uint8_t *f)
+{
+    return f[F_ETX] == SNET_ETX && _hash64(f) == f[F_HSH];
+}
+
+/* frame to handle (coded frames may come back repaired in rx_buf) */
+static const uint8_t *_check(const uint8_t *f, uint8_t size)
+{
+    if (size == SNET_SHORT_BYTES)
+        return snet_short_ok(f) ? f : (const uint8_t*)0;
+#if SNET_CFG_LONG
+    if (size != SNET_FRAME_BYTES)
+        return snet_long_ok(f, size) ? f : (const uint8_t*)0;
+#else
+    (void)size;
+#endif
+#if SNET_CFG_FEC
+    if (SNET_FEC_ON()) return snet_fec_rx(f, _plain_ok(f));
+#endif
+    return _plain_ok(f) ? f : (const uint8_t*)0;
+}
+
+static const uint8_t *_valid(const uint8_t *f, uint8_t size)
+{
+    const uint8_t *ok = (size == SNET_SIZE_BAD) ? (const uint8_t*)0 : _check(f, size);
+    if (!ok) snet_line_error();
+    return ok;
+}
+
+void snet_feed(const uint8_t *data, size_t len)
+{
+    if (!g_snet.plat || !data) return;
+    const uint8_t *p = data, *end = data + len;
+
+    /* finish a frame begun earlier (rx_buf[0] is STX) */
+    if (g_snet.rx_pos) {
+        const uint8_t *q = p;
+        uint8_t size;
+        while (!(size = snet_frame_size(g_snet.rx_buf, g_snet.rx_pos))) {
+            if (q == end) return;       /* header still incomplete */
+            g_snet.rx_buf[g_snet.rx_pos++] = *q++;
+        }
+        if (size != SNET_SIZE_BAD) {
+            size_t need = (size_t)(size - g_snet.rx_pos);
+            if ((size_t)(end - q) < need) {
+                memcpy(&g_snet.rx_buf[g_snet.rx_pos], q, (size_t)(end - q));
+                g_snet.rx_pos = (uint8_t)(g_snet.rx_pos + (end - q));
+                return;
+            }
+            memcpy(&g_snet.rx_buf[g_snet.rx_pos], q, need);
+            q += need;
+        }
+        g_snet.rx_pos = 0;
+        const uint8_t *f = _valid(g_snet.rx_buf, size);
+        if (f) {
+            snet_rx_frame(f);
+            p = q;
+        }
+        /* else rescan those bytes: a real frame may start among them */
+    }
+
+    while (p < end) {
+        /* back-to-back frames: the next STX is usually right here */
+        const uint8_t *s = (*p == SNET_STX) ? p :
+            (const uint8_t*)memchr(p, SNET_STX, (size_t)(end - p));
+        if (!s) return;
+        size_t avail = (size_t)(end - s);
+        uint8_t size = snet_frame_size(s, avail);
+        if (!size || (size != SNET_SIZE_BAD && avail < size)) {
+            /* partial frame: keep it for the next call */
+            g_snet.rx_pos = (uint8_t)avail;
+            memcpy(g_snet.rx_buf, s, g_snet.rx_pos);
+            return;
+        }
+        const uint8_t *f = _valid(s, size);
+        if (f) {
+            snet_rx_frame(f);
+            p = s + size;
+        } else {
+            p = s + 1;                  /* false STX: resync on the next */
+        }
+    }
+}
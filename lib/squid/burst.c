@@ -5,10 +5,13 @@
 /*  Frame layout (20 bytes):                                          */
 /*   [0]  STX   0x7E                                                  */
 /*   [1]  CHLEN  CH(7..4) | LEN(3..0)                                */
-/*   [2]  CTRL   TYP(7..5) | STS(4) | SEQ(3) | RES(2..0)            */
-/*   [3..17] payload (15 bytes max, LEN valid)                        */
+/*   [2]  CTRL   TYP(7..5) | STS(4) | SEQ(3) | ACK(2) | ASEQ(1)     */
+/*   [3..17] payload (15 bytes max, LEN valid; coded: 11 + parity)    */
 /*   [18] HSH   XOR of bytes 1..17                                   */
 /*   [19] ETX   0xD3                                                  */
+/*  Long DATA (SNET_FEAT_LONG) has a length byte and a CRC-16 instead */
+/*  of HSH; short ACK/PING (SNET_FEAT_SHORT) are 5 bytes.  See        */
+/*  internal.h.                                                       */
 /* ------------------------------------------------------------------ */
 #define F_STX   0
 #define F_CHLEN 1
@@ -25,11 +28,23 @@ static uint8_t _elapsed(uint8_t since)
 
 static void _set_connected(void)
 {
-    g_snet.seq_tx = 0u;
-    g_snet.seq_expect = 0u;
+    if (!g_snet.resumed) {
+        snet_tx_lost();
+        g_snet.seq_tx = 0u;
+        g_snet.seq_expect = 0u;
+        g_snet.tx_pending = 0u;         /* fresh session: held frame dropped */
+        g_snet.rx_busy = 0u;
+    }
     g_snet.eng = SNET_ENG_CONNECTED;
     g_snet.link_up = 1u;
     g_snet.retries = 0u;
+    g_snet.peer_heard = 0u;
+    if (g_snet.tx_pending) {
+        /* resumed with our DATA undelivered: resend it on this burst */
+        g_snet.eng = SNET_ENG_WAITING;
+        g_snet.last_tx_tick =
+            (uint8_t)(g_snet.plat->get_tick() - g_snet.timeout_ticks);
+    }
 }
 
 static void _set_disconnected(void)
@@ -50,133 +65,710 @@ static void _schedule_ack(void)
     g_snet.ack_wait = g_snet.plat->get_tick();
 }
 
-/* ---- XOR hash over bytes 1..17 ---- */
-static uint8_t _hash(const uint8_t *frame)
+#if SNET_CFG_LONG
+/* ---- CRC-16/CCITT (poly 0x1021, init 0xFFFF), bitwise: no table ---- */
+uint16_t snet_crc16(const uint8_t *p, uint8_t n)
+{
+    uint16_t crc = 0xFFFFu;
+    while (n--) {
+        crc ^= (uint16_t)((uint16_t)*p++ << 8);
+        for (uint8_t b = 0; b < 8u; b++)
+            crc = (crc & 0x8000u) ? (uint16_t)((crc << 1) ^ 0x1021u)
+                                  : (uint16_t)(crc << 1);
+    }
+    return crc;
+}
+
+bool snet_long_ok(const uint8_t *f, uint8_t size)
+{
+    uint16_t crc = snet_crc16(&f[1], (uint8_t)(size - 4u));
+    return f[size - 1u] == SNET_ETX &&
+           f[size - 3u] == (uint8_t)(crc & 0xFFu) &&
+           f[size - 2u] == (uint8_t)(crc >> 8);
+}
+
+/* ---- adapt the DATA payload limit to the line ----
+ * Halve it on a dropped frame or a resend, double it after a run of
+ * clean ACKs: the short payload (15, or 11 coded) up to long_max. */
+#define SNET_GROW_ACKS 8u
+
+static uint8_t _pay_floor(void) { return SNET_PAY_NOW; }
+
+void snet_line_error(void)
+{
+    g_snet.clean_acks = 0u;
+    uint8_t half = (uint8_t)(g_snet.tx_pay / 2u);
+    g_snet.tx_pay = (half > _pay_floor()) ? half : _pay_floor();
+}
+
+static void _line_clean(void)
+{
+    if (!g_snet.long_max || ++g_snet.clean_acks < SNET_GROW_ACKS) return;
+    g_snet.clean_acks = 0u;
+    uint16_t twice = (uint16_t)(g_snet.tx_pay * 2u);
+    g_snet.tx_pay = (twice < g_snet.long_max) ? (uint8_t)twice : g_snet.long_max;
+}
+#else
+#define _line_clean() do { } while (0)
+#endif
+
+/* ---- bytes in a complete frame we built ---- */
+static uint8_t _size(const uint8_t *frame)
+{
+    return snet_frame_size(frame, SNET_LONG_PAY);
+}
+
+bool snet_short_ok(const uint8_t *f)
 {
-    uint8_t h = 0;
-    for (uint8_t i = 1; i <= F_HSH - 1; i++) h ^= frame[i];
-    return h;
+    uint8_t kind = f[SNET_SHORT_KIND];
+    return (kind == SNET_TYP_ACK || kind == SNET_TYP_PING) &&
+           f[SNET_SHORT_HSH] == (uint8_t)(kind ^ f[F_CTRL]) &&
+           f[SNET_SHORT_BYTES - 1u] == SNET_ETX;
 }
 
-/* ---- send a raw frame (20 bytes) ---- */
+/* ---- finish a frame: parity when coded, then HSH ---- */
+static void _seal(uint8_t *frame)
+{
+    if (SNET_GET_TYP(frame[F_CTRL]) == SNET_TYP_SHORT) {
+        frame[SNET_SHORT_HSH] = (uint8_t)(frame[SNET_SHORT_KIND] ^ frame[F_CTRL]);
+        return;
+    }
+#if SNET_CFG_LONG
+    if (SNET_GET_TYP(frame[F_CTRL]) == SNET_TYP_LDATA) {
+        uint8_t size = _size(frame);
+        uint16_t crc = snet_crc16(&frame[1], (uint8_t)(size - 4u));
+        frame[size - 3u] = (uint8_t)(crc & 0xFFu);
+        frame[size - 2u] = (uint8_t)(crc >> 8);
+        return;
+    }
+#endif
+#if SNET_CFG_FEC
+    if (SNET_FEC_ON() && SNET_GET_TYP(frame[F_CTRL]) > SNET_TYP_HELLO_ACK)
+        snet_fec_encode(frame);
+#endif
+    frame[F_HSH] = snet_frame_hash(frame);
+}
+
+/* ---- stamp the current ACK state into a DATA/ACK frame ----
+ * Receiver state travels with every frame we send, so ACKs never wait
+ * for our own outstanding DATA and one stamp covers all owed ACKs. */
+static void _stamp_ack(uint8_t *frame)
+{
+    uint8_t ctrl = (uint8_t)(frame[F_CTRL] &
+                   (uint8_t)~(SNET_CTRL_STS_MASK | SNET_CTRL_ACK_MASK |
+                              SNET_CTRL_ASEQ_MASK));
+    ctrl |= SNET_CTRL_ACK_MASK;
+    if (g_snet.seq_expect ^ 1u) ctrl |= SNET_CTRL_ASEQ_MASK;
+    if (g_snet.rx_busy) ctrl |= SNET_CTRL_STS_MASK;    /* receiver full */
+    frame[F_CTRL] = ctrl;
+    _seal(frame);
+    g_snet.ack_needed = 0u;
+}
+
+/* ---- output buffer ----
+ * send_char may refuse a byte (non-zero); the rest of the frame stays in
+ * tx_out and the next burst carries on from there.  With a TX callback
+ * the driver takes the bytes with snet_tx_pull() instead.  Returns true
+ * once tx_out is empty. */
+static bool _flush(void)
+{
+    if (g_snet.tx_ready) {
+        if (SNET_ISR_LOAD(&g_snet.tx_pos) < g_snet.tx_len) return false;
+    } else {
+        uint8_t from = g_snet.tx_pos;
+        while (g_snet.tx_pos < g_snet.tx_len) {
+            if (g_snet.plat->send_char(g_snet.tx_out[g_snet.tx_pos]) != 0) {
+                if (g_snet.tx_pos != from)
+                    g_snet.tx_moved = g_snet.plat->get_tick();
+                /* no byte taken for a whole timeout: drop the rest */
+                if (_elapsed(g_snet.tx_moved) < g_snet.timeout_ticks)
+                    return false;
+                g_snet.tx_pos = g_snet.tx_len;
+                g_snet.tx_timed = 0u;
+                g_snet.tx_open = 0u;
+                return true;
+            }
+            g_snet.tx_pos++;
+        }
+    }
+    if (g_snet.tx_open) {
+        /* resend and HELLO timers and the pacing gap run from the end
+           of the frame */
+        uint8_t now = g_snet.plat->get_tick();
+        g_snet.pace_end = now;
+        g_snet.pace_wait = g_snet.tx_gap ? 1u : 0u;
+        if (g_snet.tx_timed) g_snet.last_tx_tick = now;
+        g_snet.tx_timed = 0u;
+        g_snet.tx_open = 0u;
+    }
+    return true;
+}
+
+/* ---- TX pacing: may the next frame start? ----
+ * Token bucket at frame granularity: credit refills by tx_rate bytes a
+ * tick up to tx_rate and each frame takes its size, so frames are
+ * spread out to the rate on average; tx_gap keeps idle ticks between
+ * them for receivers that cannot take two frames back to back.
+ * Ticks are 8-bit, so snet_idle() holds the host awake until the gap
+ * is over and the bucket full; after that a long sleep changes nothing. */
+static bool _pace_ok(void)
+{
+    if (!g_snet.tx_rate && !g_snet.tx_gap) {
+        g_snet.pace_wait = 0u;
+        return true;
+    }
+    uint8_t now = g_snet.plat->get_tick();
+    if (g_snet.pace_wait) {
+        if ((uint8_t)(now - g_snet.pace_end) < g_snet.tx_gap) return false;
+        g_snet.pace_wait = 0u;
+    }
+    if (!g_snet.tx_rate) return true;
+    int32_t c = g_snet.pace_credit +
+                (int32_t)(uint8_t)(now - g_snet.pace_tick) * g_snet.tx_rate;
+    g_snet.pace_tick = now;
+    g_snet.pace_credit = (int16_t)(c > g_snet.tx_rate ? g_snet.tx_rate : c);
+    return g_snet.pace_credit > 0;
+}
+
+/* ---- put a raw frame on the wire; timed: it restarts last_tx_tick ----
+ * _tx only runs with tx_out empty; a HELLO_ACK answered from _rx while
+ * it is busy is dropped and the peer's next HELLO gets one. */
+static void _put_frame(const uint8_t *frame, bool timed)
+{
+    if (!_flush() || !_pace_ok()) return;
+    uint8_t size = _size(frame);
+    g_snet.pace_credit = (int16_t)(g_snet.pace_credit - (g_snet.tx_rate ? size : 0u));
+    SNET_ISR_STORE(&g_snet.tx_len, 0u);     /* taker sees it empty ... */
+    g_snet.tx_pos = 0u;
+    memcpy(g_snet.tx_out, frame, size);
+    SNET_ISR_STORE(&g_snet.tx_len, size);   /* ... until the frame is in */
+    g_snet.tx_moved = g_snet.plat->get_tick();
+    g_snet.tx_timed = timed;
+    g_snet.tx_open = 1u;
+    if (timed) g_snet.last_tx_tick = g_snet.tx_moved;
+    if (g_snet.tx_ready) g_snet.tx_ready();
+    else (void)_flush();
+}
+
+/* ---- send a frame and keep it for resend on timeout ---- */
 static void _send_frame(const uint8_t *frame)
 {
-    for (uint8_t i = 0; i < SNET_FRAME_BYTES; i++)
-        g_snet.plat->send_char(frame[i]);
-    memcpy(g_snet.last_sent, frame, SNET_FRAME_BYTES);
-    g_snet.last_tx_tick = g_snet.plat->get_tick();
+    memcpy(g_snet.last_sent, frame, _size(frame));
+    _put_frame(frame, true);
 }
 
-/* ---- resend last frame ---- */
+/* ---- resend last frame (with fresh ACK state when it is DATA) ---- */
 static void _resend(void)
 {
-    for (uint8_t i = 0; i < SNET_FRAME_BYTES; i++)
-        g_snet.plat->send_char(g_snet.last_sent[i]);
-    g_snet.last_tx_tick = g_snet.plat->get_tick();
+    uint8_t typ = SNET_GET_TYP(g_snet.last_sent[F_CTRL]);
+    if (typ == SNET_TYP_DATA || typ == SNET_TYP_LDATA)
+        _stamp_ack(g_snet.last_sent);
+    _put_frame(g_snet.last_sent, true);
 }
 
-/* ---- build and send a frame ---- */
-static void _build_and_send(uint8_t typ, uint8_t sts, uint8_t ch,
-                            const uint8_t *payload, uint8_t len)
+/* ---- build a frame ---- */
+static void _build(uint8_t *frame, uint8_t typ, uint8_t sts, uint8_t ch,
+                   const uint8_t *payload, uint8_t len)
 {
-    uint8_t frame[SNET_FRAME_BYTES];
     memset(frame, 0, SNET_FRAME_BYTES);
     frame[F_STX]   = SNET_STX;
+    if ((typ == SNET_TYP_ACK || typ == SNET_TYP_PING) && SNET_SHORT_ON()) {
+        frame[SNET_SHORT_KIND] = typ;
+        frame[F_CTRL] = SNET_MAKE_CTRL(SNET_TYP_SHORT, sts, g_snet.seq_tx);
+        frame[SNET_SHORT_BYTES - 1u] = SNET_ETX;
+        if (typ == SNET_TYP_ACK) _stamp_ack(frame);
+        else _seal(frame);
+        return;
+    }
+#if SNET_CFG_LONG
+    if (typ == SNET_TYP_DATA && len > SNET_PAY_NOW) {
+        frame[F_CHLEN] = SNET_MAKE_CHLEN(ch, 0u);
+        frame[F_CTRL]  = SNET_MAKE_CTRL(SNET_TYP_LDATA, sts, g_snet.seq_tx);
+        frame[SNET_LONG_N] = len;
+        memcpy(&frame[SNET_LONG_PAY], payload, len);
+        frame[len + SNET_LONG_EXTRA - 1u] = SNET_ETX;
+        _stamp_ack(frame);
+        return;
+    }
+#endif
     frame[F_CHLEN] = SNET_MAKE_CHLEN(ch, len);
     frame[F_CTRL]  = SNET_MAKE_CTRL(typ, sts, g_snet.seq_tx);
     if (payload && len > 0) {
         uint8_t n = (len > SNET_PAY_MAX) ? SNET_PAY_MAX : len;
         memcpy(&frame[F_PAY], payload, n);
     }
-    frame[F_HSH] = _hash(frame);
+    if (typ == SNET_TYP_DATA || typ == SNET_TYP_ACK) _stamp_ack(frame);
+    else _seal(frame);
     frame[F_ETX] = SNET_ETX;
+}
+
+/* ---- build and send a frame ---- */
+static void _build_and_send(uint8_t typ, uint8_t sts, uint8_t ch,
+                            const uint8_t *payload, uint8_t len)
+{
+    uint8_t frame[SNET_FRAME_MAX];
+    _build(frame, typ, sts, ch, payload, len);
     _send_frame(frame);
 }
 
+/* ---- pure ACK: never replaces the DATA frame kept for resend ---- */
+static void _send_ack(void)
+{
+    uint8_t frame[SNET_FRAME_BYTES];
+    _build(frame, SNET_TYP_ACK, 0, SNET_CH_SYS, (const uint8_t*)0, 0);
+    _put_frame(frame, false);
+}
+
+static bool _ack_due(void)
+{
+    return g_snet.ack_needed &&
+           _elapsed(g_snet.ack_wait) >= g_snet.ack_delay_ticks;
+}
+
+/* ---- does this frame positively acknowledge our outstanding DATA? ----
+ * We stamp every DATA/ACK frame, so the ACK bit is always set on ours.
+ * A frame without it comes from an older peer that does not stamp:
+ * there any DATA/ACK with STS 0 is the acknowledgement, as before. */
+static bool _acks_outstanding(uint8_t typ, uint8_t ctrl)
+{
+    if (typ != SNET_TYP_ACK && typ != SNET_TYP_DATA) return false;
+    if (SNET_GET_STS(ctrl) != 0u) return false;
+    if (!SNET_GET_ACK(ctrl)) return true;
+    return SNET_GET_ASEQ(ctrl) == g_snet.seq_tx;
+}
+
 /* ---- find socket bound to channel id ---- */
 static snet_chan_t *_find_chan(uint8_t ch_id)
 {
-    snet_chan_t *c = g_snet.chan_head;
-    while (c) { if (c->ch_id == ch_id) return c; c = c->next; }
-    return (snet_chan_t*)0;
+    return snet_chan_of(ch_id);
 }
 
 /* ---- enqueue received payload into channel RX queue ---- */
 static void _enqueue_rx(uint8_t ch_id, const uint8_t *data, uint8_t len)
 {
-    if (len == 0) return;
+    if (len == 0 || ch_id == SNET_CH_SYS) return;
     snet_chan_t *ch = _find_chan(ch_id);
     if (!ch) return;                    /* channel not open, discard */
+#if SNET_CFG_STREAM
+    if (ch->st.sink) { snet_stream_push(ch, data, len); return; }
+#endif
+    if (ch->sub) { snet_fan_rx(ch, data, len); return; }
     if (ch->rx_cap && (ch->rx_bytes + len > ch->rx_cap)) return; /* full */
 
-    snet_node_t *n = (snet_node_t*)g_snet.plat->malloc(
-        (uint16_t)(sizeof(snet_node_t) + len));
-    if (!n) return;
-    n->next = (snet_node_t*)0;
-    n->len  = len;
-    n->off  = 0;
-    memcpy(n->data, data, len);
+    squid_iovec_t iov;
+    iov.base = (uint8_t*)data;
+    iov.len  = len;
+    (void)snet_q_put(&ch->rxq, &ch->rx_bytes, &iov, 1u, len);
+}
+
+/* ---- can channel ch_id take len more bytes? (unbound ones discard) ---- */
+static bool _rx_room(uint8_t ch_id, uint8_t len)
+{
+    if (ch_id == SNET_CH_SYS) return true;
+    snet_chan_t *ch = _find_chan(ch_id);
+    if (!ch) return true;
+#if SNET_CFG_STREAM
+    if (ch->st.sink) return true;       /* written through, never queued */
+#endif
+    /* every subscriber must take it: the slowest one paces the channel */
+    uint16_t copies = 0u;
+    for (; ch; ch = ch->sub_next) {
+        if (!SNET_Q_FITS(ch->rx_bytes, len)) return false; /* static ring */
+        if (ch->rx_cap && ch->rx_bytes + len > ch->rx_cap) return false;
+        copies++;
+    }
+    /* budget: heap subscribers share one block, static rings copy */
+    return SNET_MEM_FITS(SNET_CFG_STATIC ? copies * len : len);
+}
 
-    if (ch->rx_tail) ch->rx_tail->next = n; else ch->rx_head = n;
-    ch->rx_tail = n;
-    ch->rx_bytes += len;
+/* ---- split a packed DATA payload into per-channel records ----
+ * With commit == false only checks that every record fits. */
+static bool _unpack_rx(const uint8_t *pay, uint8_t len, bool commit)
+{
+    uint8_t pos = 0;
+    while (pos + SNET_REC_HDR < len) {
+        uint8_t rch  = SNET_GET_CH(pay[pos]);
+        uint8_t rlen = SNET_GET_LEN(pay[pos]);
+        uint8_t hdr  = SNET_REC_HDR;
+        if (rch == SNET_CH_EXT && SNET_XCH_ON()) rch = pay[pos + hdr++];
+        if (rlen == 0 || pos + hdr + rlen > len) break;
+        if (!commit && !_rx_room(rch, rlen)) return false;
+        if (commit) _enqueue_rx(rch, &pay[pos + hdr], rlen);
+        pos = (uint8_t)(pos + hdr + rlen);
+    }
+    return true;
 }
 
-static void _accept_data(uint8_t ch_id, uint8_t len)
+static void _accept_data(const uint8_t *pay, uint8_t ch_id, uint8_t len)
 {
-    _enqueue_rx(ch_id, &g_snet.rx_buf[F_PAY], len);
+    bool packed = (ch_id == SNET_CH_SYS && (g_snet.feat & SNET_FEAT_PACK));
+    if (ch_id == SNET_CH_EXT && SNET_XCH_ON() && len) {
+        ch_id = *pay++;                 /* extended id leads the payload */
+        len--;
+    }
+
+    if (packed ? !_unpack_rx(pay, len, false) : !_rx_room(ch_id, len)) {
+        /* RX queue at rx_cap: keep seq_expect, tell the sender to hold off */
+        g_snet.rx_busy = 1u;
+        _schedule_ack();
+        return;
+    }
+    g_snet.rx_busy = 0u;
+    if (packed) (void)_unpack_rx(pay, len, true);
+    else        _enqueue_rx(ch_id, pay, len);
     g_snet.seq_expect ^= 1u;
     _schedule_ack();
 }
 
-/* ---- dequeue payload from channel TX queue (up to SNET_PAY_MAX) ---- */
-static uint8_t _dequeue_tx(snet_chan_t *ch, uint8_t *out)
-{
-    uint8_t total = 0;
-    while (ch->tx_head && total < SNET_PAY_MAX) {
-        snet_node_t *n = ch->tx_head;
-        uint16_t avail = n->len - n->off;
-        uint8_t  take  = (avail > (SNET_PAY_MAX - total))
-                         ? (SNET_PAY_MAX - total) : (uint8_t)avail;
-        memcpy(out + total, n->data + n->off, take);
-        n->off += take;
-        total  += take;
-        ch->tx_bytes -= take;
-        if (n->off >= n->len) {         /* node consumed */
-            ch->tx_head = n->next;
-            if (!ch->tx_head) ch->tx_tail = (snet_node_t*)0;
-            g_snet.plat->free(n);
-        }
-    }
-    return total;
+/* ---- dequeue payload from channel TX queue (up to max bytes) ---- */
+static uint8_t _dequeue_tx(snet_chan_t *ch, uint8_t *out, uint8_t max)
+{
+    squid_iovec_t iov;
+    iov.base = out;
+    iov.len  = max;
+    uint8_t n = (uint8_t)snet_q_get(&ch->txq, &ch->tx_bytes, &iov, 1u);
+    ch->tx_flight = (uint8_t)(ch->tx_flight + n);
+#if SNET_CFG_STREAM
+    if (!n) n = snet_stream_pull(ch, out, max);
+#endif
+    return n;
+}
+
+/* ---- bound, with data, and addressable on this link ---- */
+static bool _sendable(const snet_chan_t *c)
+{
+    if (c->ch_id == 0u || !SNET_TX_AVAIL(c)) return false;
+    return c->ch_id <= SNET_CH_EXT || SNET_XCH_ON();
 }
 
 /* ---- pick next channel with data (round-robin) ---- */
 static snet_chan_t *_next_tx_chan(void)
 {
-    if (!g_snet.chan_head) return (snet_chan_t*)0;
-
-    /* start after last served channel */
-    uint8_t start = (uint8_t)(g_snet.rr_last_id + 1u);
-    for (uint8_t pass = 0; pass < 16; pass++) {
-        uint8_t id = (uint8_t)((start + pass) & 0x0Fu);
-        snet_chan_t *c = _find_chan(id);
-        if (c && c->tx_head) {
-            g_snet.rr_last_id = id;
+#if SNET_CFG_RR
+    /* from the socket after the last one served, wrapping once */
+    snet_chan_t *start = g_snet.rr_next ? g_snet.rr_next : g_snet.chan_head;
+    snet_chan_t *c = start;
+    while (c) {
+        if (_sendable(c)) {
+            g_snet.rr_next = c->next;
             return c;
         }
+        c = c->next ? c->next : g_snet.chan_head;
+        if (c == start) break;
     }
     return (snet_chan_t*)0;
+#else
+    /* first socket in list order */
+    for (snet_chan_t *c = g_snet.chan_head; c; c = c->next)
+        if (_sendable(c)) return c;
+    return (snet_chan_t*)0;
+#endif
+}
+
+/* ---- any channel other than skip with queued TX data? ---- */
+static bool _other_tx_pending(const snet_chan_t *skip)
+{
+    for (snet_chan_t *c = g_snet.chan_head; c; c = c->next)
+        if (c != skip && _sendable(c)) return true;
+    return false;
+}
+
+/* ---- fill a packed payload starting with first, then round-robin ---- */
+static uint8_t _pack_tx(snet_chan_t *first, uint8_t *pay, uint8_t max)
+{
+    uint8_t pos = 0;
+    snet_chan_t *c = first;
+    for (;;) {
+        uint8_t esc = SNET_CH_ESC(c->ch_id) ? 1u : 0u;
+        uint8_t hdr = (uint8_t)(SNET_REC_HDR + esc);
+        if ((uint8_t)(max - pos) <= hdr) break;
+        uint8_t n = _dequeue_tx(c, &pay[pos + hdr], (uint8_t)(max - pos - hdr));
+        if (!n) break;                  /* failed source: LEN 0 ends the unpack */
+        pay[pos] = SNET_MAKE_CHLEN(esc ? SNET_CH_EXT : c->ch_id, n);
+        if (esc) pay[pos + 1] = c->ch_id;
+        pos = (uint8_t)(pos + hdr + n);
+        if ((uint8_t)(max - pos) <= SNET_REC_HDR) break;
+        c = _next_tx_chan();
+        if (!c) break;
+    }
+    return pos;
+}
+
+/* ---- send one DATA frame for ch (packed when a second channel fits) ---- */
+static void _send_data(snet_chan_t *ch)
+{
+    uint8_t pay[SNET_FRAME_MAX];
+    uint8_t max = SNET_PAY_NOW;
+    if ((g_snet.feat & SNET_FEAT_PACK) &&
+        ch->tx_bytes + 2u * SNET_REC_HDR < max &&
+#if SNET_CFG_STREAM
+        !ch->st.src &&
+#endif
+        _other_tx_pending(ch)) {
+        uint8_t n = _pack_tx(ch, pay, max);
+        _build_and_send(SNET_TYP_DATA, 0, SNET_CH_SYS, pay, n);
+    } else {
+#if SNET_CFG_LONG
+        if (g_snet.long_max && g_snet.tx_pay > max) max = g_snet.tx_pay;
+#endif
+        uint8_t esc = SNET_CH_ESC(ch->ch_id) ? 1u : 0u;
+        pay[0] = ch->ch_id;             /* kept only when escaped */
+        uint8_t n = _dequeue_tx(ch, pay + esc, (uint8_t)(max - esc));
+        if (!n) return;                 /* source failed: nothing to send */
+        _build_and_send(SNET_TYP_DATA, 0, esc ? SNET_CH_EXT : ch->ch_id,
+                        pay, (uint8_t)(n + esc));
+    }
+    g_snet.tx_pending = 1u;
+    g_snet.eng = SNET_ENG_WAITING;
+}
+
+/* ---- features we offer: bond and bus envelopes hold 20-byte frames only ---- */
+static uint8_t _offer(void)
+{
+#if SNET_CFG_BUS
+    if (snet_bus_carries(g_snet.plat))
+        return (uint8_t)(g_snet.feat_local & (uint8_t)~(SNET_FEAT_LONG | SNET_FEAT_SHORT));
+#endif
+    if (snet_bond_carries(g_snet.plat))
+        return (uint8_t)(g_snet.feat_local & (uint8_t)~(SNET_FEAT_LONG | SNET_FEAT_SHORT));
+    return g_snet.feat_local;
+}
+
+/* ---- HELLO / HELLO_ACK: features, session tokens and seq state ----
+ * Sent without touching last_sent, which may hold DATA to resume. */
+static void _send_hello(uint8_t typ)
+{
+    uint8_t pay[SNET_HELLO_FULL];
+    uint8_t st = 0u;
+    if (g_snet.seq_tx)     st |= SNET_HSEQ_TX;
+    if (g_snet.seq_expect) st |= SNET_HSEQ_EXPECT;
+    if (g_snet.tx_pending) st |= SNET_HSEQ_PENDING;
+    if (typ == SNET_TYP_HELLO_ACK && g_snet.resumed) st |= SNET_HSEQ_RESUMED;
+
+    pay[SNET_HELLO_FEAT]     = _offer();
+    pay[SNET_HELLO_SESS]     = (uint8_t)(g_snet.sess_id & 0xFFu);
+    pay[SNET_HELLO_SESS + 1] = (uint8_t)(g_snet.sess_id >> 8);
+    pay[SNET_HELLO_PEER]     = (uint8_t)(g_snet.sess_peer & 0xFFu);
+    pay[SNET_HELLO_PEER + 1] = (uint8_t)(g_snet.sess_peer >> 8);
+    pay[SNET_HELLO_SEQ]      = st;
+    pay[SNET_HELLO_LONG]     = (uint8_t)SNET_CFG_LONG;
+    pay[SNET_HELLO_RATE]     = g_snet.pace_rate;
+    pay[SNET_HELLO_GAP]      = g_snet.pace_gap;
+
+    uint8_t frame[SNET_FRAME_BYTES];
+    _build(frame, typ, 0, SNET_CH_SYS, pay, SNET_HELLO_FULL);
+    _put_frame(frame, typ == SNET_TYP_HELLO);
+}
+
+static uint16_t _hello16(uint8_t off)
+{
+    const uint8_t *p = &g_snet.rx_buf[F_PAY + off];
+    return (uint16_t)(p[0] | ((uint16_t)p[1] << 8));
+}
+
+/* ---- may the session in this HELLO continue where it stopped? ---- */
+static bool _can_resume(uint8_t st)
+{
+    if (!g_snet.sess_peer ||
+        _hello16(SNET_HELLO_SESS) != g_snet.sess_peer ||
+        _hello16(SNET_HELLO_PEER) != g_snet.sess_id) return false;
+    /* our DATA vs their receiver: only a held frame may be one ahead */
+    if (!g_snet.tx_pending &&
+        ((st & SNET_HSEQ_EXPECT) ? 1u : 0u) != g_snet.seq_tx) return false;
+    /* their DATA vs our receiver */
+    if (!(st & SNET_HSEQ_PENDING) &&
+        ((st & SNET_HSEQ_TX) ? 1u : 0u) != g_snet.seq_expect) return false;
+    return true;
+}
+
+static void _take_hello(uint8_t typ, uint8_t len)
+{
+    uint8_t peer = (len > SNET_HELLO_FEAT)
+                   ? g_snet.rx_buf[F_PAY + SNET_HELLO_FEAT] : 0u;
+    uint8_t was  = g_snet.feat;
+    g_snet.feat = (uint8_t)(_offer() & peer);
+#if SNET_CFG_LONG
+    uint8_t was_long = g_snet.long_max;
+    uint8_t peer_long = (len > SNET_HELLO_LONG)
+                        ? g_snet.rx_buf[F_PAY + SNET_HELLO_LONG] : 0u;
+    if (peer_long > SNET_CFG_LONG) peer_long = SNET_CFG_LONG;
+    if (peer_long <= SNET_PAY_MAX) g_snet.feat &= (uint8_t)~SNET_FEAT_LONG;
+    g_snet.long_max   = (g_snet.feat & SNET_FEAT_LONG) ? peer_long : 0u;
+    g_snet.tx_pay     = SNET_PAY_NOW;   /* start short, grow while clean */
+    g_snet.clean_acks = 0u;
+#else
+    uint8_t was_long = 0u;
+#endif
+    /* pacing the peer asks for; an older HELLO asks for none */
+    g_snet.peer_rate = (len > SNET_HELLO_RATE) ? g_snet.rx_buf[F_PAY + SNET_HELLO_RATE] : 0u;
+    g_snet.peer_gap  = (len > SNET_HELLO_GAP)  ? g_snet.rx_buf[F_PAY + SNET_HELLO_GAP]  : 0u;
+    snet_pace_update();
+    g_snet.resumed = 0u;
+    if (len < SNET_HELLO_LEN) {         /* peer without session support */
+        g_snet.sess_peer = 0u;
+        return;
+    }
+
+    uint8_t st = g_snet.rx_buf[F_PAY + SNET_HELLO_SEQ];
+    if (g_snet.feat & SNET_FEAT_RESUME) {
+        /* the responder decides; the initiator follows its answer */
+        /* a held frame is coded and sized for the old feature set */
+        if (typ == SNET_TYP_HELLO)
+            g_snet.resumed = (_can_resume(st) &&
+                              !((was ^ g_snet.feat) & SNET_FEAT_FRAMING) &&
+                              was_long == SNET_LONG_MAX()) ? 1u : 0u;
+        else
+            g_snet.resumed = ((st & SNET_HSEQ_RESUMED) && g_snet.sess_peer &&
+                              _hello16(SNET_HELLO_SESS) == g_snet.sess_peer)
+                             ? 1u : 0u;
+    }
+    if (g_snet.resumed && g_snet.tx_pending &&
+        ((st & SNET_HSEQ_EXPECT) ? 1u : 0u) != g_snet.seq_tx) {
+        /* peer already accepted our held DATA; only its ACK was lost */
+        g_snet.seq_tx ^= 1u;
+        g_snet.tx_pending = 0u;
+        snet_tx_acked();
+    }
+    g_snet.sess_peer = _hello16(SNET_HELLO_SESS);
+}
+
+/* ---- a retransmitted HELLO the peer sent before seeing our answer ---- */
+static bool _stale_hello(uint8_t len)
+{
+    if (g_snet.peer_heard || len < SNET_HELLO_LEN) return false;
+    return _hello16(SNET_HELLO_SESS) == g_snet.sess_peer &&
+           _hello16(SNET_HELLO_PEER) != g_snet.sess_id;
+}
+
+static void _answer_hello(uint8_t len)
+{
+    _take_hello(SNET_TYP_HELLO, len);
+    _send_hello(SNET_TYP_HELLO_ACK);
+    _set_connected();
+}
+
+/* ================================================================== */
+/*  RX: handle one validated frame                                    */
+/* ================================================================== */
+/* frame is rx_buf, or a frame in place in a snet_feed() buffer */
+void snet_rx_frame(const uint8_t *frame)
+{
+    /* parse header */
+    uint8_t ctrl  = frame[F_CTRL];
+    uint8_t chlen = frame[F_CHLEN];
+    uint8_t typ   = SNET_GET_TYP(ctrl);
+    uint8_t seq   = SNET_GET_SEQ(ctrl);
+    uint8_t ch_id = SNET_GET_CH(chlen);
+    uint8_t len   = SNET_GET_LEN(chlen);
+    const uint8_t *pay = &frame[F_PAY];
+    if (typ == SNET_TYP_SHORT) {
+        typ = frame[SNET_SHORT_KIND];   /* snet_short_ok: ACK or PING */
+        ch_id = SNET_CH_SYS;
+        len = 0u;
+    }
+#if SNET_CFG_LONG
+    if (typ == SNET_TYP_LDATA) {
+        typ = SNET_TYP_DATA;
+        len = frame[SNET_LONG_N];
+        pay = &frame[SNET_LONG_PAY];
+    }
+#endif
+
+    /* the HELLO helpers read rx_buf; handshakes are rare, copy there */
+    if (typ <= SNET_TYP_HELLO_ACK && frame != g_snet.rx_buf)
+        memcpy(g_snet.rx_buf, frame, SNET_FRAME_BYTES);
+
+    switch (g_snet.eng) {
+
+    case SNET_ENG_STARTUP:
+        if (typ == SNET_TYP_HELLO) {
+            /* peer says hello — reply with HELLO_ACK */
+            _answer_hello(len);
+        } else if (typ == SNET_TYP_HELLO_ACK) {
+            /* our HELLO was accepted */
+            _take_hello(SNET_TYP_HELLO_ACK, len);
+            _set_connected();
+        }
+        break;
+
+    case SNET_ENG_WAITING:
+    case SNET_ENG_CONNECTED:
+        if (typ == SNET_TYP_HELLO) {
+            if (len < SNET_HELLO_LEN) {
+                /* peer restarted — go back to startup */
+                _peer_restarted();
+            } else if (_stale_hello(len)) {
+                /* our HELLO_ACK was lost: answer again, session kept */
+                _send_hello(SNET_TYP_HELLO_ACK);
+            } else {
+                /* peer reconnects: one handshake, resumed if possible */
+                _answer_hello(len);
+            }
+            break;
+        }
+        if (typ == SNET_TYP_HELLO_ACK) break;  /* late answer, ignore */
+        g_snet.peer_heard = 1u;
+
+        /* sender side: ACK (pure or piggybacked) for our DATA */
+        if (g_snet.eng == SNET_ENG_WAITING &&
+            _acks_outstanding(typ, ctrl)) {
+            g_snet.seq_tx ^= 1u;
+            g_snet.tx_pending = 0u;
+            snet_tx_acked();
+            _line_clean();
+            g_snet.retries = 0u;
+            g_snet.eng = SNET_ENG_CONNECTED;
+        } else if (g_snet.eng == SNET_ENG_WAITING &&
+                   SNET_GET_ACK(ctrl) && SNET_GET_STS(ctrl)) {
+            /* receiver busy: hold off a full timeout, no retry spent */
+            g_snet.retries = 0u;
+            g_snet.last_tx_tick = g_snet.plat->get_tick();
+        }
+
+        /* receiver side: runs whether or not our DATA is in flight */
+        if (typ == SNET_TYP_DATA) {
+            if (seq == g_snet.seq_expect) {
+                /* new data — accept */
+                _accept_data(pay, ch_id, len);
+            } else {
+                /* duplicate — our ACK was lost, re-ACK */
+                _schedule_ack();
+            }
+        } else if (typ == SNET_TYP_PING) {
+            /* respond with ACK */
+            _schedule_ack();
+        }
+        break;
+
+    case SNET_ENG_DISCONNECTED:
+        /* ignore everything while disconnected */
+        break;
+    }
 }
 
 /* ================================================================== */
 /*  RX: try to receive one complete frame                             */
 /* ================================================================== */
+/* next received byte: interrupt ring first, then recv_char */
+static int _getc(void)
+{
+#if SNET_CFG_ISR_RING
+    uint8_t t = g_snet.isr_tail;
+    if (t != SNET_ISR_LOAD(&g_snet.isr_head)) {
+        uint8_t c = g_snet.isr_buf[t & SNET_ISR_MASK];
+        SNET_ISR_STORE(&g_snet.isr_tail, (uint8_t)(t + 1u));
+        return c;
+    }
+    if (!g_snet.plat->recv_char) return -1;
+#endif
+    return g_snet.plat->recv_char();
+}
+
 static void _rx(void)
 {
     /* read bytes until we have a full frame or no more data */
     for (;;) {
-        int b = g_snet.plat->recv_char();
+        int b = _getc();
         if (b < 0) return;             /* no data available */
 
         uint8_t c = (uint8_t)b;
@@ -189,82 +781,44 @@ static void _rx(void)
 
         g_snet.rx_buf[g_snet.rx_pos++] = c;
 
-        if (g_snet.rx_pos < SNET_FRAME_BYTES)
+        uint8_t size = snet_frame_size(g_snet.rx_buf, g_snet.rx_pos);
+        if (size == SNET_SIZE_BAD) {
+            g_snet.rx_pos = 0;
+            snet_line_error();
+            continue;
+        }
+        if (!size || g_snet.rx_pos < size)
             continue;                   /* frame not complete yet */
 
         /* ---- full frame received ---- */
         g_snet.rx_pos = 0;             /* reset for next frame */
 
-        /* validate ETX and hash */
-        if (g_snet.rx_buf[F_ETX] != SNET_ETX) break;
-        if (_hash(g_snet.rx_buf) != g_snet.rx_buf[F_HSH]) break;
-
-        /* parse header */
-        uint8_t ctrl  = g_snet.rx_buf[F_CTRL];
-        uint8_t chlen = g_snet.rx_buf[F_CHLEN];
-        uint8_t typ   = SNET_GET_TYP(ctrl);
-        uint8_t seq   = SNET_GET_SEQ(ctrl);
-        uint8_t ch_id = SNET_GET_CH(chlen);
-        uint8_t len   = SNET_GET_LEN(chlen);
-
-        switch (g_snet.eng) {
-
-        case SNET_ENG_STARTUP:
-            if (typ == SNET_TYP_HELLO) {
-                /* peer says hello — reply with HELLO_ACK */
-                _build_and_send(SNET_TYP_HELLO_ACK, 0, SNET_CH_SYS,
-                                (const uint8_t*)0, 0);
-                _set_connected();
-            } else if (typ == SNET_TYP_HELLO_ACK) {
-                /* our HELLO was accepted */
-                _set_connected();
-            }
+        if (size == SNET_SHORT_BYTES) {
+            if (snet_short_ok(g_snet.rx_buf)) snet_rx_frame(g_snet.rx_buf);
+            else snet_line_error();
             break;
+        }
 
-        case SNET_ENG_WAITING:
-            /* we are waiting for ACK of the last DATA we sent */
-            if (typ == SNET_TYP_ACK || typ == SNET_TYP_DATA) {
-                /* any valid frame in WAITING means peer is alive;
-                   for ACK, STS=0 means positive ack */
-                if (SNET_GET_STS(ctrl) == 0u) {
-                    /* positive ACK — advance TX seq */
-                    g_snet.seq_tx ^= 1u;
-                    g_snet.retries = 0u;
-                    g_snet.eng = SNET_ENG_CONNECTED;
-                }
-                /* if it also carries DATA, accept it */
-                if (typ == SNET_TYP_DATA && seq == g_snet.seq_expect) {
-                    _accept_data(ch_id, len);
-                }
-            } else if (typ == SNET_TYP_HELLO) {
-                /* peer restarted — go back to startup */
-                _peer_restarted();
-            }
+#if SNET_CFG_LONG
+        if (size != SNET_FRAME_BYTES) {
+            if (snet_long_ok(g_snet.rx_buf, size)) snet_rx_frame(g_snet.rx_buf);
+            else snet_line_error();
             break;
-
-        case SNET_ENG_CONNECTED:
-            if (typ == SNET_TYP_DATA) {
-                if (seq == g_snet.seq_expect) {
-                    /* new data — accept */
-                    _accept_data(ch_id, len);
-                }
-                /* duplicate (seq != expected) — just re-ACK below */
-            } else if (typ == SNET_TYP_ACK) {
-                /* pure ACK — already connected, nothing extra */
-            } else if (typ == SNET_TYP_PING) {
-                /* respond with ACK */
-                _schedule_ack();
-            } else if (typ == SNET_TYP_HELLO) {
-                /* peer restarted */
-                _peer_restarted();
-            }
-            break;
-
-        case SNET_ENG_DISCONNECTED:
-            /* ignore everything while disconnected */
+        }
+#endif
+        /* validate ETX and hash */
+        bool ok = g_snet.rx_buf[F_ETX] == SNET_ETX &&
+                  snet_frame_hash(g_snet.rx_buf) == g_snet.rx_buf[F_HSH];
+#if SNET_CFG_FEC
+        if (SNET_FEC_ON()) {
+            const uint8_t *f = snet_fec_rx(g_snet.rx_buf, ok);
+            if (f) snet_rx_frame(f);
+            else snet_line_error();
             break;
         }
-
+#endif
+        if (ok) snet_rx_frame(g_snet.rx_buf);
+        else snet_line_error();
         break;  /* process at most one complete frame per burst */
     }
 }
@@ -279,8 +833,7 @@ static void _tx(void)
     case SNET_ENG_STARTUP:
         /* periodically send HELLO */
         if (_elapsed(g_snet.last_tx_tick) >= g_snet.timeout_ticks) {
-            _build_and_send(SNET_TYP_HELLO, 0, SNET_CH_SYS,
-                            (const uint8_t*)0, 0);
+            _send_hello(SNET_TYP_HELLO);
             g_snet.retries++;
             if (g_snet.retries > g_snet.max_retries) {
                 _set_disconnected();
@@ -289,12 +842,21 @@ static void _tx(void)
         break;
 
     case SNET_ENG_WAITING:
-        /* resend on timeout */
+        /* 1) receiver side: owed ACK goes out even with our DATA in flight.
+              No DATA can carry it until ours is ACKed, and the peer's
+              DATA crossed ours, so it is likely waiting too: no delay. */
+        if (g_snet.ack_needed) {
+            _send_ack();
+            break;
+        }
+
+        /* 2) resend on timeout */
         if (_elapsed(g_snet.last_tx_tick) >= g_snet.timeout_ticks) {
             g_snet.retries++;
             if (g_snet.retries > g_snet.max_retries) {
                 _set_disconnected();
             } else {
+                snet_line_error();
                 _resend();
             }
         }
@@ -302,33 +864,22 @@ static void _tx(void)
 
     case SNET_ENG_CONNECTED: {
         /* 1) if we owe an ACK and delay expired, send it */
-        if (g_snet.ack_needed &&
-            _elapsed(g_snet.ack_wait) >= g_snet.ack_delay_ticks) {
+        if (_ack_due()) {
             /* try to piggyback ACK on DATA if available */
             snet_chan_t *ch = _next_tx_chan();
-            if (ch) {
-                uint8_t pay[SNET_PAY_MAX];
-                uint8_t n = _dequeue_tx(ch, pay);
-                _build_and_send(SNET_TYP_DATA, 0, ch->ch_id, pay, n);
-                g_snet.eng = SNET_ENG_WAITING;
-            } else {
-                _build_and_send(SNET_TYP_ACK, 0, SNET_CH_SYS,
-                                (const uint8_t*)0, 0);
-            }
-            g_snet.ack_needed = 0u;
+            if (ch) _send_data(ch);
+            else    _send_ack();
             break;
         }
 
         /* 2) send queued DATA */
         snet_chan_t *ch = _next_tx_chan();
         if (ch) {
-            uint8_t pay[SNET_PAY_MAX];
-            uint8_t n = _dequeue_tx(ch, pay);
-            _build_and_send(SNET_TYP_DATA, 0, ch->ch_id, pay, n);
-            g_snet.eng = SNET_ENG_WAITING;
+            _send_data(ch);
             break;
         }
 
+#if SNET_CFG_KEEPALIVE
         /* 3) ping keepalive */
         if (g_snet.ping_ticks &&
             _elapsed(g_snet.last_ping_tick) >= g_snet.ping_ticks) {
@@ -336,16 +887,17 @@ static void _tx(void)
                             (const uint8_t*)0, 0);
             g_snet.last_ping_tick = g_snet.plat->get_tick();
         }
+#endif
         break;
     }
 
     case SNET_ENG_DISCONNECTED:
         /* wait for timeout then restart */
         if (_elapsed(g_snet.last_tx_tick) >= g_snet.timeout_ticks) {
+            /* seq state and last_sent stay for a resumed session;
+               _set_connected() clears them if the session is new */
             g_snet.eng     = SNET_ENG_STARTUP;
             g_snet.retries = 0u;
-            g_snet.seq_tx     = 0u;
-            g_snet.seq_expect = 0u;
         }
         break;
     }
@@ -357,6 +909,12 @@ static void _tx(void)
 void snet_burst(void)
 {
     if (!g_snet.plat) return;
+    SNET_PROF_BEGIN(t0);
     _rx();
-    _tx();
+    SNET_PROF_END(SNET_PROF_RX, t0);
+    SNET_PROF_BEGIN(t1);
+    if (_flush() && _pace_ok()) _tx();  /* next frame once the last is out */
+    SNET_PROF_END(SNET_PROF_TX, t1);
+    if (g_snet.tx_blocked || g_snet.tx_notify) snet_socket_events();
+    SNET_PROF_END(SNET_PROF_BURST, t0);
 }
@@ -0,0 +1,222 @@
+/* lib/squid/bus.c – multi-drop half-duplex bus behind one platform.
+ *
+ * Engines write frames into their link's TX slots and read from its RX
+ * slots through the virtual hooks; only squid_bus_poll() touches the
+ * line.  On the controller the link is found by the current engine.
+ */
+#include "internal.h"
+#include "squid/bus.h"
+
+#if SNET_CFG_BUS
+
+/* bus context (single instance) */
+SNET_TLS snet_bus_t g_bus;
+
+static uint8_t _now(void)
+{
+    return g_bus.phys->get_tick();
+}
+
+static snet_bus_link_t *_by_addr(uint8_t addr)
+{
+    for (uint8_t i = 0; i < g_bus.n; i++)
+        if (g_bus.link[i].addr == addr) return &g_bus.link[i];
+    return (snet_bus_link_t*)0;
+}
+
+/* ---- link of the engine calling a hook ---- */
+static snet_bus_link_t *_link(void)
+{
+    if (g_bus.addr != SQUID_BUS_CONTROLLER) return &g_bus.link[0];
+    squid_engine_t *e = snet_engine_current();
+    for (uint8_t i = 0; i < g_bus.n; i++)
+        if (g_bus.link[i].eng == e) return &g_bus.link[i];
+    return (snet_bus_link_t*)0;
+}
+
+static int _bus_send(uint8_t c)
+{
+    snet_bus_link_t *l = _link();
+    if (!l) return 0;                   /* not attached: lost like noise */
+    if (l->tx_n == SNET_BUS_TXQ) return 1;  /* offered again next burst */
+    uint8_t slot = (uint8_t)((l->tx_rd + l->tx_n) % SNET_BUS_TXQ);
+    l->tx[slot][l->tx_pos++] = c;
+    if (l->tx_pos == SNET_FRAME_BYTES) {
+        l->tx_pos = 0;
+        l->tx_n++;
+    }
+    return 0;
+}
+
+static int _bus_recv(void)
+{
+    snet_bus_link_t *l = _link();
+    if (!l || !l->rx_n) return -1;
+    uint8_t c = l->rx[l->rx_rd][l->rx_pos++];
+    if (l->rx_pos == SNET_FRAME_BYTES) {
+        l->rx_pos = 0;
+        l->rx_rd = (uint8_t)((l->rx_rd + 1u) % SNET_BUS_RXQ);
+        l->rx_n--;
+    }
+    return c;
+}
+
+static uint8_t _bus_tick(void)         { return _now(); }
+static void   *_bus_malloc(uint16_t n) { return g_bus.phys->malloc(n); }
+static void    _bus_free(void *p)      { g_bus.phys->free(p); }
+
+/* ---- line side ---- */
+
+static void _put_env(uint8_t hdr, const uint8_t *frame)
+{
+    const snet_platform_t *p = g_bus.phys;
+    (void)p->send_char(hdr);            /* a refused byte is line noise */
+    if (!frame) return;
+    for (uint8_t k = 0; k < SNET_FRAME_BYTES; k++) (void)p->send_char(frame[k]);
+}
+
+/* ---- send l's queued frames; last is or-ed into the final header ---- */
+static bool _flush(snet_bus_link_t *l, uint8_t hdr, uint8_t last)
+{
+    bool any = l->tx_n != 0u;
+    while (l->tx_n) {
+        const uint8_t *f = l->tx[l->tx_rd];
+        l->tx_rd = (uint8_t)((l->tx_rd + 1u) % SNET_BUS_TXQ);
+        l->tx_n--;
+        _put_env(l->tx_n ? hdr : (uint8_t)(hdr | last), f);
+    }
+    return any;
+}
+
+static void _rx_put(snet_bus_link_t *l, const uint8_t *frame)
+{
+    if (l->rx_n == SNET_BUS_RXQ) return;    /* engine behind: dropped */
+    uint8_t slot = (uint8_t)((l->rx_rd + l->rx_n) % SNET_BUS_RXQ);
+    memcpy(l->rx[slot], frame, SNET_FRAME_BYTES);
+    l->rx_n++;
+}
+
+/* ---- a whole envelope: keep ours, follow the turn ---- */
+static void _deliver(uint8_t hdr, const uint8_t *frame)
+{
+    uint8_t addr = (uint8_t)(hdr & SNET_BUS_ADDR);
+    if (g_bus.addr == SQUID_BUS_CONTROLLER) {
+        /* only the node holding the turn may talk */
+        if (!(hdr & SNET_BUS_UP) || addr != g_bus.turn) return;
+        snet_bus_link_t *l = _by_addr(addr);
+        if (frame) _rx_put(l, frame);
+        if (hdr & SNET_BUS_TURN) {
+            l->missed = 0u;
+            g_bus.turn = 0u;
+        }
+    } else {
+        if ((hdr & SNET_BUS_UP) || addr != g_bus.addr) return;
+        if (frame) _rx_put(&g_bus.link[0], frame);
+        if (hdr & SNET_BUS_TURN) g_bus.turn = 1u;
+    }
+}
+
+static void _rx_byte(uint8_t c)
+{
+    if (g_bus.env_pos == 1u && c != SNET_STX) g_bus.env_pos = 0;    /* resync */
+    g_bus.env[g_bus.env_pos++] = c;
+    if (g_bus.env_pos == 1u) {
+        if (c & SNET_BUS_EMPTY) {
+            g_bus.env_pos = 0;
+            _deliver(c, (const uint8_t*)0);
+        }
+        return;
+    }
+    if (g_bus.env_pos < SNET_BUS_ENV) return;
+    g_bus.env_pos = 0;
+    _deliver(g_bus.env[0], &g_bus.env[1]);
+}
+
+void squid_bus_poll(void)
+{
+    if (!g_bus.phys) return;
+    int b;
+    while ((b = g_bus.phys->recv_char()) >= 0) _rx_byte((uint8_t)b);
+
+    if (g_bus.addr != SQUID_BUS_CONTROLLER) {
+        if (!g_bus.turn) return;
+        snet_bus_link_t *l = &g_bus.link[0];
+        uint8_t hdr = (uint8_t)(SNET_BUS_UP | g_bus.addr);
+        if (!_flush(l, hdr, SNET_BUS_TURN))
+            _put_env((uint8_t)(hdr | SNET_BUS_EMPTY | SNET_BUS_TURN), (const uint8_t*)0);
+        g_bus.turn = 0u;
+        return;
+    }
+
+    uint8_t now = _now();
+    if (g_bus.turn && (uint8_t)(now - g_bus.turn_tick) >= g_bus.turn_ticks) {
+        snet_bus_link_t *l = _by_addr(g_bus.turn);
+        if (l->missed < 0xFFu) l->missed++;
+        g_bus.turn = 0u;                /* silent node: take it back */
+        g_bus.env_pos = 0;
+    }
+    if (g_bus.turn || !g_bus.n) return;
+
+    for (uint8_t i = 0; i < g_bus.n; i++)
+        (void)_flush(&g_bus.link[i], g_bus.link[i].addr, 0u);
+    snet_bus_link_t *l = &g_bus.link[g_bus.next];
+    g_bus.next = (uint8_t)((g_bus.next + 1u) % g_bus.n);
+    _put_env((uint8_t)(SNET_BUS_TURN | SNET_BUS_EMPTY | l->addr), (const uint8_t*)0);
+    g_bus.turn = l->addr;
+    g_bus.turn_tick = now;
+}
+
+int squid_bus_init(const squid_platform_t *phys, uint8_t addr,
+                   uint8_t turn_ticks, squid_platform_t *out)
+{
+    if (!phys || !out || addr > SQUID_BUS_ADDR_MAX) return -1;
+    if (!phys->send_char || !phys->recv_char || !phys->get_tick) return -1;
+    if (!SNET_CFG_STATIC && (!phys->malloc || !phys->free)) return -1;
+
+    memset(&g_bus, 0, sizeof(g_bus));
+    g_bus.phys       = phys;
+    g_bus.addr       = addr;
+    g_bus.turn_ticks = turn_ticks ? turn_ticks : 2u;
+    if (addr != SQUID_BUS_CONTROLLER) {
+        g_bus.n = 1u;
+        g_bus.link[0].addr = addr;
+    }
+
+    out->send_char = _bus_send;
+    out->recv_char = _bus_recv;
+    out->get_tick  = _bus_tick;
+    out->malloc    = _bus_malloc;
+    out->free      = _bus_free;
+    return 0;
+}
+
+bool snet_bus_carries(const snet_platform_t *p)
+{
+    return p && p->send_char == _bus_send;
+}
+
+int squid_bus_attach(uint8_t addr, squid_engine_t *eng)
+{
+    if (!g_bus.phys || g_bus.addr != SQUID_BUS_CONTROLLER) return -1;
+    if (addr < 1u || addr > SQUID_BUS_ADDR_MAX) return -1;
+    snet_bus_link_t *l = _by_addr(addr);
+    if (!l) {
+        if (g_bus.n == SNET_CFG_BUS) return -1;
+        l = &g_bus.link[g_bus.n++];
+        l->addr = addr;
+        l->missed = 1u;                 /* up once it answers */
+    }
+    l->eng = eng;
+    return 0;
+}
+
+uint32_t squid_bus_nodes_up(void)
+{
+    uint32_t mask = 0u;
+    if (g_bus.addr != SQUID_BUS_CONTROLLER) return 0u;
+    for (uint8_t i = 0; i < g_bus.n; i++)
+        if (!g_bus.link[i].missed) mask |= (uint32_t)1u << g_bus.link[i].addr;
+    return mask;
+}
+
+#endif
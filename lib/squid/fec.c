@@ -0,0 +1,187 @@
+/* lib/squid/fec.c – in-frame forward error correction (SNET_FEAT_FEC).
+ *
+ * Coded frames give up the last 4 payload bytes to Reed-Solomon parity
+ * over GF(256) (poly 0x11D, roots a^0..a^3).  The codeword is bytes
+ * 1..17: CHLEN, CTRL, 11 payload bytes and the parity, so any 2 damaged
+ * bytes among them are repaired on receipt instead of costing a resend.
+ * HSH and ETX stay as in plain frames; a bad one counts against the
+ * same 2-byte budget, and HSH still guards the corrected result.
+ * HELLO and HELLO_ACK are never coded: features are not agreed yet.
+ *
+ * Decoding is Peterson's method for t = 2 with a Chien search over the
+ * 17 positions: a few hundred table lookups, and only for a damaged
+ * frame.  Clean frames cost four syndrome passes.
+ */
+#include "internal.h"
+
+#if SNET_CFG_FEC
+
+#define F_CTRL  2
+#define F_HSH   (SNET_FRAME_BYTES - 2)
+#define F_ETX   (SNET_FRAME_BYTES - 1)
+#define CW      1u                          /* codeword starts at CHLEN */
+#define CW_LEN  (SNET_FRAME_BYTES - 3u)     /* 17 bytes */
+#define CW_DATA (CW_LEN - SNET_FEC_PARITY)  /* 13 bytes */
+
+static const uint8_t s_exp[255] = {
+    0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1D, 0x3A, 0x74, 0xE8,
+    0xCD, 0x87, 0x13, 0x26, 0x4C, 0x98, 0x2D, 0x5A, 0xB4, 0x75, 0xEA, 0xC9,
+    0x8F, 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0xC0, 0x9D, 0x27, 0x4E, 0x9C,
+    0x25, 0x4A, 0x94, 0x35, 0x6A, 0xD4, 0xB5, 0x77, 0xEE, 0xC1, 0x9F, 0x23,
+    0x46, 0x8C, 0x05, 0x0A, 0x14, 0x28, 0x50, 0xA0, 0x5D, 0xBA, 0x69, 0xD2,
+    0xB9, 0x6F, 0xDE, 0xA1, 0x5F, 0xBE, 0x61, 0xC2, 0x99, 0x2F, 0x5E, 0xBC,
+    0x65, 0xCA, 0x89, 0x0F, 0x1E, 0x3C, 0x78, 0xF0, 0xFD, 0xE7, 0xD3, 0xBB,
+    0x6B, 0xD6, 0xB1, 0x7F, 0xFE, 0xE1, 0xDF, 0xA3, 0x5B, 0xB6, 0x71, 0xE2,
+    0xD9, 0xAF, 0x43, 0x86, 0x11, 0x22, 0x44, 0x88, 0x0D, 0x1A, 0x34, 0x68,
+    0xD0, 0xBD, 0x67, 0xCE, 0x81, 0x1F, 0x3E, 0x7C, 0xF8, 0xED, 0xC7, 0x93,
+    0x3B, 0x76, 0xEC, 0xC5, 0x97, 0x33, 0x66, 0xCC, 0x85, 0x17, 0x2E, 0x5C,
+    0xB8, 0x6D, 0xDA, 0xA9, 0x4F, 0x9E, 0x21, 0x42, 0x84, 0x15, 0x2A, 0x54,
+    0xA8, 0x4D, 0x9A, 0x29, 0x52, 0xA4, 0x55, 0xAA, 0x49, 0x92, 0x39, 0x72,
+    0xE4, 0xD5, 0xB7, 0x73, 0xE6, 0xD1, 0xBF, 0x63, 0xC6, 0x91, 0x3F, 0x7E,
+    0xFC, 0xE5, 0xD7, 0xB3, 0x7B, 0xF6, 0xF1, 0xFF, 0xE3, 0xDB, 0xAB, 0x4B,
+    0x96, 0x31, 0x62, 0xC4, 0x95, 0x37, 0x6E, 0xDC, 0xA5, 0x57, 0xAE, 0x41,
+    0x82, 0x19, 0x32, 0x64, 0xC8, 0x8D, 0x07, 0x0E, 0x1C, 0x38, 0x70, 0xE0,
+    0xDD, 0xA7, 0x53, 0xA6, 0x51, 0xA2, 0x59, 0xB2, 0x79, 0xF2, 0xF9, 0xEF,
+    0xC3, 0x9B, 0x2B, 0x56, 0xAC, 0x45, 0x8A, 0x09, 0x12, 0x24, 0x48, 0x90,
+    0x3D, 0x7A, 0xF4, 0xF5, 0xF7, 0xF3, 0xFB, 0xEB, 0xCB, 0x8B, 0x0B, 0x16,
+    0x2C, 0x58, 0xB0, 0x7D, 0xFA, 0xE9, 0xCF, 0x83, 0x1B, 0x36, 0x6C, 0xD8,
+    0xAD, 0x47, 0x8E
+};
+static const uint8_t s_log[256] = {
+    0x00, 0x00, 0x01, 0x19, 0x02, 0x32, 0x1A, 0xC6, 0x03, 0xDF, 0x33, 0xEE,
+    0x1B, 0x68, 0xC7, 0x4B, 0x04, 0x64, 0xE0, 0x0E, 0x34, 0x8D, 0xEF, 0x81,
+    0x1C, 0xC1, 0x69, 0xF8, 0xC8, 0x08, 0x4C, 0x71, 0x05, 0x8A, 0x65, 0x2F,
+    0xE1, 0x24, 0x0F, 0x21, 0x35, 0x93, 0x8E, 0xDA, 0xF0, 0x12, 0x82, 0x45,
+    0x1D, 0xB5, 0xC2, 0x7D, 0x6A, 0x27, 0xF9, 0xB9, 0xC9, 0x9A, 0x09, 0x78,
+    0x4D, 0xE4, 0x72, 0xA6, 0x06, 0xBF, 0x8B, 0x62, 0x66, 0xDD, 0x30, 0xFD,
+    0xE2, 0x98, 0x25, 0xB3, 0x10, 0x91, 0x22, 0x88, 0x36, 0xD0, 0x94, 0xCE,
+    0x8F, 0x96, 0xDB, 0xBD, 0xF1, 0xD2, 0x13, 0x5C, 0x83, 0x38, 0x46, 0x40,
+    0x1E, 0x42, 0xB6, 0xA3, 0xC3, 0x48, 0x7E, 0x6E, 0x6B, 0x3A, 0x28, 0x54,
+    0xFA, 0x85, 0xBA, 0x3D, 0xCA, 0x5E, 0x9B, 0x9F, 0x0A, 0x15, 0x79, 0x2B,
+    0x4E, 0xD4, 0xE5, 0xAC, 0x73, 0xF3, 0xA7, 0x57, 0x07, 0x70, 0xC0, 0xF7,
+    0x8C, 0x80, 0x63, 0x0D, 0x67, 0x4A, 0xDE, 0xED, 0x31, 0xC5, 0xFE, 0x18,
+    0xE3, 0xA5, 0x99, 0x77, 0x26, 0xB8, 0xB4, 0x7C, 0x11, 0x44, 0x92, 0xD9,
+    0x23, 0x20, 0x89, 0x2E, 0x37, 0x3F, 0xD1, 0x5B, 0x95, 0xBC, 0xCF, 0xCD,
+    0x90, 0x87, 0x97, 0xB2, 0xDC, 0xFC, 0xBE, 0x61, 0xF2, 0x56, 0xD3, 0xAB,
+    0x14, 0x2A, 0x5D, 0x9E, 0x84, 0x3C, 0x39, 0x53, 0x47, 0x6D, 0x41, 0xA2,
+    0x1F, 0x2D, 0x43, 0xD8, 0xB7, 0x7B, 0xA4, 0x76, 0xC4, 0x17, 0x49, 0xEC,
+    0x7F, 0x0C, 0x6F, 0xF6, 0x6C, 0xA1, 0x3B, 0x52, 0x29, 0x9D, 0x55, 0xAA,
+    0xFB, 0x60, 0x86, 0xB1, 0xBB, 0xCC, 0x3E, 0x5A, 0xCB, 0x59, 0x5F, 0xB0,
+    0x9C, 0xA9, 0xA0, 0x51, 0x0B, 0xF5, 0x16, 0xEB, 0x7A, 0x75, 0x2C, 0xD7,
+    0x4F, 0xAE, 0xD5, 0xE9, 0xE6, 0xE7, 0xAD, 0xE8, 0x74, 0xD6, 0xF4, 0xEA,
+    0xA8, 0x50, 0x58, 0xAF
+};
+
+/* x^4 + 0x0F x^3 + 0x36 x^2 + 0x78 x + 0x40 */
+static const uint8_t s_gen[SNET_FEC_PARITY] = { 0x0F, 0x36, 0x78, 0x40 };
+
+static uint8_t _mul(uint8_t a, uint8_t b)
+{
+    if (!a || !b) return 0u;
+    uint16_t s = (uint16_t)(s_log[a] + s_log[b]);
+    return s_exp[s >= 255u ? s - 255u : s];
+}
+
+static uint8_t _div(uint8_t a, uint8_t b)      /* b != 0 */
+{
+    if (!a) return 0u;
+    uint16_t s = (uint16_t)(s_log[a] + 255u - s_log[b]);
+    return s_exp[s >= 255u ? s - 255u : s];
+}
+
+/* S_j = c(a^j); returns true when all four are zero */
+static bool _syndromes(const uint8_t *c, uint8_t *s)
+{
+    uint8_t any = 0;
+    for (uint8_t j = 0; j < SNET_FEC_PARITY; j++) {
+        uint8_t v = 0, r = s_exp[j];
+        for (uint8_t i = 0; i < CW_LEN; i++) v = (uint8_t)(_mul(v, r) ^ c[i]);
+        s[j] = v;
+        any |= v;
+    }
+    return any == 0u;
+}
+
+/* position of locator X = a^(CW_LEN-1-i), or -1 outside the codeword */
+static int8_t _pos(uint8_t x)
+{
+    uint8_t p = s_log[x];
+    return (p < CW_LEN) ? (int8_t)(CW_LEN - 1u - p) : (int8_t)-1;
+}
+
+/* repair up to 2 bytes of c; returns bytes changed, -1 = beyond the code */
+static int8_t _decode(uint8_t *c)
+{
+    uint8_t s[SNET_FEC_PARITY];
+    if (_syndromes(c, s)) return 0;
+    if (!s[0] && !s[1]) return -1;
+
+    uint8_t det = (uint8_t)(_mul(s[1], s[1]) ^ _mul(s[0], s[2]));
+    if (!det) {
+        /* one error: S_j = Y X^j */
+        if (!s[0] || !s[1]) return -1;
+        uint8_t x = _div(s[1], s[0]);
+        if (_mul(s[1], x) != s[2] || _mul(s[2], x) != s[3]) return -1;
+        int8_t i = _pos(x);
+        if (i < 0) return -1;
+        c[i] ^= s[0];
+        return 1;
+    }
+
+    /* two errors: X1, X2 are the roots of x^2 + l1 x + l2 */
+    uint8_t l1 = _div((uint8_t)(_mul(s[1], s[2]) ^ _mul(s[0], s[3])), det);
+    uint8_t l2 = _div((uint8_t)(_mul(s[1], s[3]) ^ _mul(s[2], s[2])), det);
+    uint8_t x[2], n = 0;
+    for (uint8_t p = 0; p < CW_LEN && n < 2u; p++) {
+        uint8_t v = s_exp[p];
+        if ((uint8_t)(_mul(v, v) ^ _mul(l1, v) ^ l2) == 0u) x[n++] = v;
+    }
+    if (n != 2u) return -1;
+
+    /* S0 = Y1 + Y2, S1 = Y1 X1 + Y2 X2 */
+    uint8_t y1 = _div((uint8_t)(s[1] ^ _mul(s[0], x[1])), (uint8_t)(x[0] ^ x[1]));
+    uint8_t y2 = (uint8_t)(s[0] ^ y1);
+    c[_pos(x[0])] ^= y1;
+    c[_pos(x[1])] ^= y2;
+    return 2;
+}
+
+void snet_fec_encode(uint8_t *frame)
+{
+    uint8_t *c = &frame[CW];
+    uint8_t r[SNET_FEC_PARITY] = { 0 };
+    for (uint8_t i = 0; i < CW_DATA; i++) {
+        uint8_t fb = (uint8_t)(c[i] ^ r[0]);
+        for (uint8_t k = 0; k + 1u < SNET_FEC_PARITY; k++)
+            r[k] = (uint8_t)(r[k + 1u] ^ _mul(fb, s_gen[k]));
+        r[SNET_FEC_PARITY - 1u] = _mul(fb, s_gen[SNET_FEC_PARITY - 1u]);
+    }
+    memcpy(&c[CW_DATA], r, SNET_FEC_PARITY);
+}
+
+const uint8_t *snet_fec_rx(const uint8_t *frame, bool plain_ok)
+{
+    uint8_t s[SNET_FEC_PARITY];
+    if (plain_ok) {
+        if (SNET_GET_TYP(frame[F_CTRL]) <= SNET_TYP_HELLO_ACK) return frame;
+        if (_syndromes(&frame[CW], s))
+            return (SNET_GET_LEN(frame[CW]) <= SNET_PAY_FEC) ? frame : (const uint8_t*)0;
+        /* damage the XOR hash cannot see: repair it below */
+    }
+
+    uint8_t *f = g_snet.rx_buf;
+    if (frame != f) memcpy(f, frame, SNET_FRAME_BYTES);
+    int8_t fixed = _decode(&f[CW]);
+    if (fixed < 0) return (const uint8_t*)0;
+    if (f[F_ETX] != SNET_ETX) fixed++;
+    if (snet_frame_hash(f) != f[F_HSH]) fixed++;
+    if (fixed > 2) return (const uint8_t*)0;    /* past what the code vouches for */
+    if (SNET_GET_TYP(f[F_CTRL]) <= SNET_TYP_HELLO_ACK) return (const uint8_t*)0;
+    if (SNET_GET_LEN(f[CW]) > SNET_PAY_FEC) return (const uint8_t*)0;
+    f[F_HSH] = snet_frame_hash(f);
+    f[F_ETX] = SNET_ETX;
+    if (fixed) snet_line_error();       /* a long frame would have been lost */
+    return f;
+}
+
+#endif
@@ -1,36 +1,55 @@
 /* lib/squid/init.c */
 #include "internal.h"   /* provides g_snet context, types, and state enums */
 
-/* global engine context (single instance) */
+/* engine context: built-in instance + the one in use */
+#ifdef SNET_MULTI_CTX
+static snet_ctx_t s_builtin;
+SNET_TLS snet_ctx_t *g_snet_cur = &s_builtin;
+#else
 snet_ctx_t g_snet;
+static snet_ctx_t  s_builtin;       /* built-in state while swapped out */
+static snet_ctx_t *s_using;         /* context whose state is in g_snet */
+#endif
 
-/* free all dynamic channels and their queued nodes (used on re-init) */
+/* session token source: differs per snet_init call, mixed with the tick */
+static SNET_TLS uint16_t s_sess_seed;
+
+static uint16_t _new_session(void)
+{
+    s_sess_seed = (uint16_t)(s_sess_seed * 25173u + 13849u +
+                             g_snet.plat->get_tick());
+    return s_sess_seed ? s_sess_seed : 1u;          /* 0 means "none" */
+}
+
+/* free all sockets and their queued blocks (used on re-init) */
 static void _free_all_channels(void)
 {
     snet_chan_t *c = g_snet.chan_head;
     while (c) {
-        snet_node_t *n = c->tx_head;                 /* drop TX queue */
-        while (n) { snet_node_t *nx = n->next; g_snet.plat->free(n); n = nx; }
-        n = c->rx_head;                              /* drop RX queue */
-        while (n) { snet_node_t *nx = n->next; g_snet.plat->free(n); n = nx; }
-        snet_chan_t *nextc = c->next;                /* unlink channel */
-        g_snet.plat->free(c);
+        snet_chan_t *nextc = c->next;
+        snet_q_clear(&c->txq, &c->tx_bytes);         /* drop queues */
+        snet_q_clear(&c->rxq, &c->rx_bytes);
+#if !SNET_CFG_STATIC
+        g_snet.plat->free(c);                        /* unlink channel */
+#endif
         c = nextc;
     }
     g_snet.chan_head  = (snet_chan_t*)0;             /* allocator reset */
-    g_snet.fd_mask    = 0u;
-    g_snet.ch_mask    = 0u;
-    g_snet.rr_last_id = 0xFFu;
+    memset(g_snet.fd_sock, 0, sizeof(g_snet.fd_sock));
+    memset(g_snet.ch_fd, 0, sizeof(g_snet.ch_fd));
 }
 
 void snet_init(const snet_platform_t *plat, const snet_timing_t *tm)
 {
-    if (g_snet.plat && g_snet.plat->free) _free_all_channels();     /* clean old state */
+    if (g_snet.plat && (SNET_CFG_STATIC || g_snet.plat->free))
+        _free_all_channels();                                       /* clean old state */
     memset(&g_snet, 0, sizeof(g_snet));                             /* hard reset ctx */
 
     g_snet.plat = plat;                                             /* install hooks */
-    if (!plat || !plat->send_char || !plat->recv_char ||            /* validate req */
-        !plat->get_tick || !plat->malloc || !plat->free) {
+    if (!plat || !plat->send_char ||                                /* validate req */
+        (!SNET_CFG_ISR_RING && !plat->recv_char) ||
+        !plat->get_tick ||
+        (!SNET_CFG_STATIC && (!plat->malloc || !plat->free))) {
         g_snet.eng = SNET_ENG_DISCONNECTED;                         /* stay disabled */
         return;
     }
@@ -38,7 +57,9 @@ void snet_init(const snet_platform_t *plat, const snet_timing_t *tm)
     if (tm) {                                                       /* copy timing */
         g_snet.timeout_ticks   = tm->timeout_ticks;
         g_snet.ack_delay_ticks = tm->ack_delay_ticks;
+#if SNET_CFG_KEEPALIVE
         g_snet.ping_ticks      = tm->ping_ticks;
+#endif
         g_snet.max_retries     = tm->max_retries;
     }
     if (!g_snet.timeout_ticks)   g_snet.timeout_ticks   = 6u;       /* fill defaults */
@@ -51,14 +72,47 @@ void snet_init(const snet_platform_t *plat, const snet_timing_t *tm)
     g_snet.seq_expect  = 0u;
     g_snet.retries     = 0u;
     g_snet.last_tx_tick   = 0u;                                     /* timers clear */
+#if SNET_CFG_KEEPALIVE
     g_snet.last_ping_tick = 0u;
+#endif
     g_snet.ack_needed  = 0u;                                        /* no pending ACK */
     g_snet.ack_wait    = 0u;
+    g_snet.rx_busy     = 0u;
     g_snet.link_up     = 0u;                                        /* handshake not done */
+    g_snet.feat_local  = 0u;                                        /* plain protocol */
+    g_snet.feat        = 0u;
+    g_snet.sess_id     = _new_session();                            /* new session */
+    g_snet.sess_peer   = 0u;                                        /* peer unknown */
+    g_snet.tx_pending  = 0u;
+    g_snet.resumed     = 0u;
+    g_snet.peer_heard  = 0u;
 
     g_snet.chan_head   = (snet_chan_t*)0;                           /* no channels yet */
-    g_snet.fd_mask     = 0u;
-    g_snet.ch_mask     = 0u;
-    g_snet.rr_last_id  = 0xFFu;
-    /* g_snet.last_sent[] already zero from memset */
+    /* fd_sock[], ch_fd[], rr_next and last_sent[] already zero from memset */
+}
+
+size_t snet_engine_size(void)
+{
+    return sizeof(snet_ctx_t);
+}
+
+void snet_engine_use(squid_engine_t *eng)
+{
+#ifdef SNET_MULTI_CTX
+    g_snet_cur = eng ? eng : &s_builtin;                            /* select */
+#else
+    if (eng == s_using) return;
+    memcpy(s_using ? s_using : &s_builtin, &g_snet, sizeof(g_snet)); /* park */
+    memcpy(&g_snet, eng ? eng : &s_builtin, sizeof(g_snet));        /* load */
+    s_using = eng;
+#endif
+}
+
+squid_engine_t *snet_engine_current(void)
+{
+#ifdef SNET_MULTI_CTX
+    return (g_snet_cur == &s_builtin) ? (snet_ctx_t*)0 : g_snet_cur;
+#else
+    return s_using;
+#endif
 }
@@ -4,6 +4,7 @@
 #include <string.h>
 
 #include "squid/snet.h"   /* snet_platform_t, snet_timing_t, engine APIs */
+#include "squid/socket.h" /* squid_iovec_t, SNET_CFG_* */
 
 /* ---- on-wire fixed constants (private) ---- */
 #define SNET_STX           ((uint8_t)0x7E)
@@ -11,12 +12,14 @@
 #define SNET_FRAME_BYTES   ((uint8_t)20)
 #define SNET_PAY_MAX       ((uint8_t)15)
 
-/* CTRL (byte 2): TYP(7..5) | STS(4) | SEQ(3) | RES(2..0) */
+/* CTRL (byte 2): TYP(7..5) | STS(4) | SEQ(3) | ACK(2) | ASEQ(1) | RES(0) */
 #define SNET_CTRL_TYP_SHIFT 5u
 #define SNET_CTRL_TYP_MASK  ((uint8_t)(0x07u << SNET_CTRL_TYP_SHIFT))
-#define SNET_CTRL_STS_MASK  ((uint8_t)0x10u) /* 0=ACK, 1=NAK */
+#define SNET_CTRL_STS_MASK  ((uint8_t)0x10u) /* 0=ACK, 1=NAK (receiver busy) */
 #define SNET_CTRL_SEQ_MASK  ((uint8_t)0x08u) /* alternating bit */
-#define SNET_CTRL_RES_MASK  ((uint8_t)0x07u)
+#define SNET_CTRL_ACK_MASK  ((uint8_t)0x04u) /* frame acknowledges ASEQ */
+#define SNET_CTRL_ASEQ_MASK ((uint8_t)0x02u) /* seq of last accepted DATA */
+#define SNET_CTRL_RES_MASK  ((uint8_t)0x01u)
 
 /* CHLEN (byte 1): CH(7..4) | LEN(3..0) */
 #define SNET_CH_SHIFT 4u
@@ -29,10 +32,103 @@
 #define SNET_TYP_DATA      2u  /* application data */
 #define SNET_TYP_ACK       3u  /* acknowledgment only (no payload) */
 #define SNET_TYP_PING      4u  /* keepalive */
+#define SNET_TYP_LDATA     5u  /* DATA with a length byte (SNET_FEAT_LONG) */
+#define SNET_TYP_SHORT     6u  /* 5-byte ACK or PING (SNET_FEAT_SHORT) */
 
 /* ---- SYS channel ---- */
 #define SNET_CH_SYS        0u
 
+/* ---- extended channels (SNET_FEAT_XCH) ----
+ * CH 15 in CHLEN (frame or pack record) means the channel id is the
+ * next byte: first payload byte of a frame, the byte after a record's
+ * CHLEN.  LEN / N count it.  Ids 1..14 keep the 4-bit field. */
+#define SNET_CH_EXT        15u
+#define SNET_XCH_ON()      ((g_snet.feat & SNET_FEAT_XCH) != 0u)
+#define SNET_CH_ESC(id)    ((id) >= SNET_CH_EXT && SNET_XCH_ON())
+
+/* features that change how a frame is laid out: a resumed session
+ * resends last_sent, so it needs them unchanged */
+#define SNET_FEAT_FRAMING  (SNET_FEAT_FEC | SNET_FEAT_LONG | SNET_FEAT_XCH)
+
+/* ---- HELLO / HELLO_ACK payload ---- */
+#define SNET_HELLO_FEAT    0u  /* offered SNET_FEAT_* bits */
+#define SNET_HELLO_SESS    1u  /* our session token (2 bytes, LE) */
+#define SNET_HELLO_PEER    3u  /* peer token we remember, 0 = none (2 bytes) */
+#define SNET_HELLO_SEQ     5u  /* SNET_HSEQ_* bits */
+#define SNET_HELLO_LEN     6u  /* shortest HELLO with a session */
+#define SNET_HELLO_LONG    6u  /* largest long payload we take, 0 = none */
+#define SNET_HELLO_RATE    7u  /* TX pacing we ask for: bytes per tick, 0 = none */
+#define SNET_HELLO_GAP     8u  /* ... and idle ticks between frames */
+#define SNET_HELLO_FULL    9u
+
+#define SNET_HSEQ_TX       0x01u  /* seq_tx */
+#define SNET_HSEQ_EXPECT   0x02u  /* seq_expect */
+#define SNET_HSEQ_PENDING  0x04u  /* last_sent holds DATA not yet ACKed */
+#define SNET_HSEQ_RESUMED  0x08u  /* HELLO_ACK only: responder resumed */
+
+/* ---- packed DATA (SNET_FEAT_PACK) ----
+ * A DATA frame on SNET_CH_SYS carries records of [CHLEN][data...],
+ * CHLEN as in byte 1 with LEN 1..14.  A LEN of 0 ends the list. */
+#define SNET_REC_HDR       1u
+
+/* ---- coded frames (SNET_FEAT_FEC) ----
+ * DATA, ACK and PING carry RS parity in the last 4 payload bytes. */
+#define SNET_FEC_PARITY    4u
+#define SNET_PAY_FEC       ((uint8_t)(SNET_PAY_MAX - SNET_FEC_PARITY))
+
+/* ---- long DATA (SNET_FEAT_LONG) ----
+ * [STX][CHLEN][CTRL][N][payload N][CRC lo][CRC hi][ETX]: CHLEN's LEN
+ * is 0, N is 1..SNET_CFG_LONG, CRC-16/CCITT covers CHLEN..payload.
+ * Long frames carry no FEC parity. */
+#define SNET_LONG_N        3u   /* offset of N */
+#define SNET_LONG_PAY      4u   /* offset of the payload */
+#define SNET_LONG_EXTRA    7u   /* frame bytes besides the payload */
+#define SNET_SIZE_BAD      0xFFu
+
+/* ---- short control frames (SNET_FEAT_SHORT) ----
+ * [STX][KIND][CTRL][HSH][ETX]: KIND is the full type (ACK or PING),
+ * CTRL has TYP 6 and the usual flags, HSH is KIND ^ CTRL.  Parsed
+ * whether or not the feature was negotiated. */
+#define SNET_SHORT_KIND    1u
+#define SNET_SHORT_HSH     3u
+#define SNET_SHORT_BYTES   ((uint8_t)5)
+#define SNET_SHORT_ON()    ((g_snet.feat & SNET_FEAT_SHORT) != 0u)
+
+#if SNET_CFG_LONG
+#define SNET_FRAME_MAX     ((uint8_t)(SNET_CFG_LONG + SNET_LONG_EXTRA))
+/* long payload limit agreed in the handshake, 0 = short frames only */
+#define SNET_LONG_MAX()    (g_snet.long_max)
+#else
+#define SNET_FRAME_MAX     SNET_FRAME_BYTES
+#define SNET_LONG_MAX()    0u
+#endif
+
+/* size of the frame starting at f from its first `have` bytes:
+ * 0 = not known yet, SNET_SIZE_BAD = no valid frame starts here */
+static inline uint8_t snet_frame_size(const uint8_t *f, size_t have)
+{
+    if (have <= 2u) return 0u;
+    uint8_t typ = (uint8_t)((f[2] & SNET_CTRL_TYP_MASK) >> SNET_CTRL_TYP_SHIFT);
+    if (typ == SNET_TYP_SHORT) return SNET_SHORT_BYTES;
+#if SNET_CFG_LONG
+    if (typ != SNET_TYP_LDATA) return SNET_FRAME_BYTES;
+    if (have <= SNET_LONG_N) return 0u;
+    uint8_t n = f[SNET_LONG_N];
+    if (n == 0u || n > SNET_CFG_LONG) return SNET_SIZE_BAD;
+    return (uint8_t)(n + SNET_LONG_EXTRA);
+#else
+    return SNET_FRAME_BYTES;
+#endif
+}
+
+/* XOR hash of a 20-byte frame: bytes 1..17, kept in byte 18 */
+static inline uint8_t snet_frame_hash(const uint8_t *f)
+{
+    uint8_t h = 0;
+    for (uint8_t i = 1; i < SNET_FRAME_BYTES - 2u; i++) h ^= f[i];
+    return h;
+}
+
 /* ---- helper macros for frame fields ---- */
 #define SNET_MAKE_CHLEN(ch,len)  ((uint8_t)(((ch) << SNET_CH_SHIFT) | ((len) & SNET_LEN_MASK)))
 #define SNET_MAKE_CTRL(typ,sts,seq) \
@@ -42,6 +138,8 @@
 #define SNET_GET_TYP(ctrl)   (((ctrl) & SNET_CTRL_TYP_MASK) >> SNET_CTRL_TYP_SHIFT)
 #define SNET_GET_STS(ctrl)   (((ctrl) & SNET_CTRL_STS_MASK) ? 1u : 0u)
 #define SNET_GET_SEQ(ctrl)   (((ctrl) & SNET_CTRL_SEQ_MASK) ? 1u : 0u)
+#define SNET_GET_ACK(ctrl)   (((ctrl) & SNET_CTRL_ACK_MASK) ? 1u : 0u)
+#define SNET_GET_ASEQ(ctrl)  (((ctrl) & SNET_CTRL_ASEQ_MASK) ? 1u : 0u)
 #define SNET_GET_CH(chlen)   (((chlen) & SNET_CH_MASK) >> SNET_CH_SHIFT)
 #define SNET_GET_LEN(chlen)  ((chlen) & SNET_LEN_MASK)
 
@@ -53,34 +151,130 @@ typedef enum {
     SNET_ENG_DISCONNECTED
 } snet_eng_state_t;
 
-/* ---- queue node (malloc-backed) ---- */
+/* ---- per-socket byte queue (queue.c) ---- */
+#if SNET_CFG_STATIC
+typedef struct {
+    uint16_t rd;                        /* read index into buf */
+    uint8_t  buf[SNET_CFG_QUEUE_BYTES];
+} snet_queue_t;
+#define SNET_Q_FITS(bytes, len) ((len) <= (uint16_t)(SNET_CFG_QUEUE_BYTES - (bytes)))
+#define SNET_Q_OVERHEAD         0u
+#else
 typedef struct snet_node {
     struct snet_node *next;
     uint16_t len;    /* total bytes in data[] */
     uint16_t off;    /* bytes already consumed */
+    uint8_t  refs;   /* shared RX: subscribers not yet past it */
     uint8_t  data[]; /* flexible array (C99) */
 } snet_node_t;
 
-/* ---- dynamic socket (linked list; <=15 total) ---- */
+typedef struct {
+    snet_node_t *head, *tail;
+} snet_queue_t;
+
+/* a subscriber's place in a shared RX queue; rd == NULL when caught up */
+typedef struct {
+    snet_node_t *rd;
+    uint16_t     off;
+} snet_cursor_t;
+#define SNET_Q_FITS(bytes, len) 1
+#define SNET_Q_OVERHEAD         sizeof(snet_node_t)
+#endif
+
+/* would len more queued bytes (one more block) stay within the budget? */
+#define SNET_MEM_FITS(len) \
+    (!g_snet.budget || g_snet.q_mem + SNET_Q_OVERHEAD + (len) <= g_snet.budget)
+
+/* byte counts live next to the queue so callers can read them cheaply */
+bool     snet_q_put(snet_queue_t *q, uint16_t *bytes,
+                    const squid_iovec_t *iov, uint8_t cnt, uint16_t len);
+uint16_t snet_q_get(snet_queue_t *q, uint16_t *bytes,
+                    const squid_iovec_t *iov, uint8_t cnt);
+void     snet_q_clear(snet_queue_t *q, uint16_t *bytes);
+
+#if !SNET_CFG_STATIC
+/* shared RX (fan-out): one block read through refs cursors, freed once
+ * the last of them is past it */
+snet_node_t *snet_q_put_shared(snet_queue_t *q, const uint8_t *data,
+                               uint16_t len, uint8_t refs);
+uint16_t snet_q_read(snet_queue_t *q, snet_cursor_t *cur, uint16_t *bytes,
+                     const squid_iovec_t *iov, uint8_t cnt);
+void     snet_q_leave(snet_queue_t *q, snet_cursor_t *cur, uint16_t *bytes);
+#endif
+
+/* ---- stream attached to a socket (stream.c) ---- */
+#if SNET_CFG_STREAM
+typedef struct {
+    squid_read_fn  src;             /* TX source, NULL = none */
+    void          *src_ctx;
+    uint32_t       tx_start;        /* offset the source was attached at */
+    uint32_t       tx_off;          /* next byte to read */
+    uint32_t       tx_end;
+    uint32_t       tx_acked;        /* delivered: peer ACKed up to here */
+    uint8_t        tx_flight;       /* source bytes in the unACKed DATA */
+    int8_t         tx_err;          /* source failed or session lost */
+    squid_write_fn sink;            /* RX sink, NULL = RX queue */
+    void          *sink_ctx;
+    uint32_t       rx_off;          /* next offset handed to the sink */
+    int8_t         rx_err;
+} snet_stream_t;
+#endif
+
+/* ---- socket (linked list; heap-allocated or from the static pool) ---- */
 typedef struct snet_chan {
     struct snet_chan *next;
-    uint8_t  fd;                    /* local handle: 1..15 */
-    uint8_t  ch_id;                 /* bound channel: 1..15, 0 when unbound */
-    snet_node_t *tx_head, *tx_tail; /* app -> wire */
-    snet_node_t *rx_head, *rx_tail; /* wire -> app */
+    uint8_t  fd;                    /* local handle: 1..SNET_CFG_CHANNELS */
+    uint8_t  ch_id;                 /* bound channel: 1..SNET_CFG_CH_MAX, 0 when unbound */
+    snet_queue_t txq;               /* app -> wire */
+    snet_queue_t rxq;               /* wire -> app */
     uint16_t  tx_bytes, rx_bytes;   /* queued bytes */
     uint16_t  tx_cap,  rx_cap;      /* 0 = unlimited (optional caps) */
+    uint16_t  tx_lowat;             /* writable callback at or below this */
+    uint16_t  tx_want;              /* refused send length, 0 = not blocked */
+    uint32_t  tx_queued;            /* offset past the last queued byte */
+    uint32_t  tx_done;              /* offset past the last ACKed (or lost) byte */
+    uint32_t  tx_confirm;           /* newest ticket, open while past tx_done */
+    uint32_t  tx_lost_lo, tx_lost_hi;   /* tickets in (lo, hi] may be lost */
+    uint8_t   tx_flight;            /* queued bytes in the unACKed DATA */
+    uint8_t   tx_notify;            /* delivered callback due */
+    uint8_t   sub;                  /* subscribed: shares the channel's RX */
+    struct snet_chan *sub_next;     /* next subscriber of the channel */
+#if !SNET_CFG_STATIC
+    snet_cursor_t rx_cur;           /* subscriber: place in the leader's rxq */
+#endif
+#if SNET_CFG_STREAM
+    snet_stream_t st;
+#endif
 } snet_chan_t;
 
-/* ---- global engine context (single instance) ---- */
+/* anything to send: queued bytes first, then the stream source */
+#if SNET_CFG_STREAM
+#define SNET_TX_AVAIL(c) ((c)->tx_bytes || \
+    ((c)->st.src && !(c)->st.tx_err && (c)->st.tx_off != (c)->st.tx_end))
+#else
+#define SNET_TX_AVAIL(c) ((c)->tx_bytes != 0u)
+#endif
+
+/* ---- profiling (prof.c) ---- */
+#if SNET_CFG_PROFILE
+#define SNET_PROF_BUCKETS 16u   /* bucket b: durations of bit length b */
 typedef struct {
+    uint32_t count, max;
+    uint32_t bucket[SNET_PROF_BUCKETS];
+} snet_prof_hist_t;
+#endif
+
+/* ---- engine context ---- */
+typedef struct snet_ctx {
     /* platform hooks */
     const snet_platform_t *plat;
 
     /* timing (ticks) */
     uint8_t timeout_ticks;
     uint8_t ack_delay_ticks;
+#if SNET_CFG_KEEPALIVE
     uint8_t ping_ticks;
+#endif
     uint8_t max_retries;
 
     /* FSM */
@@ -89,24 +283,271 @@ typedef struct {
     uint8_t seq_expect;     /* seq we expect to receive next (0/1) */
     uint8_t retries;
     uint8_t last_tx_tick;
+#if SNET_CFG_KEEPALIVE
     uint8_t last_ping_tick;
-    uint8_t ack_needed;     /* we owe ACK for last accepted DATA */
+#endif
+    uint8_t ack_needed;     /* we owe ACK for last accepted DATA (coalesced) */
     uint8_t ack_wait;       /* ticks since we started owing ACK */
+    uint8_t rx_busy;        /* last DATA refused at rx_cap: ACKs carry STS=1 */
     uint8_t link_up;        /* set after HELLO/HELLO_ACK */
+    uint8_t feat_local;     /* SNET_FEAT_* we offer in HELLO */
+    uint8_t feat;           /* negotiated SNET_FEAT_* (local & peer) */
+#if SNET_CFG_LONG
+    uint8_t long_max;       /* negotiated long payload limit, 0 = none */
+    uint8_t tx_pay;         /* DATA payload limit now, adapts to errors */
+    uint8_t clean_acks;     /* DATA ACKed since the last line error */
+#endif
+    /* TX pacing: ours (snet_set_pace), the peer's (HELLO), the stricter
+       of the two in force; a frame starts once credit is positive and
+       tx_gap ticks passed since the last one ended */
+    uint8_t pace_rate, pace_gap;
+    uint8_t peer_rate, peer_gap;
+    uint8_t tx_rate, tx_gap;
+    int16_t pace_credit;    /* bytes; each frame takes its size */
+    uint8_t pace_tick;      /* last credit refill */
+    uint8_t pace_end;       /* tick the last frame was out */
+    uint8_t pace_wait;      /* tx_gap since pace_end still running */
+
+    /* session (tokens always exchanged; resume needs SNET_FEAT_RESUME) */
+    uint16_t sess_id;       /* our token, new on every snet_init */
+    uint16_t sess_peer;     /* peer token from the last handshake, 0 = none */
+    uint8_t  tx_pending;    /* last_sent holds DATA not yet ACKed */
+    uint8_t  resumed;       /* last handshake kept seq state and last_sent */
+    uint8_t  peer_heard;    /* non-HELLO frame seen since the handshake */
 
     /* last-sent frame (for resend on timeout) */
-    uint8_t last_sent[SNET_FRAME_BYTES];
+    uint8_t last_sent[SNET_FRAME_MAX];
 
     /* RX assembly buffer */
-    uint8_t rx_buf[SNET_FRAME_BYTES];
+    uint8_t rx_buf[SNET_FRAME_MAX];
     uint8_t rx_pos;             /* next write position in rx_buf */
+#if SNET_CFG_ISR_RING
+    /* interrupt RX ring: free-running 8-bit indices, one writer each */
+    volatile uint8_t isr_head;  /* written by snet_rx_isr_push() */
+    volatile uint8_t isr_tail;  /* written by _rx */
+    uint8_t isr_buf[SNET_CFG_ISR_RING];
+#endif
+
+    /* output buffer: tx_out[tx_pos..tx_len) not yet taken by send_char
+       or snet_tx_pull(); a new frame waits until it is empty */
+    uint8_t tx_out[SNET_FRAME_MAX];
+    volatile uint8_t tx_len;    /* written by the engine */
+    volatile uint8_t tx_pos;    /* written by the taker while tx_pos < tx_len */
+    uint8_t tx_moved;           /* tick send_char last took a byte */
+    uint8_t tx_timed;           /* frame restarts last_tx_tick once out */
+    uint8_t tx_open;            /* tx_out holds a frame not yet seen out */
+    void  (*tx_ready)(void);    /* snet_on_tx_ready(), NULL = send_char */
 
-    /* dynamic sockets + allocator */
+    /* sockets + allocator */
     snet_chan_t *chan_head; /* forward list of open sockets */
-    uint16_t     fd_mask;   /* bit i set => fd i in use (1..15) */
-    uint16_t     ch_mask;   /* bit i set => channel i in use (1..15) */
-    uint8_t      rr_last_id;/* last channel served for round-robin (0xFF = none) */
+    snet_chan_t *fd_sock[SNET_CFG_CHANNELS + 1];  /* fd -> socket, NULL = free */
+    uint8_t      ch_fd[SNET_CFG_CH_MAX + 1];     /* channel -> bound fd, 0 = none */
+    uint32_t     q_mem;     /* bytes held by all queues, headers included */
+    uint32_t     budget;    /* limit for q_mem, 0 = unlimited */
+    uint8_t      tx_blocked;/* sockets with tx_want set */
+    uint8_t      tx_notify; /* some socket has tx_notify set */
+    squid_writable_fn  on_writable;
+    void              *writable_arg;
+    squid_delivered_fn on_delivered;
+    void              *delivered_arg;
+#if SNET_CFG_RR
+    snet_chan_t *rr_next;   /* socket round-robin tries first, NULL = list head */
+#endif
+#if SNET_CFG_STATIC
+    snet_chan_t  chan_pool[SNET_CFG_CHANNELS];  /* fd i uses chan_pool[i-1] */
+#endif
+#if SNET_CFG_PROFILE
+    uint32_t   (*prof_now)(void);
+    snet_prof_hist_t prof[SNET_PROF_N];
+#endif
 } snet_ctx_t;
 
-/* single global instance (defined in init.c) */
-extern snet_ctx_t g_snet;
+/* The engine works on g_snet.  In the default build that is one global
+ * instance and snet_engine_use() swaps other contexts in and out of it.
+ * With SNET_MULTI_CTX (the squid_mt library) g_snet names the context
+ * the calling thread selected, so threads drive engines independently. */
+#ifdef SNET_MULTI_CTX
+#define SNET_TLS __thread
+extern SNET_TLS snet_ctx_t *g_snet_cur;
+#define g_snet (*g_snet_cur)
+#else
+#define SNET_TLS
+extern snet_ctx_t g_snet;           /* defined in init.c */
+#endif
+
+/* ---- probes: SNET_PROF_BEGIN(t); ...; SNET_PROF_END(SNET_PROF_X, t); ---- */
+#if SNET_CFG_PROFILE
+void snet_prof_add(uint8_t probe, uint32_t start);
+#define SNET_PROF_BEGIN(t) \
+    uint32_t t = g_snet.prof_now ? g_snet.prof_now() : 0u
+#define SNET_PROF_END(probe, t) \
+    do { if (g_snet.prof_now) snet_prof_add((probe), (t)); } while (0)
+#else
+#define SNET_PROF_BEGIN(t)      do { } while (0)
+#define SNET_PROF_END(probe, t) do { } while (0)
+#endif
+
+/* ---- indices shared with an ISR (RX ring, tx_out): publish data
+ * before the index ---- */
+#if defined(__GNUC__)
+#define SNET_ISR_LOAD(p)     __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define SNET_ISR_STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#else
+#define SNET_ISR_LOAD(p)     (*(p))     /* single-core targets: volatile */
+#define SNET_ISR_STORE(p, v) (*(p) = (v))
+#endif
+#if SNET_CFG_ISR_RING
+#define SNET_ISR_MASK        ((uint8_t)(SNET_CFG_ISR_RING - 1u))
+#endif
+
+/* ---- TX pacing in force: lowest rate, longest gap (0 = none) ---- */
+static inline void snet_pace_update(void)
+{
+    uint8_t r = g_snet.pace_rate, pr = g_snet.peer_rate;
+    g_snet.tx_rate = (!r || (pr && pr < r)) ? pr : r;
+    g_snet.tx_gap  = g_snet.pace_gap > g_snet.peer_gap ? g_snet.pace_gap
+                                                       : g_snet.peer_gap;
+    if (g_snet.pace_credit > (int16_t)g_snet.tx_rate)
+        g_snet.pace_credit = (int16_t)g_snet.tx_rate;
+}
+
+/* ---- socket lookup by local fd or wire channel: table reads, no walk.
+ * fd_sock[0] stays NULL, so unbound channels and SYS find nothing. ---- */
+static inline snet_chan_t *snet_sock(int fd)
+{
+    if (fd < 1 || fd > SNET_CFG_CHANNELS) return (snet_chan_t*)0;
+    return g_snet.fd_sock[fd];
+}
+
+static inline snet_chan_t *snet_chan_of(uint8_t ch_id)
+{
+#if SNET_CFG_CH_MAX < 255
+    if (ch_id > SNET_CFG_CH_MAX) return (snet_chan_t*)0;
+#endif
+    return g_snet.fd_sock[g_snet.ch_fd[ch_id]];
+}
+
+/* ---- FEC (fec.c) ---- */
+#if SNET_CFG_FEC
+#define SNET_FEC_ON()   ((g_snet.feat & SNET_FEAT_FEC) != 0u)
+void           snet_fec_encode(uint8_t *frame);    /* fill parity bytes */
+/* frame to handle (frame itself, or repaired in rx_buf), NULL = drop;
+ * plain_ok: ETX and HSH already check out */
+const uint8_t *snet_fec_rx(const uint8_t *frame, bool plain_ok);
+#else
+#define SNET_FEC_ON()   0
+#endif
+#define SNET_PAY_NOW    (SNET_FEC_ON() ? SNET_PAY_FEC : SNET_PAY_MAX)
+
+/* ---- socket events (socket.c) ---- */
+void snet_tx_acked(void);           /* our DATA in flight was delivered */
+void snet_tx_lost(void);            /* fresh session dropped it */
+void snet_socket_events(void);      /* writable / delivered callbacks */
+void snet_fan_rx(snet_chan_t *lead, const uint8_t *data, uint8_t len);
+
+/* handle one validated frame: rx_buf or in place (burst.c) */
+void snet_rx_frame(const uint8_t *frame);
+bool snet_short_ok(const uint8_t *f);      /* KIND, HSH and ETX */
+
+/* frame sizing (burst.c): a dropped frame or a resend shrinks the DATA
+ * payload limit, a run of clean ACKs grows it */
+#if SNET_CFG_LONG
+void     snet_line_error(void);
+uint16_t snet_crc16(const uint8_t *p, uint8_t n);
+bool     snet_long_ok(const uint8_t *f, uint8_t size);  /* CRC and ETX */
+#else
+#define snet_line_error() do { } while (0)
+#endif
+
+/* ---- stream engine hooks (stream.c) ---- */
+#if SNET_CFG_STREAM
+uint8_t snet_stream_pull(snet_chan_t *ch, uint8_t *out, uint8_t max);
+void    snet_stream_push(snet_chan_t *ch, const uint8_t *data, uint8_t len);
+void    snet_stream_acked(snet_chan_t *ch);
+void    snet_stream_lost(snet_chan_t *ch);
+#endif
+
+/* ---- bonded links (bond.c, single instance) ---- */
+#define SNET_BOND_MAX      4u
+#define SNET_BOND_WIN      4u   /* reorder window in frames (power of 2) */
+#define SNET_BOND_ENV      ((uint8_t)(1u + SNET_FRAME_BYTES)) /* BSEQ + frame */
+
+typedef struct {
+    uint8_t buf[SNET_BOND_ENV];     /* envelope assembly */
+    uint8_t pos;
+    uint8_t up;                     /* in TX rotation */
+    uint8_t missed;                 /* envelopes on other members since ours */
+    uint8_t tx_buf[SNET_BOND_ENV];  /* envelope a refused byte cut short */
+    uint8_t tx_left;                /* its bytes still to send, 0 = none */
+} snet_bond_link_t;
+
+typedef struct {
+    const snet_platform_t *links;
+    uint8_t n;
+    uint8_t gap_ticks;              /* wait for a missing frame */
+    uint8_t dead_frames;            /* silence that takes a member down */
+    snet_bond_link_t link[SNET_BOND_MAX];
+
+    /* TX: one envelope at a time, round-robin over members */
+    uint8_t tx_env[SNET_BOND_ENV];
+    uint8_t tx_pos;
+    uint8_t tx_seq;
+    uint8_t tx_rr;
+    uint8_t tx_count;               /* frames sent, paces probes */
+
+    /* RX: reorder window, then one frame handed out byte by byte */
+    uint8_t rx_next;                /* next bond sequence to release */
+    uint8_t rx_synced;
+    uint8_t rx_stale;               /* consecutive too-old envelopes */
+    uint8_t hold_mask;              /* bit i => hold[i] valid */
+    uint8_t hold_seq[SNET_BOND_WIN];
+    uint8_t hold[SNET_BOND_WIN][SNET_FRAME_BYTES];
+    uint8_t hold_tick;              /* when the current gap opened */
+    uint8_t out[SNET_FRAME_BYTES];
+    uint8_t out_pos, out_len;
+} snet_bond_t;
+
+extern SNET_TLS snet_bond_t g_bond;
+
+/* platform p is this thread's bond (20-byte envelopes only) */
+bool snet_bond_carries(const snet_platform_t *p);
+
+/* ---- multi-drop bus (bus.c, single instance) ----
+ * Envelope: [HDR][20-byte frame], or HDR alone with SNET_BUS_EMPTY. */
+#if SNET_CFG_BUS
+#define SNET_BUS_ADDR      0x1Fu    /* node address 1..31 */
+#define SNET_BUS_UP        0x20u    /* node -> controller */
+#define SNET_BUS_EMPTY     0x40u    /* no frame follows */
+#define SNET_BUS_TURN      0x80u    /* the turn passes with this envelope */
+#define SNET_BUS_ENV       ((uint8_t)(1u + SNET_FRAME_BYTES))
+#define SNET_BUS_TXQ       2u       /* frames a link holds between turns */
+#define SNET_BUS_RXQ       4u
+
+typedef struct {
+    squid_engine_t *eng;            /* controller: the node's engine */
+    uint8_t addr;
+    uint8_t missed;                 /* turns in a row without an answer */
+    uint8_t tx[SNET_BUS_TXQ][SNET_FRAME_BYTES];
+    uint8_t tx_rd, tx_n, tx_pos;
+    uint8_t rx[SNET_BUS_RXQ][SNET_FRAME_BYTES];
+    uint8_t rx_rd, rx_n, rx_pos;
+} snet_bus_link_t;
+
+typedef struct {
+    const snet_platform_t *phys;
+    uint8_t addr;                   /* ours; 0 = controller */
+    uint8_t n;                      /* links in use */
+    uint8_t turn_ticks;             /* answer time before a turn is taken back */
+    uint8_t turn;                   /* controller: holder (0 = us); node: 1 = ours */
+    uint8_t turn_tick;
+    uint8_t next;                   /* controller: next link to poll */
+    uint8_t env[SNET_BUS_ENV];      /* envelope being received */
+    uint8_t env_pos;
+    snet_bus_link_t link[SNET_CFG_BUS];
+} snet_bus_t;
+
+extern SNET_TLS snet_bus_t g_bus;
+
+/* platform p is this thread's bus (20-byte envelopes only) */
+bool snet_bus_carries(const snet_platform_t *p);
+#endif
@@ -9,7 +9,82 @@ bool snet_link_is_up(void)
      * the peer has not restarted or timed out.  This covers both
      * SNET_ENG_CONNECTED (idle) and SNET_ENG_WAITING (DATA sent,
      * waiting for ACK).  link_up is cleared only by
-     * _set_disconnected() and _peer_restarted().
+     * _set_disconnected() and _peer_restarted(); a HELLO that
+     * resumes the session keeps it set.
      */
     return (g_snet.link_up != 0u);
 }
+
+bool snet_idle(void)
+{
+    /* connected with nothing in flight, no ACK owed and pacing settled
+       (a refill over a long sleep would see a wrapped tick delta) */
+    return g_snet.eng == SNET_ENG_CONNECTED && !g_snet.ack_needed &&
+           !g_snet.pace_wait && g_snet.pace_credit >= (int16_t)g_snet.tx_rate;
+}
+
+void snet_set_features(uint8_t feat)
+{
+    /* takes effect with the next HELLO / HELLO_ACK we send */
+#if !SNET_CFG_FEC
+    feat &= (uint8_t)~SNET_FEAT_FEC;
+#endif
+#if !SNET_CFG_LONG
+    feat &= (uint8_t)~SNET_FEAT_LONG;
+#endif
+#if SNET_CFG_CH_MAX <= 15
+    feat &= (uint8_t)~SNET_FEAT_XCH;
+#endif
+    g_snet.feat_local = feat;
+}
+
+void snet_set_pace(uint8_t rate, uint8_t gap)
+{
+    /* ours applies at once; the peer hears it with the next HELLO */
+    g_snet.pace_rate = rate;
+    g_snet.pace_gap  = gap;
+    snet_pace_update();
+}
+
+uint8_t snet_features(void)
+{
+    return g_snet.link_up ? g_snet.feat : 0u;
+}
+
+#if SNET_CFG_ISR_RING
+int snet_rx_isr_push(uint8_t c)
+{
+    /* only this side writes head; tail may advance underneath, which
+       only makes room */
+    uint8_t h = g_snet.isr_head;
+    if ((uint8_t)(h - SNET_ISR_LOAD(&g_snet.isr_tail)) >= SNET_CFG_ISR_RING)
+        return -1;
+    g_snet.isr_buf[h & SNET_ISR_MASK] = c;
+    SNET_ISR_STORE(&g_snet.isr_head, (uint8_t)(h + 1u));
+    return 0;
+}
+#endif
+
+void snet_on_tx_ready(void (*fn)(void))
+{
+    g_snet.tx_ready = fn;
+}
+
+int snet_tx_pull(void)
+{
+    /* only this side writes tx_pos, and only below tx_len; the engine
+       drops tx_len to 0 before it rewinds tx_pos for the next frame */
+    uint8_t p = g_snet.tx_pos;
+    if (p >= SNET_ISR_LOAD(&g_snet.tx_len)) return -1;
+    uint8_t c = g_snet.tx_out[p];
+    SNET_ISR_STORE(&g_snet.tx_pos, (uint8_t)(p + 1u));
+    return c;
+}
+
+uint8_t snet_tx_payload(void)
+{
+#if SNET_CFG_LONG
+    if (g_snet.long_max && g_snet.tx_pay > SNET_PAY_NOW) return g_snet.tx_pay;
+#endif
+    return SNET_PAY_NOW;
+}
@@ -0,0 +1,55 @@
+/* lib/squid/prof.c – latency histograms for the hot paths.
+ *
+ * Durations go into log2 buckets, so adding one is a shift loop and an
+ * increment, cheap enough for 8-bit cores.  Percentiles are read from
+ * the buckets, so they are bounds rather than exact values.
+ */
+#include "internal.h"
+
+#if SNET_CFG_PROFILE
+
+void snet_prof_clock(uint32_t (*now)(void))
+{
+    g_snet.prof_now = now;
+}
+
+void snet_prof_reset(void)
+{
+    memset(g_snet.prof, 0, sizeof(g_snet.prof));
+}
+
+void snet_prof_add(uint8_t probe, uint32_t start)
+{
+    uint32_t dt = g_snet.prof_now() - start;
+    snet_prof_hist_t *h = &g_snet.prof[probe];
+
+    uint8_t b = 0;
+    for (uint32_t v = dt; v && b < SNET_PROF_BUCKETS - 1u; v >>= 1) b++;
+    h->bucket[b]++;
+    h->count++;
+    if (dt > h->max) h->max = dt;
+}
+
+int snet_prof_get(uint8_t probe, snet_prof_stat_t *st)
+{
+    if (probe >= SNET_PROF_N || !st) return -1;
+    const snet_prof_hist_t *h = &g_snet.prof[probe];
+    st->count = h->count;
+    st->max   = h->max;
+    st->p99   = 0u;
+    if (!h->count) return 0;
+
+    /* first bucket where the running count reaches 99% */
+    uint32_t need = h->count - h->count / 100u, sum = 0;
+    for (uint8_t b = 0; b < SNET_PROF_BUCKETS; b++) {
+        sum += h->bucket[b];
+        if (sum >= need) {
+            uint32_t edge = (b == 0u) ? 0u : ((uint32_t)1u << b) - 1u;
+            st->p99 = (b == SNET_PROF_BUCKETS - 1u || edge > h->max) ? h->max : edge;
+            break;
+        }
+    }
+    return 0;
+}
+
+#endif
@@ -0,0 +1,200 @@
+/* lib/squid/queue.c – per-socket byte queues.
+ *
+ * Heap model: a FIFO of malloc'd blocks, one per squid_sendv() call or
+ * received record.  Static model (SNET_CFG_STATIC): a ring of
+ * SNET_CFG_QUEUE_BYTES inside the socket, no allocator involved.
+ * Either way a put is all-or-nothing and a get scatters in order.
+ *
+ * Subscribed channels (squid_subscribe) share one heap queue, kept on the
+ * first subscriber: each block is stored once with a reader count, and
+ * every subscriber reads through its own cursor.  The static model has
+ * no shared storage; each subscriber's ring gets its own copy.
+ */
+#include "internal.h"
+
+#if SNET_CFG_STATIC
+
+bool snet_q_put(snet_queue_t *q, uint16_t *bytes,
+                const squid_iovec_t *iov, uint8_t cnt, uint16_t len)
+{
+    if (!SNET_Q_FITS(*bytes, len)) return false;       /* ring full */
+
+    uint16_t wr = (uint16_t)(q->rd + *bytes);
+    if (wr >= SNET_CFG_QUEUE_BYTES) wr = (uint16_t)(wr - SNET_CFG_QUEUE_BYTES);
+    for (uint8_t i = 0; i < cnt; i++) {
+        const uint8_t *src = iov[i].base;
+        uint16_t left = iov[i].len;
+        while (left) {                                  /* at most 2 runs */
+            uint16_t run = (uint16_t)(SNET_CFG_QUEUE_BYTES - wr);
+            if (run > left) run = left;
+            memcpy(&q->buf[wr], src, run);
+            src  += run;
+            left  = (uint16_t)(left - run);
+            wr    = (uint16_t)(wr + run);
+            if (wr == SNET_CFG_QUEUE_BYTES) wr = 0u;
+        }
+    }
+    *bytes = (uint16_t)(*bytes + len);
+    g_snet.q_mem += len;
+    return true;
+}
+
+uint16_t snet_q_get(snet_queue_t *q, uint16_t *bytes,
+                    const squid_iovec_t *iov, uint8_t cnt)
+{
+    uint16_t total = 0;
+    for (uint8_t i = 0; i < cnt && *bytes; i++) {
+        uint8_t *dst  = iov[i].base;
+        uint16_t left = iov[i].len;
+        while (left && *bytes) {
+            uint16_t run = (uint16_t)(SNET_CFG_QUEUE_BYTES - q->rd);
+            if (run > *bytes) run = *bytes;
+            if (run > left)   run = left;
+            memcpy(dst, &q->buf[q->rd], run);
+            dst   += run;
+            left   = (uint16_t)(left - run);
+            total  = (uint16_t)(total + run);
+            *bytes = (uint16_t)(*bytes - run);
+            q->rd  = (uint16_t)(q->rd + run);
+            if (q->rd == SNET_CFG_QUEUE_BYTES) q->rd = 0u;
+        }
+    }
+    g_snet.q_mem -= total;
+    return total;
+}
+
+void snet_q_clear(snet_queue_t *q, uint16_t *bytes)
+{
+    g_snet.q_mem -= *bytes;
+    q->rd  = 0u;
+    *bytes = 0u;
+}
+
+#else /* heap */
+
+bool snet_q_put(snet_queue_t *q, uint16_t *bytes,
+                const squid_iovec_t *iov, uint8_t cnt, uint16_t len)
+{
+    /* one block, segments gathered into it */
+    snet_node_t *n = (snet_node_t*)g_snet.plat->malloc(
+        (uint16_t)(sizeof(snet_node_t) + len));
+    if (!n) return false;
+    n->next = (snet_node_t*)0;
+    n->len  = len;
+    n->off  = 0;
+    uint16_t pos = 0;
+    for (uint8_t i = 0; i < cnt; i++) {
+        if (!iov[i].len) continue;
+        memcpy(n->data + pos, iov[i].base, iov[i].len);
+        pos = (uint16_t)(pos + iov[i].len);
+    }
+
+    if (q->tail) q->tail->next = n; else q->head = n;
+    q->tail = n;
+    *bytes = (uint16_t)(*bytes + len);
+    g_snet.q_mem += SNET_Q_OVERHEAD + len;
+    return true;
+}
+
+uint16_t snet_q_get(snet_queue_t *q, uint16_t *bytes,
+                    const squid_iovec_t *iov, uint8_t cnt)
+{
+    /* copy queued blocks across the segments, freeing as we go */
+    uint16_t total = 0;
+    uint8_t  seg   = 0;
+    uint16_t soff  = 0;                 /* offset within iov[seg] */
+    while (q->head && seg < cnt) {
+        if (soff >= iov[seg].len) { seg++; soff = 0; continue; }
+        snet_node_t *n = q->head;
+        uint16_t avail = (uint16_t)(n->len - n->off);
+        uint16_t room  = (uint16_t)(iov[seg].len - soff);
+        uint16_t take  = (avail > room) ? room : avail;
+        memcpy(iov[seg].base + soff, n->data + n->off, take);
+        n->off = (uint16_t)(n->off + take);
+        soff   = (uint16_t)(soff + take);
+        total  = (uint16_t)(total + take);
+        *bytes = (uint16_t)(*bytes - take);
+        if (n->off >= n->len) {         /* block fully consumed — release */
+            q->head = n->next;
+            if (!q->head) q->tail = (snet_node_t*)0;
+            g_snet.q_mem -= SNET_Q_OVERHEAD + n->len;
+            g_snet.plat->free(n);
+        }
+    }
+    return total;
+}
+
+void snet_q_clear(snet_queue_t *q, uint16_t *bytes)
+{
+    snet_node_t *n = q->head;
+    while (n) {
+        snet_node_t *next = n->next;
+        g_snet.q_mem -= SNET_Q_OVERHEAD + n->len;
+        g_snet.plat->free(n);
+        n = next;
+    }
+    q->head = q->tail = (snet_node_t*)0;
+    *bytes = 0u;
+}
+
+snet_node_t *snet_q_put_shared(snet_queue_t *q, const uint8_t *data,
+                               uint16_t len, uint8_t refs)
+{
+    squid_iovec_t iov;
+    uint16_t unused = 0u;               /* each reader counts its own bytes */
+    iov.base = (uint8_t*)data;
+    iov.len  = len;
+    if (!snet_q_put(q, &unused, &iov, 1u, len)) return (snet_node_t*)0;
+    q->tail->refs = refs;
+    return q->tail;
+}
+
+/* ---- free leading blocks every reader is past (always a prefix) ---- */
+static void _release(snet_queue_t *q)
+{
+    while (q->head && !q->head->refs) {
+        snet_node_t *n = q->head;
+        q->head = n->next;
+        if (!q->head) q->tail = (snet_node_t*)0;
+        g_snet.q_mem -= SNET_Q_OVERHEAD + n->len;
+        g_snet.plat->free(n);
+    }
+}
+
+uint16_t snet_q_read(snet_queue_t *q, snet_cursor_t *cur, uint16_t *bytes,
+                     const squid_iovec_t *iov, uint8_t cnt)
+{
+    uint16_t total = 0;
+    uint8_t  seg   = 0;
+    uint16_t soff  = 0;
+    while (cur->rd && seg < cnt) {
+        if (soff >= iov[seg].len) { seg++; soff = 0; continue; }
+        snet_node_t *n = cur->rd;
+        uint16_t avail = (uint16_t)(n->len - cur->off);
+        uint16_t room  = (uint16_t)(iov[seg].len - soff);
+        uint16_t take  = (avail > room) ? room : avail;
+        memcpy(iov[seg].base + soff, n->data + cur->off, take);
+        cur->off = (uint16_t)(cur->off + take);
+        soff     = (uint16_t)(soff + take);
+        total    = (uint16_t)(total + take);
+        *bytes   = (uint16_t)(*bytes - take);
+        if (cur->off >= n->len) {       /* this reader is done with it */
+            n->refs--;
+            cur->rd  = n->next;
+            cur->off = 0u;
+        }
+    }
+    _release(q);
+    return total;
+}
+
+void snet_q_leave(snet_queue_t *q, snet_cursor_t *cur, uint16_t *bytes)
+{
+    for (snet_node_t *n = cur->rd; n; n = n->next) n->refs--;
+    cur->rd  = (snet_node_t*)0;
+    cur->off = 0u;
+    *bytes   = 0u;
+    _release(q);
+}
+
+#endif
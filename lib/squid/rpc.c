@@ -0,0 +1,189 @@
+/* lib/squid/rpc.c – request/response RPC over one squid socket.
+ *
+ * Built on the public socket API only.  Each message goes out as one
+ * queued block (squid_sendv), so a request is never interleaved with
+ * another on the wire; the reader collects the header, then the
+ * payload, and dispatches by kind.
+ */
+#include <stdbool.h>
+#include <string.h>
+#include "squid/rpc.h"
+
+#define RPC_KIND_REQ   0x51u   /* 'Q' */
+#define RPC_KIND_RSP   0x52u   /* 'R' */
+
+#define H_KIND  0
+#define H_ID    1
+#define H_ARG   3               /* method (request) / status (response) */
+#define H_LEN   4
+
+static uint16_t _get16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+
+static void _put16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)(v & 0xFFu);
+    p[1] = (uint8_t)(v >> 8);
+}
+
+/* ---- one message: header + payload in one block ---- */
+static int _send(squid_rpc_t *r, uint8_t kind, uint16_t id, uint8_t arg,
+                 const uint8_t *data, uint16_t len)
+{
+    if (len > SNET_CFG_RPC_MAX || (len && !data)) return -1;
+    uint8_t hdr[SQUID_RPC_HDR];
+    hdr[H_KIND] = kind;
+    _put16(&hdr[H_ID], id);
+    hdr[H_ARG] = arg;
+    _put16(&hdr[H_LEN], len);
+
+    squid_iovec_t iov[2];
+    iov[0].base = hdr;
+    iov[0].len  = SQUID_RPC_HDR;
+    iov[1].base = (uint8_t*)data;
+    iov[1].len  = len;
+    int n = squid_sendv(r->fd, iov, len ? 2u : 1u);
+    return n < 0 ? n : 0;
+}
+
+static squid_rpc_call_t *_slot(squid_rpc_t *r, uint16_t id)
+{
+    for (uint8_t i = 0; i < SNET_CFG_RPC_SLOTS; i++)
+        if (r->call[i].id == id) return &r->call[i];
+    return (squid_rpc_call_t*)0;
+}
+
+/* ---- free the slot first: the callback may start a new call ---- */
+static void _complete(squid_rpc_t *r, squid_rpc_call_t *c, int status,
+                      const uint8_t *data, uint16_t len)
+{
+    uint16_t id = c->id;
+    squid_rpc_done_fn done = c->done;
+    void *arg = c->arg;
+    c->id = 0u;
+    if (done) done(r, id, status, data, len, arg);
+}
+
+void squid_rpc_init(squid_rpc_t *r, int fd)
+{
+    memset(r, 0, sizeof(*r));
+    r->fd = fd;
+}
+
+void squid_rpc_serve(squid_rpc_t *r, squid_rpc_serve_fn fn, void *arg)
+{
+    r->serve     = fn;
+    r->serve_arg = arg;
+}
+
+int squid_rpc_call(squid_rpc_t *r, uint8_t method,
+                   const uint8_t *data, uint16_t len,
+                   uint32_t now, uint32_t timeout,
+                   squid_rpc_done_fn done, void *arg)
+{
+    squid_rpc_call_t *c = _slot(r, 0u);
+    if (!c) return -1;                  /* SNET_CFG_RPC_SLOTS in flight */
+
+    /* next id not in flight; 0 marks a free slot */
+    do r->last_id++;
+    while (!r->last_id || _slot(r, r->last_id));
+
+    int rc = _send(r, RPC_KIND_REQ, r->last_id, method, data, len);
+    if (rc < 0) return rc;
+    c->id       = r->last_id;
+    c->deadline = now + timeout;
+    c->timed    = timeout != 0u;
+    c->done     = done;
+    c->arg      = arg;
+    return (int)c->id;
+}
+
+int squid_rpc_reply(squid_rpc_t *r, uint16_t id, uint8_t status,
+                    const uint8_t *data, uint16_t len)
+{
+    return _send(r, RPC_KIND_RSP, id, status, data, len);
+}
+
+void squid_rpc_cancel(squid_rpc_t *r, uint16_t id)
+{
+    squid_rpc_call_t *c = id ? _slot(r, id) : (squid_rpc_call_t*)0;
+    if (c) c->id = 0u;
+}
+
+/* ---- a whole message is in r->in ---- */
+static void _dispatch(squid_rpc_t *r)
+{
+    uint16_t id  = _get16(&r->in[H_ID]);
+    uint8_t  arg = r->in[H_ARG];
+    uint16_t len = _get16(&r->in[H_LEN]);
+    const uint8_t *pay = &r->in[SQUID_RPC_HDR];
+
+    if (r->in[H_KIND] == RPC_KIND_REQ) {
+        if (r->serve) r->serve(r, id, arg, pay, len, r->serve_arg);
+        else (void)squid_rpc_reply(r, id, SQUID_RPC_ST_NOMETHOD, 0, 0u);
+    } else {
+        squid_rpc_call_t *c = id ? _slot(r, id) : (squid_rpc_call_t*)0;
+        if (c) _complete(r, c, arg, pay, len);
+        /* else cancelled or timed out: late response, dropped */
+    }
+}
+
+/* ---- header complete: oversize messages are answered and skipped ---- */
+static void _header(squid_rpc_t *r)
+{
+    uint8_t kind = r->in[H_KIND];
+    uint16_t len = _get16(&r->in[H_LEN]);
+    if (len <= SNET_CFG_RPC_MAX) return;
+
+    uint16_t id = _get16(&r->in[H_ID]);
+    if (kind == RPC_KIND_REQ) {
+        (void)squid_rpc_reply(r, id, SQUID_RPC_ST_TOOBIG, 0, 0u);
+    } else {
+        squid_rpc_call_t *c = id ? _slot(r, id) : (squid_rpc_call_t*)0;
+        if (c) _complete(r, c, SQUID_RPC_ST_TOOBIG, 0, 0u);
+    }
+    r->skip = len;
+    r->in_len = 0u;
+}
+
+int squid_rpc_poll(squid_rpc_t *r, uint32_t now)
+{
+    for (;;) {
+        if (r->skip) {
+            uint8_t junk[32];
+            uint16_t n = r->skip < sizeof(junk) ? r->skip : (uint16_t)sizeof(junk);
+            int got = squid_recv(r->fd, junk, n);
+            if (got <= 0) break;
+            r->skip = (uint16_t)(r->skip - got);
+            continue;
+        }
+        uint16_t want = SQUID_RPC_HDR;
+        if (r->in_len >= SQUID_RPC_HDR)
+            want = (uint16_t)(want + _get16(&r->in[H_LEN]));
+        if (r->in_len == want) {
+            r->in_len = 0u;
+            _dispatch(r);
+            continue;
+        }
+        bool head = r->in_len < SQUID_RPC_HDR;
+        int got = squid_recv(r->fd, &r->in[r->in_len], (uint16_t)(want - r->in_len));
+        if (got <= 0) break;
+        r->in_len = (uint16_t)(r->in_len + got);
+        if (!head) continue;
+        /* a new session may have cut a message: resync on a kind byte */
+        while (r->in_len && r->in[H_KIND] != RPC_KIND_REQ &&
+               r->in[H_KIND] != RPC_KIND_RSP)
+            memmove(r->in, &r->in[1], --r->in_len);
+        if (r->in_len == SQUID_RPC_HDR) _header(r);
+    }
+
+    int busy = 0;
+    for (uint8_t i = 0; i < SNET_CFG_RPC_SLOTS; i++) {
+        squid_rpc_call_t *c = &r->call[i];
+        if (!c->id) continue;
+        if (c->timed && (int32_t)(now - c->deadline) >= 0)
+            _complete(r, c, SQUID_RPC_TIMEOUT, 0, 0u);
+        else
+            busy++;
+    }
+    return busy;
+}
@@ -0,0 +1,224 @@
+/* lib/squid/shm.c – same-host link over a shared-memory segment (Linux).
+ *
+ * Segment: a header, then one ring per direction.  The creator sends on
+ * ring 0, the joiner on ring 1.  Each ring has one writer and one reader
+ * and needs no lock: the writer owns head, the reader owns tail, both
+ * published with release/acquire.
+ *
+ * Wakeup: a reader about to sleep sets `waiting`, rechecks head, then
+ * futex-waits on head.  The writer checks `waiting` after each ETX, so a
+ * sleeping peer costs one FUTEX_WAKE per frame and an awake one none.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "squid/shm.h"
+
+#define SHM_MAGIC  0x53514D31u      /* "SQM1" */
+#define SHM_MASK   (SQUID_SHM_RING - 1u)
+#define SHM_ETX    0xD3u            /* last byte of every frame */
+#define SHM_NAME   64
+
+typedef struct {
+    uint32_t head;                  /* written by the producer */
+    uint32_t waiting;               /* consumer sleeps on head */
+    uint8_t  pad0[56];
+    uint32_t tail;                  /* written by the consumer */
+    uint8_t  pad1[60];
+    uint8_t  data[SQUID_SHM_RING];
+} shm_ring_t;
+
+typedef struct {
+    uint32_t magic;                 /* set last by the creator */
+    uint32_t joined;                /* second side attached */
+    uint8_t  pad[56];
+    shm_ring_t ring[2];
+} shm_seg_t;
+
+/* link context (single instance) */
+static struct {
+    shm_seg_t *seg;
+    shm_ring_t *tx, *rx;
+    int creator;
+    char name[SHM_NAME];
+    const squid_platform_t *base;
+} s_shm;
+
+#define LOAD(p)     __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+static long _futex(uint32_t *addr, int op, uint32_t val,
+                   const struct timespec *ts)
+{
+    return syscall(SYS_futex, addr, op, val, ts, NULL, 0);
+}
+
+static int _shm_send(uint8_t c)
+{
+    shm_ring_t *r = s_shm.tx;
+    uint32_t h = r->head;
+    if (h - LOAD(&r->tail) >= SQUID_SHM_RING) return -1;   /* full: lost */
+    r->data[h & SHM_MASK] = c;
+    STORE(&r->head, h + 1u);
+
+    if (c == SHM_ETX) {
+        /* pairs with the fence in squid_shm_wait(): either the reader
+           sees the new head or we see its waiting flag */
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&r->waiting, __ATOMIC_RELAXED) &&
+            __atomic_exchange_n(&r->waiting, 0u, __ATOMIC_RELAXED))
+            _futex(&r->head, FUTEX_WAKE, 1u, NULL);
+    }
+    return 0;
+}
+
+static int _shm_recv(void)
+{
+    shm_ring_t *r = s_shm.rx;
+    uint32_t t = r->tail;
+    if (t == LOAD(&r->head)) return -1;
+    uint8_t c = r->data[t & SHM_MASK];
+    STORE(&r->tail, t + 1u);
+    return c;
+}
+
+static uint8_t _shm_tick(void)      { return s_shm.base->get_tick(); }
+static void *_shm_malloc(uint16_t n){ return s_shm.base->malloc(n); }
+static void  _shm_free(void *p)     { s_shm.base->free(p); }
+
+static void _nap(void)
+{
+    struct timespec ts = { 0, 1000000 };    /* 1 ms */
+    nanosleep(&ts, NULL);
+}
+
+/* ---- map an existing segment once the creator has sized it ---- */
+static shm_seg_t *_join(int fd)
+{
+    struct stat st;
+    for (int i = 0; i < 1000; i++) {
+        if (fstat(fd, &st) < 0) return NULL;
+        if ((size_t)st.st_size >= sizeof(shm_seg_t)) break;
+        _nap();
+    }
+    if ((size_t)st.st_size < sizeof(shm_seg_t)) return NULL;
+
+    shm_seg_t *seg = mmap(NULL, sizeof(shm_seg_t), PROT_READ | PROT_WRITE,
+                          MAP_SHARED, fd, 0);
+    if (seg == MAP_FAILED) return NULL;
+    for (int i = 0; i < 1000 && LOAD(&seg->magic) != SHM_MAGIC; i++) _nap();
+
+    uint32_t free_slot = 0u;
+    if (LOAD(&seg->magic) != SHM_MAGIC ||
+        !__atomic_compare_exchange_n(&seg->joined, &free_slot, 1u, 0,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        munmap(seg, sizeof(shm_seg_t));     /* stale, or both sides taken */
+        return NULL;
+    }
+    return seg;
+}
+
+int squid_shm_open(const char *name, const squid_platform_t *base,
+                   squid_platform_t *out)
+{
+    if (!name || !out || !base || !base->get_tick) return -1;
+    if (strlen(name) >= SHM_NAME || s_shm.seg) return -1;
+
+    shm_seg_t *seg;
+    int creator = 1;
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd >= 0) {
+        if (ftruncate(fd, (off_t)sizeof(shm_seg_t)) < 0) {
+            close(fd);
+            shm_unlink(name);
+            return -1;
+        }
+        seg = mmap(NULL, sizeof(shm_seg_t), PROT_READ | PROT_WRITE,
+                   MAP_SHARED, fd, 0);
+        if (seg == MAP_FAILED) seg = NULL;
+        else STORE(&seg->magic, SHM_MAGIC);  /* rings are zero already */
+    } else if (errno == EEXIST) {
+        creator = 0;
+        fd = shm_open(name, O_RDWR, 0600);
+        seg = (fd >= 0) ? _join(fd) : NULL;
+    } else {
+        return -1;
+    }
+    if (fd >= 0) close(fd);
+    if (!seg) {
+        if (creator) shm_unlink(name);
+        return -1;
+    }
+
+    s_shm.seg     = seg;
+    s_shm.tx      = &seg->ring[creator ? 0 : 1];
+    s_shm.rx      = &seg->ring[creator ? 1 : 0];
+    s_shm.creator = creator;
+    s_shm.base    = base;
+    strcpy(s_shm.name, name);
+
+    out->send_char = _shm_send;
+    out->recv_char = _shm_recv;
+    out->get_tick  = _shm_tick;
+    out->malloc    = base->malloc ? _shm_malloc : NULL;
+    out->free      = base->free   ? _shm_free   : NULL;
+    return creator ? 0 : 1;
+}
+
+void squid_shm_close(void)
+{
+    if (!s_shm.seg) return;
+    if (s_shm.creator) shm_unlink(s_shm.name);
+    else STORE(&s_shm.seg->joined, 0u);     /* let a restarted peer rejoin */
+    munmap(s_shm.seg, sizeof(shm_seg_t));
+    memset(&s_shm, 0, sizeof(s_shm));
+}
+
+int squid_shm_unlink(const char *name)
+{
+    return shm_unlink(name);
+}
+
+size_t squid_shm_feed(void)
+{
+    shm_ring_t *r = s_shm.rx;
+    if (!r) return 0;
+    uint32_t t = r->tail;
+    uint32_t n = LOAD(&r->head) - t;
+    if (!n) return 0;
+
+    /* at most two runs: up to the end of the ring, then from the start */
+    uint32_t at  = t & SHM_MASK;
+    uint32_t run = SQUID_SHM_RING - at;
+    if (run > n) run = n;
+    snet_feed(&r->data[at], run);
+    if (n > run) snet_feed(&r->data[0], n - run);
+    STORE(&r->tail, t + n);
+    return n;
+}
+
+int squid_shm_wait(int timeout_ms)
+{
+    shm_ring_t *r = s_shm.rx;
+    if (!r) return 0;
+    uint32_t h = LOAD(&r->head);
+    if (h != r->tail) return 1;
+
+    __atomic_store_n(&r->waiting, 1u, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    h = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+    if (h == r->tail) {
+        struct timespec ts = { timeout_ms / 1000,
+                               (long)(timeout_ms % 1000) * 1000000L };
+        _futex(&r->head, FUTEX_WAIT, h, timeout_ms < 0 ? NULL : &ts);
+    }
+    __atomic_store_n(&r->waiting, 0u, __ATOMIC_RELAXED);
+    return LOAD(&r->head) != r->tail;
+}
@@ -1,75 +1,142 @@
 /* lib/squid/socket.c – multiplexed socket API over snet */
 #include "internal.h"
+#include "squid/socket.h"
 
 static snet_chan_t *_find_by_fd(uint8_t fd)
 {
-    snet_chan_t *ch = g_snet.chan_head;
-    while (ch) {
-        if (ch->fd == fd) return ch;
-        ch = ch->next;
-    }
-    return (snet_chan_t*)0;
+    return snet_sock(fd);
 }
 
-static snet_chan_t *_find_by_channel(uint8_t ch_id)
+/* ---- byte offsets wrap: a is after b ---- */
+#define _AFTER(a, b) ((int32_t)((uint32_t)(a) - (uint32_t)(b)) > 0)
+
+/* ---- refused send: remember its size for the writable callback ---- */
+static int _would_block(snet_chan_t *sock, uint16_t len)
 {
-    snet_chan_t *ch = g_snet.chan_head;
-    while (ch) {
-        if (ch->ch_id == ch_id) return ch;
-        ch = ch->next;
-    }
-    return (snet_chan_t*)0;
+    if (!sock->tx_want) g_snet.tx_blocked++;
+    sock->tx_want = len;
+    return SQUID_EAGAIN;
 }
 
-static void _free_queue(snet_node_t *head)
+/* ---- would a send of len fit now (caps, ring, budget)? ---- */
+static bool _tx_fits(const snet_chan_t *sock, uint16_t len)
 {
-    while (head) {
-        snet_node_t *next = head->next;
-        g_snet.plat->free(head);
-        head = next;
-    }
+    if (sock->tx_cap && sock->tx_bytes + len > sock->tx_cap) return false;
+    return SNET_Q_FITS(sock->tx_bytes, len) && SNET_MEM_FITS(len);
 }
 
 int squid_open(void)
 {
     if (!g_snet.plat || g_snet.eng == SNET_ENG_DISCONNECTED) return -1;
 
-    /* find first free local fd (1..15) */
-    for (uint8_t fd = 1; fd <= 15; fd++) {
-        if (!(g_snet.fd_mask & (1u << fd))) {
+    /* find first free local fd (1..SNET_CFG_CHANNELS) */
+    for (unsigned fd = 1; fd <= SNET_CFG_CHANNELS; fd++) {
+        if (!g_snet.fd_sock[fd]) {
+#if SNET_CFG_STATIC
+            snet_chan_t *ch = &g_snet.chan_pool[fd - 1u];
+#else
             snet_chan_t *ch = (snet_chan_t*)g_snet.plat->malloc(
                 (uint16_t)sizeof(snet_chan_t));
             if (!ch) return -1;
+#endif
             memset(ch, 0, sizeof(snet_chan_t));
-            ch->fd = fd;
+            ch->fd = (uint8_t)fd;
             /* prepend to list */
             ch->next = g_snet.chan_head;
             g_snet.chan_head = ch;
-            g_snet.fd_mask |= (uint16_t)(1u << fd);
+            g_snet.fd_sock[fd] = ch;
             return (int)fd;
         }
     }
     return -1;  /* all local fds in use */
 }
 
+/* ---- leave the bound or subscribed channel ----
+ * A plain socket keeps what it queued; a subscriber drops its unread
+ * share.  When the first subscriber leaves, the next one takes over the
+ * channel and (heap model) the shared queue. */
+static void _unbind(snet_chan_t *sock)
+{
+    uint8_t ch_id = sock->ch_id;
+    if (ch_id == 0u) return;
+    sock->ch_id = 0u;
+    if (!sock->sub) { g_snet.ch_fd[ch_id] = 0u; return; }
+
+    snet_chan_t *lead = snet_chan_of(ch_id);
+#if SNET_CFG_STATIC
+    snet_q_clear(&sock->rxq, &sock->rx_bytes);
+#else
+    snet_q_leave(&lead->rxq, &sock->rx_cur, &sock->rx_bytes);
+#endif
+    if (lead == sock) {
+        snet_chan_t *next = sock->sub_next;
+        g_snet.ch_fd[ch_id] = next ? next->fd : 0u;
+#if !SNET_CFG_STATIC
+        if (next) next->rxq = sock->rxq;
+        sock->rxq.head = sock->rxq.tail = (snet_node_t*)0;
+#endif
+    } else {
+        snet_chan_t *p = lead;
+        while (p->sub_next != sock) p = p->sub_next;
+        p->sub_next = sock->sub_next;
+    }
+    sock->sub_next = (snet_chan_t*)0;
+    sock->sub = 0u;
+}
+
 int squid_bind(int fd, uint8_t ch_id)
 {
     if (!g_snet.plat) return -1;
-    if (fd < 1 || fd > 15) return -1;
-    if (ch_id < 1 || ch_id > 15) return -1;
+    if (fd < 1 || fd > SNET_CFG_CHANNELS) return -1;
+    if (ch_id < 1) return -1;
+#if SNET_CFG_CH_MAX < 255
+    if (ch_id > SNET_CFG_CH_MAX) return -1;
+#endif
 
     snet_chan_t *sock = _find_by_fd((uint8_t)fd);
     if (!sock) return -1;
 
-    /* requested channel already owned by another fd */
-    snet_chan_t *owner = _find_by_channel(ch_id);
-    if (owner && owner != sock) return -1;
+    /* requested channel already owned by another fd, or subscribed */
+    snet_chan_t *owner = snet_chan_of(ch_id);
+    if (owner && (owner != sock || sock->sub)) return -1;
 
-    if (sock->ch_id != 0u) {
-        g_snet.ch_mask &= (uint16_t)~(1u << sock->ch_id);
-    }
+    _unbind(sock);
+    sock->ch_id = ch_id;
+    g_snet.ch_fd[ch_id] = (uint8_t)fd;
+    return 0;
+}
+
+int squid_subscribe(int fd, uint8_t ch_id)
+{
+    if (!g_snet.plat) return -1;
+    if (fd < 1 || fd > SNET_CFG_CHANNELS) return -1;
+    if (ch_id < 1) return -1;
+#if SNET_CFG_CH_MAX < 255
+    if (ch_id > SNET_CFG_CH_MAX) return -1;
+#endif
+
+    snet_chan_t *sock = _find_by_fd((uint8_t)fd);
+    if (!sock) return -1;
+    if (sock->sub && sock->ch_id == ch_id) return 0;
+#if SNET_CFG_STREAM
+    if (sock->st.sink) return -1;       /* a sink takes payloads alone */
+#endif
+
+    /* a plain bind owns its channel alone */
+    snet_chan_t *lead = snet_chan_of(ch_id);
+    if (lead && lead != sock && !lead->sub) return -1;
+
+    _unbind(sock);
+    snet_q_clear(&sock->rxq, &sock->rx_bytes);  /* reads the shared queue now */
     sock->ch_id = ch_id;
-    g_snet.ch_mask |= (uint16_t)(1u << ch_id);
+    sock->sub   = 1u;
+    lead = snet_chan_of(ch_id);
+    if (!lead) {
+        g_snet.ch_fd[ch_id] = (uint8_t)fd;
+    } else {
+        while (lead->sub_next) lead = lead->sub_next;
+        lead->sub_next = sock;          /* sees payloads from now on */
+    }
     return 0;
 }
 
@@ -81,23 +148,26 @@ int squid_connect(int fd, uint8_t ch_id)
 
 void squid_close(int fd)
 {
-    if (fd < 1 || fd > 15) return;
-    if (!g_snet.plat) return;
+    if (fd < 1 || fd > SNET_CFG_CHANNELS) return;
+    if (!g_snet.plat || !g_snet.fd_sock[fd]) return;
 
     snet_chan_t **pp = &g_snet.chan_head;
     while (*pp) {
         snet_chan_t *c = *pp;
         if (c->fd == (uint8_t)fd) {
-            uint8_t bound_ch = c->ch_id;
-            /* drain queues — free all malloc'd blocks */
-            _free_queue(c->tx_head);
-            _free_queue(c->rx_head);
+            if (c->tx_want) g_snet.tx_blocked--;
+            /* drain queues, release the socket */
+            _unbind(c);
+            snet_q_clear(&c->txq, &c->tx_bytes);
+            snet_q_clear(&c->rxq, &c->rx_bytes);
             *pp = c->next;
+#if SNET_CFG_RR
+            if (g_snet.rr_next == c) g_snet.rr_next = c->next;
+#endif
+            g_snet.fd_sock[fd] = (snet_chan_t*)0;
+#if !SNET_CFG_STATIC
             g_snet.plat->free(c);
-            g_snet.fd_mask &= (uint16_t)~(1u << fd);
-            if (bound_ch != 0u) {
-                g_snet.ch_mask &= (uint16_t)~(1u << bound_ch);
-            }
+#endif
             return;
         }
         pp = &c->next;
@@ -106,53 +176,249 @@ void squid_close(int fd)
 
 int squid_send(int fd, const uint8_t *data, uint16_t len)
 {
-    if (fd < 1 || fd > 15 || !data || len == 0) return -1;
+    squid_iovec_t iov;
+    iov.base = (uint8_t*)data;
+    iov.len  = len;
+    return squid_sendv(fd, &iov, 1u);
+}
+
+int squid_recv(int fd, uint8_t *buf, uint16_t max)
+{
+    squid_iovec_t iov;
+    iov.base = buf;
+    iov.len  = max;
+    return squid_recvv(fd, &iov, 1u);
+}
+
+static int _sendv(int fd, const squid_iovec_t *iov, uint8_t cnt)
+{
+    if (fd < 1 || fd > SNET_CFG_CHANNELS || !iov || cnt == 0) return -1;
     if (!g_snet.plat) return -1;
 
     snet_chan_t *sock = _find_by_fd((uint8_t)fd);
     if (!sock || sock->ch_id == 0u) return -1;
 
-    /* check capacity */
-    if (sock->tx_cap && (sock->tx_bytes + len > sock->tx_cap)) return -1;
-
-    /* allocate a block for the data and append to TX queue */
-    snet_node_t *n = (snet_node_t*)g_snet.plat->malloc(
-        (uint16_t)(sizeof(snet_node_t) + len));
-    if (!n) return -1;
-    n->next = (snet_node_t*)0;
-    n->len  = len;
-    n->off  = 0;
-    memcpy(n->data, data, len);
-
-    if (sock->tx_tail) sock->tx_tail->next = n; else sock->tx_head = n;
-    sock->tx_tail = n;
-    sock->tx_bytes += len;
+    /* total length; a heap block header must still fit a uint16_t malloc */
+    uint16_t len = 0;
+    for (uint8_t i = 0; i < cnt; i++) {
+        if (iov[i].len && !iov[i].base) return -1;
+        if ((uint32_t)len + iov[i].len + SNET_Q_OVERHEAD > 0xFFFFu) return -1;
+        len = (uint16_t)(len + iov[i].len);
+    }
+    if (len == 0) return -1;
+
+    /* never fits: over the cap, the ring or the whole budget */
+    if (sock->tx_cap && len > sock->tx_cap) return -1;
+    if (!SNET_Q_FITS(0u, len)) return -1;
+    if (g_snet.budget && SNET_Q_OVERHEAD + len > g_snet.budget) return -1;
+
+    /* does not fit yet (whole message or nothing) */
+    if (!_tx_fits(sock, len)) return _would_block(sock, len);
+    if (!snet_q_put(&sock->txq, &sock->tx_bytes, iov, cnt, len)) return -1;
+    sock->tx_queued += len;
     return (int)len;
 }
 
-int squid_recv(int fd, uint8_t *buf, uint16_t max)
+int squid_sendv(int fd, const squid_iovec_t *iov, uint8_t cnt)
+{
+    SNET_PROF_BEGIN(t);
+    int r = _sendv(fd, iov, cnt);
+    SNET_PROF_END(SNET_PROF_SEND, t);
+    return r;
+}
+
+int squid_send_confirmed(int fd, const uint8_t *data, uint16_t len,
+                         uint32_t *ticket)
+{
+    int n = squid_send(fd, data, len);
+    if (n <= 0) return n;
+    snet_chan_t *sock = _find_by_fd((uint8_t)fd);
+    sock->tx_confirm = sock->tx_queued;
+    if (ticket) *ticket = sock->tx_queued;
+    return n;
+}
+
+int squid_delivered(int fd, uint32_t ticket)
+{
+    if (fd < 1 || fd > SNET_CFG_CHANNELS || !g_snet.plat) return -1;
+    snet_chan_t *sock = _find_by_fd((uint8_t)fd);
+    if (!sock) return -1;
+    if (_AFTER(ticket, sock->tx_lost_lo) && !_AFTER(ticket, sock->tx_lost_hi))
+        return -1;
+    return _AFTER(ticket, sock->tx_done) ? 0 : 1;
+}
+
+void squid_on_delivered(squid_delivered_fn fn, void *arg)
 {
-    if (fd < 1 || fd > 15 || !buf || max == 0) return -1;
+    g_snet.on_delivered  = fn;
+    g_snet.delivered_arg = arg;
+}
+
+int squid_recvv(int fd, const squid_iovec_t *iov, uint8_t cnt)
+{
+    if (fd < 1 || fd > SNET_CFG_CHANNELS || !iov || cnt == 0) return -1;
     if (!g_snet.plat) return -1;
 
     snet_chan_t *sock = _find_by_fd((uint8_t)fd);
     if (!sock || sock->ch_id == 0u) return -1;
 
-    /* copy queued RX blocks into caller's buffer, freeing as we go */
-    uint16_t total = 0;
-    while (sock->rx_head && total < max) {
-        snet_node_t *n = sock->rx_head;
-        uint16_t avail = n->len - n->off;
-        uint16_t take  = (avail > (max - total)) ? (max - total) : avail;
-        memcpy(buf + total, n->data + n->off, take);
-        n->off += take;
-        total  += take;
-        sock->rx_bytes -= take;
-        if (n->off >= n->len) {         /* block fully consumed — release */
-            sock->rx_head = n->next;
-            if (!sock->rx_head) sock->rx_tail = (snet_node_t*)0;
-            g_snet.plat->free(n);
+    /* some room at all; lengths are not summed, so 2 x 32 KB cannot wrap
+     * to zero.  A queue holds at most UINT16_MAX bytes, so neither can
+     * the total returned */
+    bool any = false;
+    for (uint8_t i = 0; i < cnt; i++) {
+        if (iov[i].len && !iov[i].base) return -1;
+        if (iov[i].len) any = true;
+    }
+    if (!any) return -1;
+
+    SNET_PROF_BEGIN(t);
+#if !SNET_CFG_STATIC
+    if (sock->sub) {
+        snet_chan_t *lead = snet_chan_of(sock->ch_id);
+        int r = (int)snet_q_read(&lead->rxq, &sock->rx_cur, &sock->rx_bytes,
+                                 iov, cnt);
+        SNET_PROF_END(SNET_PROF_RECV, t);
+        return r;
+    }
+#endif
+    int r = (int)snet_q_get(&sock->rxq, &sock->rx_bytes, iov, cnt);
+    SNET_PROF_END(SNET_PROF_RECV, t);
+    return r;
+}
+
+int squid_setsockopt(int fd, int opt, uint16_t val)
+{
+    if (fd < 1 || fd > SNET_CFG_CHANNELS || !g_snet.plat) return -1;
+    snet_chan_t *sock = _find_by_fd((uint8_t)fd);
+    if (!sock) return -1;
+
+    switch (opt) {
+    case SQUID_SO_TXCAP:   sock->tx_cap   = val; return 0;
+    case SQUID_SO_RXCAP:   sock->rx_cap   = val; return 0;
+    case SQUID_SO_TXLOWAT: sock->tx_lowat = val; return 0;
+    default:               return -1;   /* unknown or read-only */
+    }
+}
+
+int squid_getsockopt(int fd, int opt, uint16_t *val)
+{
+    if (fd < 1 || fd > SNET_CFG_CHANNELS || !g_snet.plat || !val) return -1;
+    snet_chan_t *sock = _find_by_fd((uint8_t)fd);
+    if (!sock) return -1;
+
+    switch (opt) {
+    case SQUID_SO_TXCAP:    *val = sock->tx_cap;   return 0;
+    case SQUID_SO_RXCAP:    *val = sock->rx_cap;   return 0;
+    case SQUID_SO_TXLOWAT:  *val = sock->tx_lowat; return 0;
+    case SQUID_SO_TXQUEUED: *val = sock->tx_bytes; return 0;
+    case SQUID_SO_RXQUEUED: *val = sock->rx_bytes; return 0;
+    default:                return -1;
+    }
+}
+
+void squid_on_writable(squid_writable_fn fn, void *arg)
+{
+    g_snet.on_writable  = fn;
+    g_snet.writable_arg = arg;
+}
+
+void squid_set_budget(uint32_t bytes)
+{
+    g_snet.budget = bytes;
+}
+
+uint32_t squid_mem_used(void)
+{
+    return g_snet.q_mem;
+}
+
+/* ---- engine side: the DATA frame in flight was ACKed ---- */
+void snet_tx_acked(void)
+{
+    for (snet_chan_t *c = g_snet.chan_head; c; c = c->next) {
+#if SNET_CFG_STREAM
+        snet_stream_acked(c);
+#endif
+        if (!c->tx_flight) continue;
+        if (_AFTER(c->tx_confirm, c->tx_done)) {
+            c->tx_notify = 1u;
+            g_snet.tx_notify = 1u;
+        }
+        c->tx_done += c->tx_flight;
+        c->tx_flight = 0u;
+    }
+}
+
+/* ---- engine side: a fresh session dropped the DATA frame in flight ---- */
+void snet_tx_lost(void)
+{
+    for (snet_chan_t *c = g_snet.chan_head; c; c = c->next) {
+#if SNET_CFG_STREAM
+        snet_stream_lost(c);
+#endif
+        if (!c->tx_flight) continue;
+        /* every message with bytes past tx_done, queued so far, may be
+           missing some; later ones are whole.  An earlier loss keeps its
+           lo: the range only widens, so no lost ticket reads delivered */
+        if (c->tx_lost_lo == c->tx_lost_hi) c->tx_lost_lo = c->tx_done;
+        c->tx_lost_hi = c->tx_queued;
+        if (_AFTER(c->tx_confirm, c->tx_done)) {
+            c->tx_notify = 1u;
+            g_snet.tx_notify = 1u;
+        }
+        c->tx_done += c->tx_flight;
+        c->tx_flight = 0u;
+    }
+}
+
+/* ---- engine side: a payload for a subscribed channel (room checked) ---- */
+void snet_fan_rx(snet_chan_t *lead, const uint8_t *data, uint8_t len)
+{
+#if SNET_CFG_STATIC
+    squid_iovec_t iov;
+    iov.base = (uint8_t*)data;
+    iov.len  = len;
+    for (snet_chan_t *c = lead; c; c = c->sub_next)
+        (void)snet_q_put(&c->rxq, &c->rx_bytes, &iov, 1u, len);
+#else
+    uint8_t readers = 0u;
+    for (snet_chan_t *c = lead; c; c = c->sub_next) readers++;
+    snet_node_t *n = snet_q_put_shared(&lead->rxq, data, len, readers);
+    if (!n) return;
+    for (snet_chan_t *c = lead; c; c = c->sub_next) {
+        if (!c->rx_cur.rd) c->rx_cur.rd = n;    /* was caught up */
+        c->rx_bytes = (uint16_t)(c->rx_bytes + len);
+    }
+#endif
+}
+
+/* called from snet_burst(): writable and delivered callbacks.
+ * Callbacks may send, close or open sockets, so the list is walked
+ * again from the head after each one. */
+void snet_socket_events(void)
+{
+    g_snet.tx_notify = 0u;
+    snet_chan_t *c = g_snet.chan_head;
+    while (c) {
+        if (c->tx_notify) {
+            c->tx_notify = 0u;
+            if (g_snet.on_delivered) {
+                g_snet.on_delivered((int)c->fd, c->tx_done, g_snet.delivered_arg);
+                c = g_snet.chan_head;
+                continue;
+            }
+        }
+        if (c->tx_want && c->tx_bytes <= c->tx_lowat &&
+            _tx_fits(c, c->tx_want)) {
+            c->tx_want = 0u;
+            g_snet.tx_blocked--;
+            if (g_snet.on_writable) {
+                g_snet.on_writable((int)c->fd, g_snet.writable_arg);
+                c = g_snet.chan_head;
+                continue;
+            }
         }
+        c = c->next;
     }
-    return (int)total;
 }
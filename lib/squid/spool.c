@@ -0,0 +1,158 @@
+/* lib/squid/spool.c – disk-backed TX spool (POSIX).
+ *
+ * The file is mapped whole: a header with free-running head and tail
+ * positions, then a power-of-two data ring, so positions wrap with
+ * uint32_t arithmetic and index the ring with a mask.  The socket's
+ * stream source reads the ring from `base` (head when attached): stream
+ * offset 0 is position base, and the stream end is raised as writes
+ * arrive.  Uses only the public API, like squid_shm.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "squid/spool.h"
+
+#define SPOOL_MAGIC  0x53515331u    /* "SQS1" */
+#define SPOOL_MAX    (1u << 30)     /* largest ring (write returns int) */
+
+typedef struct {
+    uint32_t magic;                 /* set last when created */
+    uint32_t cap;
+    uint32_t head;                  /* oldest byte the peer has not ACKed */
+    uint32_t tail;                  /* next append position */
+} spool_hdr_t;
+
+static spool_hdr_t *_hdr(const squid_spool_t *sp) { return (spool_hdr_t*)sp->map; }
+
+static int _pow2(uint32_t v) { return v && !(v & (v - 1u)); }
+
+/* ---- stream source: up to the end of the ring, the engine asks again ---- */
+static int _read(void *ctx, uint32_t off, uint8_t *buf, uint16_t max)
+{
+    squid_spool_t *sp = (squid_spool_t*)ctx;
+    uint32_t at  = (sp->base + off) & (sp->cap - 1u);
+    uint32_t run = sp->cap - at;
+    if (run > max) run = max;
+    memcpy(buf, sp->map + SQUID_SPOOL_HDR + at, run);
+    return (int)run;
+}
+
+int squid_spool_open(squid_spool_t *sp, const char *path, uint32_t capacity)
+{
+    memset(sp, 0, sizeof(*sp));
+    sp->file = -1;
+
+    int f = open(path, O_RDWR | O_CREAT, 0644);
+    if (f < 0) return -1;
+    struct stat st;
+    if (fstat(f, &st) < 0) goto fail;
+
+    int fresh = st.st_size == 0;
+    if (fresh) {
+        if (!_pow2(capacity) || capacity > SPOOL_MAX) { errno = EINVAL; goto fail; }
+        if (ftruncate(f, (off_t)(SQUID_SPOOL_HDR + capacity)) < 0) goto fail;
+    } else {
+        capacity = (uint32_t)(st.st_size - SQUID_SPOOL_HDR);
+        if (st.st_size <= SQUID_SPOOL_HDR || !_pow2(capacity) ||
+            capacity > SPOOL_MAX) { errno = EINVAL; goto fail; }
+    }
+
+    void *m = mmap(NULL, SQUID_SPOOL_HDR + capacity, PROT_READ | PROT_WRITE,
+                   MAP_SHARED, f, 0);
+    if (m == MAP_FAILED) goto fail;
+    sp->map  = (uint8_t*)m;
+    sp->cap  = capacity;
+    sp->file = f;
+
+    spool_hdr_t *h = _hdr(sp);
+    if (fresh) {
+        h->cap  = capacity;
+        h->head = h->tail = 0u;
+        __atomic_store_n(&h->magic, SPOOL_MAGIC, __ATOMIC_RELEASE);
+    } else if (h->magic != SPOOL_MAGIC || h->cap != capacity ||
+               h->tail - h->head > capacity) {
+        squid_spool_close(sp);
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+
+fail:
+    close(f);
+    return -1;
+}
+
+int squid_spool_sync(squid_spool_t *sp)
+{
+    if (!sp->map) return -1;
+    return msync(sp->map, SQUID_SPOOL_HDR + sp->cap, MS_SYNC);
+}
+
+void squid_spool_close(squid_spool_t *sp)
+{
+    if (sp->map) {
+        (void)squid_spool_sync(sp);
+        munmap(sp->map, SQUID_SPOOL_HDR + sp->cap);
+    }
+    if (sp->file >= 0) close(sp->file);
+    sp->map  = (uint8_t*)0;
+    sp->file = -1;
+    sp->fd   = 0;
+}
+
+int squid_spool_attach(squid_spool_t *sp, int fd)
+{
+    if (!sp->map) return -1;
+    spool_hdr_t *h = _hdr(sp);
+    sp->fd   = fd;
+    sp->base = h->head;
+    sp->end  = h->tail - h->head;
+    return squid_stream_send(fd, _read, sp, 0u, sp->end);
+}
+
+int squid_spool_write(squid_spool_t *sp, const uint8_t *data, uint32_t len)
+{
+    if (!sp->map || len > sp->cap || (len && !data)) return -1;
+    spool_hdr_t *h = _hdr(sp);
+    uint32_t tail = h->tail;
+    if (len > sp->cap - (tail - h->head)) return SQUID_EAGAIN;
+
+    uint32_t at  = tail & (sp->cap - 1u);
+    uint32_t run = sp->cap - at;
+    if (run > len) run = len;
+    memcpy(sp->map + SQUID_SPOOL_HDR + at, data, run);
+    memcpy(sp->map + SQUID_SPOOL_HDR, data + run, len - run);
+    /* data first: a process crash leaves the old tail, never garbage.
+       The kernel may write the pages back in any order, so this says
+       nothing about power loss before squid_spool_sync() */
+    __atomic_store_n(&h->tail, tail + len, __ATOMIC_RELEASE);
+    return (int)len;
+}
+
+int32_t squid_spool_poll(squid_spool_t *sp)
+{
+    if (!sp->map || !sp->fd) return -1;
+    spool_hdr_t *h = _hdr(sp);
+
+    /* what the peer ACKed is gone for good: that is the room writes get.
+       A closed socket (or another engine current) writes no acked, and
+       attach below fails on it, so head stays where it is */
+    uint32_t acked = h->head - sp->base;
+    int rc = squid_stream_pos(sp->fd, &acked, (uint32_t*)0);
+    uint32_t head = sp->base + acked;
+    if ((int32_t)(head - h->head) > 0)
+        __atomic_store_n(&h->head, head, __ATOMIC_RELEASE);
+
+    if (rc < 0) {
+        /* new session: resend from the oldest unACKed byte */
+        if (squid_spool_attach(sp, sp->fd) < 0) return -1;
+    } else if (h->tail - sp->base != sp->end) {
+        sp->end = h->tail - sp->base;
+        if (squid_stream_extend(sp->fd, sp->end) < 0) return -1;
+    }
+    return (int32_t)(h->tail - h->head);
+}
@@ -0,0 +1,112 @@
+/* lib/squid/stream.c – stream sources and sinks on a socket.
+ *
+ * The source is pulled one payload at a time, straight into the DATA
+ * frame being built; the sink is pushed each accepted payload.  Neither
+ * side queues stream bytes, so memory use does not grow with the file.
+ * Stop-and-wait keeps one DATA in flight: its source bytes are acked when
+ * the peer ACKs it.
+ */
+#include "internal.h"
+
+#if SNET_CFG_STREAM
+
+static snet_chan_t *_sock(int fd)
+{
+    return g_snet.plat ? snet_sock(fd) : (snet_chan_t*)0;
+}
+
+int squid_stream_send(int fd, squid_read_fn rd, void *ctx,
+                      uint32_t off, uint32_t end)
+{
+    snet_chan_t *c = _sock(fd);
+    if (!c || c->ch_id == 0u || (rd && end < off)) return -1;
+    snet_stream_t *st = &c->st;
+    st->src       = rd;
+    st->src_ctx   = ctx;
+    st->tx_start  = off;
+    st->tx_off    = off;
+    st->tx_end    = rd ? end : off;
+    st->tx_acked  = off;
+    st->tx_flight = 0u;     /* a frame still in flight is not counted */
+    st->tx_err    = 0;
+    return 0;
+}
+
+int squid_stream_extend(int fd, uint32_t end)
+{
+    snet_chan_t *c = _sock(fd);
+    if (!c || !c->st.src || c->st.tx_err) return -1;
+    if ((int32_t)(end - c->st.tx_end) < 0) return -1;
+    c->st.tx_end = end;
+    return 0;
+}
+
+int squid_stream_recv(int fd, squid_write_fn wr, void *ctx, uint32_t off)
+{
+    snet_chan_t *c = _sock(fd);
+    if (!c || c->ch_id == 0u) return -1;
+    if (wr && c->sub) return -1;        /* subscribers share the RX queue */
+    c->st.sink     = wr;
+    c->st.sink_ctx = ctx;
+    c->st.rx_off   = off;
+    c->st.rx_err   = 0;
+    return 0;
+}
+
+int squid_stream_pos(int fd, uint32_t *acked, uint32_t *written)
+{
+    snet_chan_t *c = _sock(fd);
+    if (!c) return -1;
+    if (acked)   *acked   = c->st.tx_acked;
+    if (written) *written = c->st.rx_off;
+    if (c->st.tx_err || c->st.rx_err) return -1;
+    return (c->st.src && c->st.tx_acked != c->st.tx_end) ? 1 : 0;
+}
+
+/* ---- engine side ---- */
+
+uint8_t snet_stream_pull(snet_chan_t *ch, uint8_t *out, uint8_t max)
+{
+    snet_stream_t *st = &ch->st;
+    if (!st->src || st->tx_err || st->tx_off == st->tx_end) return 0u;
+    if ((uint32_t)max > st->tx_end - st->tx_off)
+        max = (uint8_t)(st->tx_end - st->tx_off);
+
+    int n = st->src(st->src_ctx, st->tx_off, out, max);
+    if (n <= 0 || n > max) {
+        st->tx_err = -1;
+        return 0u;
+    }
+    st->tx_off    += (uint32_t)n;
+    st->tx_flight  = (uint8_t)(st->tx_flight + n);
+    return (uint8_t)n;
+}
+
+void snet_stream_push(snet_chan_t *ch, const uint8_t *data, uint8_t len)
+{
+    snet_stream_t *st = &ch->st;
+    if (st->sink(st->sink_ctx, st->rx_off, data, len) < 0) {
+        st->sink   = (squid_write_fn)0;
+        st->rx_err = -1;
+        return;
+    }
+    st->rx_off += len;
+}
+
+void snet_stream_acked(snet_chan_t *ch)
+{
+    ch->st.tx_acked += ch->st.tx_flight;
+    ch->st.tx_flight = 0u;
+}
+
+/* fresh session: the peer's position is unknown */
+void snet_stream_lost(snet_chan_t *ch)
+{
+    snet_stream_t *st = &ch->st;
+    if (!st->src || st->tx_off == st->tx_start) return;
+    st->tx_off    = st->tx_acked;
+    st->tx_flight = 0u;
+    st->tx_err    = -1;
+}
+
+#endif
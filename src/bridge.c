@@ -0,0 +1,301 @@
+/* src/bridge.c – squid-bridge: serial link <-> local TCP / Unix sockets.
+ *
+ * Attaches one serial link and maps channels 1..255 to local listening
+ * sockets.  Each channel serves one client connection at a time; bytes
+ * move with non-blocking I/O from a single epoll loop.
+ *
+ * Backpressure:
+ *   client -> link  the channel TX queue is capped at BR_TX_CAP; a chunk
+ *                   the socket refuses (SQUID_EAGAIN) waits in the
+ *                   channel and the client is not read until the
+ *                   writable callback, at BR_TX_LOWAT.
+ *   link -> client  the channel RX queue is not drained while the client
+ *                   has unwritten bytes; at BR_RX_CAP the engine answers
+ *                   DATA with "busy" and the peer holds off.
+ *
+ * Usage:
+ *   squid-bridge -d /dev/ttyUSB0 [-s 115200] 1=tcp:7001 2=unix:/tmp/sq2
+ *   squid-bridge -d - 1=tcp:7001       serial on stdin/stdout (FIFOs);
+ *                                      EOF on stdin ends the bridge
+ *
+ * Testing over a pty pair:
+ *   socat -d -d pty,raw,echo=0 pty,raw,echo=0     (prints two paths)
+ *   squid-bridge -d /dev/pts/N 1=tcp:7001 &
+ *   squid-bridge -d /dev/pts/M 1=tcp:7002 &
+ *   nc localhost 7001   <->   nc localhost 7002
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <termios.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "squid/snet.h"
+#include "squid/socket.h"
+#include "relay.h"
+
+#define BR_TX_CAP     8192u   /* channel TX queue cap */
+#define BR_TX_LOWAT   4096u   /* resume reading at this (fits one chunk) */
+#define BR_RX_CAP     8192u   /* channel RX queue cap (busy above) */
+#define BR_TICK_US    1000    /* get_tick() period: 1 ms */
+#define BR_IDLE_MS    50      /* epoll timeout while the engine is idle */
+#define BR_MAX_EVENTS 32
+
+/* ================================================================== */
+/*  Serial link: userspace buffers behind the platform hooks          */
+/* ================================================================== */
+static int         ser_in_fd = -1, ser_out_fd = -1;
+static relay_buf_t ser_in, ser_out;
+
+static int br_send(uint8_t c)
+{
+    if (!buf_room(&ser_out)) return -1;
+    ser_out.buf[ser_out.head++ % RELAY_IOBUF] = c;
+    return 0;
+}
+
+static int br_recv(void) { return -1; }   /* input goes through snet_feed() */
+
+static uint8_t br_tick(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint8_t)((ts.tv_sec * (1000000L / BR_TICK_US) +
+                      ts.tv_nsec / (BR_TICK_US * 1000L)) & 0xFF);
+}
+
+static void *br_alloc(uint16_t n) { return malloc(n); }
+
+static const squid_platform_t plat = { br_send, br_recv, br_tick, br_alloc, free };
+
+/* ================================================================== */
+/*  Channel mappings                                                  */
+/* ================================================================== */
+static relay_chan_t chans[SNET_CFG_CHANNELS];
+static int          nchans;
+static int          ep = -1;
+static volatile sig_atomic_t quit;
+
+/* epoll user data: tags select the kind of fd */
+#define TAG_SERIAL   0x100u
+#define TAG_LISTEN   0x300u
+#define TAG_CLIENT   0x400u
+
+static void arm(int fd, uint32_t tag, uint32_t events, int op)
+{
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events   = events;
+    ev.data.u32 = tag;
+    epoll_ctl(ep, op, fd, &ev);
+}
+
+static void set_nonblock(int fd)
+{
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+static int parse_map(const char *arg, relay_chan_t *c)
+{
+    char *end;
+    long ch = strtol(arg, &end, 10);
+    if (ch < 1 || ch > SNET_CFG_CH_MAX || *end != '=') return -1;
+    c->ch  = (uint8_t)ch;
+    c->cfd = -1;
+    c->lfd = -1;
+    arg = end + 1;
+
+    if (!strncmp(arg, "tcp:", 4)) {
+        long port = strtol(arg + 4, &end, 10);
+        if (port < 1 || port > 65535 || *end) return -1;
+        struct sockaddr_in sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sin_family      = AF_INET;
+        sa.sin_port        = htons((uint16_t)port);
+        sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        int one = 1;
+        c->lfd = socket(AF_INET, SOCK_STREAM, 0);
+        if (c->lfd < 0) return -1;
+        setsockopt(c->lfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(c->lfd, (struct sockaddr*)&sa, sizeof(sa)) < 0) return -1;
+    } else if (!strncmp(arg, "unix:", 5)) {
+        struct sockaddr_un su;
+        memset(&su, 0, sizeof(su));
+        su.sun_family = AF_UNIX;
+        if (strlen(arg + 5) >= sizeof(su.sun_path)) return -1;
+        strcpy(su.sun_path, arg + 5);
+        strcpy(c->path, arg + 5);
+        unlink(c->path);
+        c->lfd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (c->lfd < 0) return -1;
+        if (bind(c->lfd, (struct sockaddr*)&su, sizeof(su)) < 0) return -1;
+    } else {
+        return -1;
+    }
+    if (listen(c->lfd, 4) < 0) return -1;
+    set_nonblock(c->lfd);
+    return 0;
+}
+
+static int open_serial(const char *dev, long baud)
+{
+    if (!strcmp(dev, "-")) {
+        ser_in_fd  = 0;
+        ser_out_fd = 1;
+    } else {
+        ser_in_fd = ser_out_fd = open(dev, O_RDWR | O_NOCTTY);
+        if (ser_in_fd < 0) return -1;
+        if (isatty(ser_in_fd)) {
+            struct termios t;
+            speed_t sp = (baud == 9600)   ? B9600   : (baud == 19200) ? B19200 :
+                         (baud == 38400)  ? B38400  : (baud == 57600) ? B57600 :
+                         B115200;
+            tcgetattr(ser_in_fd, &t);
+            cfmakeraw(&t);
+            cfsetispeed(&t, sp);
+            cfsetospeed(&t, sp);
+            tcsetattr(ser_in_fd, TCSANOW, &t);
+        }
+    }
+    set_nonblock(ser_in_fd);
+    set_nonblock(ser_out_fd);
+    return 0;
+}
+
+/* TX queue drained to BR_TX_LOWAT: the held chunk fits again */
+static void on_writable(int fd, void *arg)
+{
+    (void)arg;
+    for (int i = 0; i < nchans; i++)
+        if (chans[i].sock == fd) chans[i].tx_full = 0;
+}
+
+/* ================================================================== */
+/*  Main loop                                                         */
+/* ================================================================== */
+static void on_signal(int sig) { (void)sig; quit = 1; }
+
+static void usage(void)
+{
+    fprintf(stderr,
+        "usage: squid-bridge -d DEV|- [-s BAUD] CH=tcp:PORT|CH=unix:PATH ...\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *dev = NULL;
+    long baud = 115200;
+    int opt;
+    while ((opt = getopt(argc, argv, "d:s:h")) != -1) {
+        if (opt == 'd')      dev  = optarg;
+        else if (opt == 's') baud = strtol(optarg, NULL, 10);
+        else { usage(); return 2; }
+    }
+    if (!dev || optind >= argc) { usage(); return 2; }
+
+    for (; optind < argc && nchans < SNET_CFG_CHANNELS; optind++) {
+        if (parse_map(argv[optind], &chans[nchans]) < 0) {
+            fprintf(stderr, "bad mapping or bind failed: %s\n", argv[optind]);
+            return 1;
+        }
+        nchans++;
+    }
+    if (open_serial(dev, baud) < 0) { perror(dev); return 1; }
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT,  on_signal);
+    signal(SIGTERM, on_signal);
+
+    /* 1 ms ticks: 50 ms resend timeout, ACK after 1 ms, 200 ms ping */
+    squid_timing_t tm = { 50, 1, 200, 5 };
+    snet_init(&plat, &tm);
+    /* take effect only when the far end offers them too */
+    snet_set_features(SNET_FEAT_XCH | SNET_FEAT_SHORT);
+    for (int i = 0; i < nchans; i++) {
+        chans[i].sock = squid_open();
+        if (chans[i].sock < 0 || squid_bind(chans[i].sock, chans[i].ch) < 0) {
+            fprintf(stderr, "channel %u: socket setup failed\n", chans[i].ch);
+            return 1;
+        }
+        squid_setsockopt(chans[i].sock, SQUID_SO_RXCAP, BR_RX_CAP);
+        squid_setsockopt(chans[i].sock, SQUID_SO_TXCAP, BR_TX_CAP);
+        squid_setsockopt(chans[i].sock, SQUID_SO_TXLOWAT, BR_TX_LOWAT);
+    }
+    squid_on_writable(on_writable, NULL);
+
+    ep = epoll_create1(0);
+    arm(ser_in_fd, TAG_SERIAL, EPOLLIN, EPOLL_CTL_ADD);
+    uint32_t ser_out_ev = 0;
+    for (int i = 0; i < nchans; i++) {
+        arm(chans[i].lfd, TAG_LISTEN | (uint32_t)i, EPOLLIN, EPOLL_CTL_ADD);
+        chans[i].ctag.u32 = TAG_CLIENT | (uint32_t)i;
+    }
+
+    while (!quit) {
+        struct epoll_event evs[BR_MAX_EVENTS];
+        int n = epoll_wait(ep, evs, BR_MAX_EVENTS, snet_idle() ? BR_IDLE_MS : 1);
+        if (n < 0 && errno != EINTR) break;
+
+        for (int k = 0; k < n; k++) {
+            uint32_t tag = evs[k].data.u32 & 0xF00u;
+            int      idx = (int)(evs[k].data.u32 & 0xFFu);
+            uint32_t e   = evs[k].events;
+            if (tag == TAG_SERIAL && idx == 0) {
+                /* EOF stays readable: quit rather than spin on it */
+                if (buf_fill(&ser_in, ser_in_fd) < 0) quit = 1;
+            } else if (tag == TAG_SERIAL) {
+                /* serial writable: drained below */
+            } else if (tag == TAG_LISTEN) {
+                client_accept(ep, &chans[idx]);
+            } else if (tag == TAG_CLIENT) {
+                relay_chan_t *c = &chans[idx];
+                if (e & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) client_read(ep, c);
+                if (c->cfd >= 0 && (e & EPOLLOUT)) client_write(ep, c);
+            }
+        }
+
+        /* decode all buffered input in one pass, then transmit */
+        buf_feed(&ser_in);
+        snet_burst();
+
+        for (int i = 0; i < nchans; i++) {
+            relay_chan_t *c = &chans[i];
+            if (c->cfd < 0) continue;
+            client_write(ep, c);
+            if (c->cfd >= 0 && !c->tx_full && (c->cev & EPOLLIN) == 0)
+                client_read(ep, c);
+            client_rearm(ep, c);
+        }
+
+        if (buf_drain(&ser_out, ser_out_fd) < 0) break;
+        uint32_t want = buf_used(&ser_out) ? EPOLLOUT : 0u;
+        if (ser_out_fd != ser_in_fd) {
+            if (want != ser_out_ev) {
+                arm(ser_out_fd, TAG_SERIAL | 1u, want,
+                    ser_out_ev ? (want ? EPOLL_CTL_MOD : EPOLL_CTL_DEL)
+                               : EPOLL_CTL_ADD);
+            }
+        } else if (want != ser_out_ev) {
+            arm(ser_in_fd, TAG_SERIAL, EPOLLIN | want, EPOLL_CTL_MOD);
+        }
+        ser_out_ev = want;
+    }
+
+    for (int i = 0; i < nchans; i++) {
+        client_close(ep, &chans[i]);
+        close(chans[i].lfd);
+        if (chans[i].path[0]) unlink(chans[i].path);
+        squid_close(chans[i].sock);
+    }
+    return 0;
+}
@@ -0,0 +1,706 @@
+/* src/hub.c – squid-hub: many serial links in one process.
+ *
+ * Every link runs its own engine instance.  Links are sharded across
+ * worker threads, one epoll loop each, built on squid_mt so each
+ * thread selects its current engine.  Every HUB_BAL_MS a worker
+ * publishes its load (serial bytes moved); a worker well below the
+ * busiest one asks it for a link, and the victim hands over the link
+ * whose move best evens the two loads.  Links change hands only at the
+ * top of the victim's loop, so an engine is never used by two threads.
+ *
+ * Each link exposes its channels as Unix sockets DIR/<link>.<ch>, one
+ * client per socket, with the same backpressure as squid-bridge.
+ *
+ * Usage:
+ *   squid-hub [-w WORKERS] [-s BAUD] [-D DIR] [-c CH,CH..] DEV...
+ *   squid-hub -B [-n LINKS] [-w MAXWORKERS] [-t SECS] [-0]
+ *
+ * -B benchmarks the hub over socketpairs: LINKS/2 peer pairs stream
+ * both ways on channel 1, measured with 1, 2, 4 .. MAXWORKERS workers.
+ * -0 starts every link on worker 0 so the spread comes from stealing.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <termios.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "squid/snet.h"
+#include "squid/socket.h"
+#include "relay.h"
+
+#define HUB_TX_CAP      8192u   /* channel TX queue cap (EAGAIN above) */
+#define HUB_TX_LOWAT    4096u   /* writable callback below this */
+#define HUB_RX_CAP      8192u   /* channel RX queue cap (busy above) */
+#define HUB_TICK_US     1000    /* get_tick() period: 1 ms */
+#define HUB_IDLE_MS     50      /* epoll timeout while all engines idle */
+#define HUB_BAL_MS      100     /* load sampling / stealing period */
+#define HUB_STEAL_MIN   2048u   /* ignore imbalance below this (bytes) */
+#define HUB_MAX_EVENTS  64
+#define HUB_MAX_WORKERS 64
+#define HUB_CH_MAX      SNET_CFG_CHANNELS
+
+/* ================================================================== */
+/*  Links, channels, workers                                          */
+/* ================================================================== */
+struct hub_link;
+
+enum { FD_SERIAL, FD_LISTEN, FD_CLIENT, FD_WAKE };
+
+typedef struct {              /* epoll user data */
+    uint8_t kind;
+    uint8_t idx;              /* channel slot */
+    struct hub_link *l;
+} hub_fd_t;
+
+typedef struct hub_link {
+    int             id;
+    squid_engine_t *eng;
+    int             fd;       /* serial device or socketpair end */
+    uint32_t        sev;      /* epoll events armed on fd */
+    int             dead;
+    hub_fd_t        sref;
+    relay_buf_t     in, out;
+    relay_chan_t    chans[HUB_CH_MAX];
+    hub_fd_t        lref[HUB_CH_MAX], cref[HUB_CH_MAX];
+    int             nchans;
+    uint32_t        work;     /* serial bytes this period */
+    uint32_t        load;     /* smoothed work per period */
+    struct hub_link *next_in; /* handoff list */
+
+    /* benchmark stream on channel 1 */
+    int             bsock;
+    uint32_t        gen, chk; /* stream positions out / in */
+    uint64_t        rx_total;
+    int             bad;
+} hub_link_t;
+
+typedef struct {
+    int              id;
+    pthread_t        th;
+    int              ep, evfd;
+    hub_fd_t         wref;
+    hub_link_t     **own;     /* links this worker runs */
+    int              nown;
+    pthread_mutex_t  lock;    /* guards inbox */
+    hub_link_t      *inbox;   /* links handed to this worker */
+    uint32_t         load;    /* published per period (atomic) */
+    int              steal_to;/* thief id asking us, -1 = none (atomic) */
+    uint32_t         moved;   /* links given away */
+    uint64_t         last_bal;
+} hub_worker_t;
+
+static hub_worker_t workers[HUB_MAX_WORKERS];
+static int          nworkers;
+static hub_link_t  *links;
+static int          nlinks;
+static int          quit;     /* atomic */
+static int          bench;
+
+static __thread hub_link_t *t_link;   /* link whose engine is current */
+static __thread uint8_t     t_tick;   /* sampled once per loop */
+
+/* ================================================================== */
+/*  Platform hooks: act on the current thread's link                  */
+/* ================================================================== */
+static int hub_send(uint8_t c)
+{
+    relay_buf_t *b = &t_link->out;
+    if (!buf_room(b)) return -1;
+    b->buf[b->head++ % RELAY_IOBUF] = c;
+    return 0;
+}
+
+static int hub_recv(void) { return -1; }  /* input goes through snet_feed() */
+
+static uint8_t hub_tick(void) { return t_tick; }
+
+static void *hub_alloc(uint16_t n) { return malloc(n); }
+
+static const squid_platform_t plat = {
+    hub_send, hub_recv, hub_tick, hub_alloc, free
+};
+
+static uint64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+static void use_link(hub_link_t *l)
+{
+    t_link = l;
+    snet_engine_use(l->eng);
+}
+
+static void arm(int ep, int fd, hub_fd_t *ref, uint32_t events, int op)
+{
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events   = events;
+    ev.data.ptr = ref;
+    epoll_ctl(ep, op, fd, &ev);
+}
+
+static void set_nonblock(int fd)
+{
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+/* TX queue drained to HUB_TX_LOWAT: the held chunk fits again */
+static void on_writable(int fd, void *arg)
+{
+    (void)arg;
+    for (int i = 0; i < t_link->nchans; i++)
+        if (t_link->chans[i].sock == fd) t_link->chans[i].tx_full = 0;
+}
+
+/* ================================================================== */
+/*  Benchmark stream: a position-keyed byte pattern both ways         */
+/* ================================================================== */
+static uint8_t pattern(uint32_t i) { return (uint8_t)(i * 7u + (i >> 8)); }
+
+/* fill the TX queue up to HUB_TX_CAP; a refused chunk is regenerated */
+static void bench_feed(hub_link_t *l)
+{
+    uint8_t buf[512];
+    for (;;) {
+        for (unsigned i = 0; i < sizeof(buf); i++) buf[i] = pattern(l->gen + i);
+        if (squid_send(l->bsock, buf, sizeof(buf)) != (int)sizeof(buf)) return;
+        l->gen += sizeof(buf);
+    }
+}
+
+static void bench_drain(hub_link_t *l)
+{
+    uint8_t buf[RELAY_IOBUF];
+    int n;
+    while ((n = squid_recv(l->bsock, buf, sizeof(buf))) > 0) {
+        for (int i = 0; i < n; i++)
+            if (buf[i] != pattern(l->chk++)) l->bad = 1;
+        __atomic_fetch_add(&l->rx_total, (uint64_t)n, __ATOMIC_RELAXED);
+    }
+}
+
+/* ================================================================== */
+/*  Link ownership                                                    */
+/* ================================================================== */
+static void link_attach(hub_worker_t *w, hub_link_t *l)
+{
+    w->own[w->nown++] = l;
+    if (l->dead) return;
+    arm(w->ep, l->fd, &l->sref, l->sev, EPOLL_CTL_ADD);
+    for (int i = 0; i < l->nchans; i++) {
+        relay_chan_t *c = &l->chans[i];
+        if (c->lfd >= 0) arm(w->ep, c->lfd, &l->lref[i], EPOLLIN, EPOLL_CTL_ADD);
+        if (c->cfd >= 0) arm(w->ep, c->cfd, &l->cref[i], c->cev, EPOLL_CTL_ADD);
+    }
+}
+
+static hub_link_t *link_detach(hub_worker_t *w, int at)
+{
+    hub_link_t *l = w->own[at];
+    w->own[at] = w->own[--w->nown];
+    if (l->dead) return l;
+    epoll_ctl(w->ep, EPOLL_CTL_DEL, l->fd, NULL);
+    for (int i = 0; i < l->nchans; i++) {
+        relay_chan_t *c = &l->chans[i];
+        if (c->lfd >= 0) epoll_ctl(w->ep, EPOLL_CTL_DEL, c->lfd, NULL);
+        if (c->cfd >= 0) epoll_ctl(w->ep, EPOLL_CTL_DEL, c->cfd, NULL);
+    }
+    return l;
+}
+
+static void link_fail(hub_worker_t *w, hub_link_t *l)
+{
+    if (l->dead) return;
+    fprintf(stderr, "link %d: serial closed\n", l->id);
+    epoll_ctl(w->ep, EPOLL_CTL_DEL, l->fd, NULL);
+    for (int i = 0; i < l->nchans; i++) client_close(w->ep, &l->chans[i]);
+    l->dead = 1;
+}
+
+/* hand a link to another worker; it is attached at the top of its loop */
+static void link_give(hub_worker_t *to, hub_link_t *l)
+{
+    uint64_t one = 1;
+    pthread_mutex_lock(&to->lock);
+    l->next_in = to->inbox;
+    to->inbox  = l;
+    pthread_mutex_unlock(&to->lock);
+    if (write(to->evfd, &one, sizeof(one)) < 0) { /* counter saturated: already pending */ }
+}
+
+static void worker_adopt(hub_worker_t *w)
+{
+    pthread_mutex_lock(&w->lock);
+    hub_link_t *l = w->inbox;
+    w->inbox = (hub_link_t*)0;
+    pthread_mutex_unlock(&w->lock);
+    while (l) {
+        hub_link_t *nx = l->next_in;
+        link_attach(w, l);
+        l = nx;
+    }
+}
+
+/* ================================================================== */
+/*  Work stealing                                                     */
+/* ================================================================== */
+static uint32_t own_load(const hub_worker_t *w)
+{
+    uint32_t sum = 0;
+    for (int i = 0; i < w->nown; i++) sum += w->own[i]->load;
+    return sum;
+}
+
+/* a thief asked: hand over links while each move evens the two loads */
+static void worker_give(hub_worker_t *w)
+{
+    int to = __atomic_load_n(&w->steal_to, __ATOMIC_ACQUIRE);
+    if (to < 0) return;
+
+    int64_t mine   = own_load(w);
+    int64_t theirs = __atomic_load_n(&workers[to].load, __ATOMIC_RELAXED);
+    for (;;) {
+        int64_t best = mine > theirs ? mine - theirs : theirs - mine;
+        int     pick = -1;
+        for (int i = 0; i < w->nown; i++) {
+            int64_t x = w->own[i]->load;
+            if (!x) continue;
+            int64_t gap = (mine - x) - (theirs + x);
+            if (gap < 0) gap = -gap;
+            if (gap < best) { best = gap; pick = i; }
+        }
+        if (pick < 0) break;
+        mine   -= w->own[pick]->load;
+        theirs += w->own[pick]->load;
+        link_give(&workers[to], link_detach(w, pick));
+        w->moved++;
+    }
+    __atomic_store_n(&w->steal_to, -1, __ATOMIC_RELEASE);
+}
+
+static void worker_balance(hub_worker_t *w, uint64_t now)
+{
+    if (now - w->last_bal < HUB_BAL_MS * 1000u) return;
+    w->last_bal = now;
+
+    for (int i = 0; i < w->nown; i++) {
+        hub_link_t *l = w->own[i];
+        l->load = (l->load + l->work) / 2u;
+        l->work = 0;
+    }
+    uint32_t mine = own_load(w);
+    __atomic_store_n(&w->load, mine, __ATOMIC_RELAXED);
+    if (nworkers < 2) return;
+
+    hub_worker_t *v = (hub_worker_t*)0;
+    uint32_t vload = 0;
+    for (int i = 0; i < nworkers; i++) {
+        uint32_t x = __atomic_load_n(&workers[i].load, __ATOMIC_RELAXED);
+        if (i != w->id && x > vload) { v = &workers[i]; vload = x; }
+    }
+    if (v && vload > 2u * mine + HUB_STEAL_MIN) {
+        int none = -1;
+        __atomic_compare_exchange_n(&v->steal_to, &none, w->id, 0,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+    }
+}
+
+/* ================================================================== */
+/*  Worker loop                                                       */
+/* ================================================================== */
+static void link_service(hub_worker_t *w, hub_link_t *l)
+{
+    use_link(l);
+    if (bench) bench_feed(l);
+
+    /* decode all buffered input in one pass, then transmit */
+    buf_feed(&l->in);
+    snet_burst();
+
+    if (bench) {
+        bench_drain(l);
+    } else {
+        for (int i = 0; i < l->nchans; i++) {
+            relay_chan_t *c = &l->chans[i];
+            if (c->cfd < 0) continue;
+            client_write(w->ep, c);
+            if (c->cfd >= 0 && !c->tx_full && (c->cev & EPOLLIN) == 0)
+                client_read(w->ep, c);
+            client_rearm(w->ep, c);
+        }
+    }
+
+    uint16_t queued = buf_used(&l->out);
+    if (buf_drain(&l->out, l->fd) < 0) { link_fail(w, l); return; }
+    l->work += (uint32_t)(queued - buf_used(&l->out));
+
+    uint32_t want = EPOLLIN | (buf_used(&l->out) ? EPOLLOUT : 0u);
+    if (want != l->sev) {
+        arm(w->ep, l->fd, &l->sref, want, EPOLL_CTL_MOD);
+        l->sev = want;
+    }
+}
+
+static void *worker_main(void *arg)
+{
+    hub_worker_t *w = (hub_worker_t*)arg;
+    w->last_bal = now_us();
+
+    while (!__atomic_load_n(&quit, __ATOMIC_RELAXED)) {
+        worker_adopt(w);
+        worker_give(w);
+
+        int busy = bench;
+        for (int i = 0; i < w->nown && !busy; i++) {
+            use_link(w->own[i]);
+            busy = !w->own[i]->dead && !snet_idle();
+        }
+
+        struct epoll_event evs[HUB_MAX_EVENTS];
+        int n = epoll_wait(w->ep, evs, HUB_MAX_EVENTS, busy ? 1 : HUB_IDLE_MS);
+        if (n < 0 && errno != EINTR) break;
+
+        uint64_t now = now_us();
+        t_tick = (uint8_t)(now / HUB_TICK_US);
+
+        for (int k = 0; k < n; k++) {
+            hub_fd_t  *r = (hub_fd_t*)evs[k].data.ptr;
+            hub_link_t *l = r->l;
+            uint32_t   e = evs[k].events;
+            if (r->kind == FD_WAKE) {
+                uint64_t v;
+                if (read(w->evfd, &v, sizeof(v)) < 0) { /* spurious */ }
+            } else if (r->kind == FD_SERIAL) {
+                if (l->dead || !(e & (EPOLLIN | EPOLLHUP | EPOLLERR))) continue;
+                uint16_t had = buf_used(&l->in);
+                if (buf_fill(&l->in, l->fd) < 0) link_fail(w, l);
+                l->work += (uint32_t)(uint16_t)(buf_used(&l->in) - had);
+            } else if (r->kind == FD_LISTEN) {
+                client_accept(w->ep, &l->chans[r->idx]);
+            } else if (r->kind == FD_CLIENT) {
+                relay_chan_t *c = &l->chans[r->idx];
+                use_link(l);
+                if (e & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) client_read(w->ep, c);
+                if (c->cfd >= 0 && (e & EPOLLOUT)) client_write(w->ep, c);
+            }
+        }
+
+        for (int i = 0; i < w->nown; i++)
+            if (!w->own[i]->dead) link_service(w, w->own[i]);
+
+        worker_balance(w, now);
+    }
+    return NULL;
+}
+
+/* ================================================================== */
+/*  Setup and teardown                                                */
+/* ================================================================== */
+static int open_serial(const char *dev, long baud)
+{
+    int fd = open(dev, O_RDWR | O_NOCTTY);
+    if (fd < 0) return -1;
+    if (isatty(fd)) {
+        struct termios t;
+        speed_t sp = (baud == 9600)   ? B9600   : (baud == 19200) ? B19200 :
+                     (baud == 38400)  ? B38400  : (baud == 57600) ? B57600 :
+                     B115200;
+        tcgetattr(fd, &t);
+        cfmakeraw(&t);
+        cfsetispeed(&t, sp);
+        cfsetospeed(&t, sp);
+        tcsetattr(fd, TCSANOW, &t);
+    }
+    set_nonblock(fd);
+    return fd;
+}
+
+static int open_listener(relay_chan_t *c, const char *dir, int id)
+{
+    struct sockaddr_un su;
+    memset(&su, 0, sizeof(su));
+    su.sun_family = AF_UNIX;
+    if (snprintf(c->path, sizeof(c->path), "%s/%d.%u", dir, id, c->ch) >=
+        (int)sizeof(c->path)) return -1;
+    strcpy(su.sun_path, c->path);
+    unlink(c->path);
+    c->lfd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (c->lfd < 0) return -1;
+    if (bind(c->lfd, (struct sockaddr*)&su, sizeof(su)) < 0) return -1;
+    if (listen(c->lfd, 4) < 0) return -1;
+    set_nonblock(c->lfd);
+    return 0;
+}
+
+/* engine + sockets for one link; runs on the main thread before start */
+static int link_init(hub_link_t *l, int id, int fd)
+{
+    /* 1 ms ticks: 50 ms resend timeout, ACK after 1 ms, 200 ms ping */
+    squid_timing_t tm = { 50, 1, 200, 5 };
+    l->id        = id;
+    l->fd        = fd;
+    l->sev       = EPOLLIN;
+    l->sref.kind = FD_SERIAL;
+    l->sref.l    = l;
+    l->eng       = (squid_engine_t*)calloc(1, snet_engine_size());
+    if (!l->eng) return -1;
+
+    use_link(l);
+    snet_init(&plat, &tm);
+    snet_set_features(SNET_FEAT_PACK | SNET_FEAT_RESUME | SNET_FEAT_LONG |
+                      SNET_FEAT_XCH | SNET_FEAT_SHORT);
+    for (int i = 0; i < l->nchans; i++) {
+        relay_chan_t *c = &l->chans[i];
+        c->sock = squid_open();
+        if (c->sock < 0 || squid_bind(c->sock, c->ch) < 0) return -1;
+        squid_setsockopt(c->sock, SQUID_SO_RXCAP, HUB_RX_CAP);
+        squid_setsockopt(c->sock, SQUID_SO_TXCAP, HUB_TX_CAP);
+        squid_setsockopt(c->sock, SQUID_SO_TXLOWAT, HUB_TX_LOWAT);
+        l->lref[i].kind = FD_LISTEN;
+        l->cref[i].kind = FD_CLIENT;
+        l->lref[i].idx  = l->cref[i].idx = (uint8_t)i;
+        l->lref[i].l    = l->cref[i].l   = l;
+        c->ctag.ptr     = &l->cref[i];
+    }
+    squid_on_writable(on_writable, NULL);
+    if (bench) {
+        l->bsock = squid_open();
+        if (l->bsock < 0 || squid_bind(l->bsock, 1) < 0) return -1;
+        squid_setsockopt(l->bsock, SQUID_SO_RXCAP, HUB_RX_CAP);
+        squid_setsockopt(l->bsock, SQUID_SO_TXCAP, HUB_TX_CAP);
+    }
+    return 0;
+}
+
+static void link_free(hub_link_t *l)
+{
+    use_link(l);
+    snet_init(NULL, NULL);                  /* frees channels and queues */
+    snet_engine_use(NULL);
+    for (int i = 0; i < l->nchans; i++) {
+        relay_chan_t *c = &l->chans[i];
+        if (c->cfd >= 0) close(c->cfd);
+        if (c->lfd >= 0) close(c->lfd);
+        if (c->path[0]) unlink(c->path);
+    }
+    if (!l->dead) close(l->fd);
+    free(l->eng);
+}
+
+static int workers_start(int n, int all_on_0)
+{
+    nworkers = n;
+    __atomic_store_n(&quit, 0, __ATOMIC_RELAXED);
+    for (int i = 0; i < n; i++) {
+        hub_worker_t *w = &workers[i];
+        memset(w, 0, sizeof(*w));
+        w->id       = i;
+        w->steal_to = -1;
+        w->ep       = epoll_create1(0);
+        w->evfd     = eventfd(0, EFD_NONBLOCK);
+        w->own      = (hub_link_t**)calloc((size_t)nlinks, sizeof(*w->own));
+        if (w->ep < 0 || w->evfd < 0 || !w->own) return -1;
+        pthread_mutex_init(&w->lock, NULL);
+        w->wref.kind = FD_WAKE;
+        arm(w->ep, w->evfd, &w->wref, EPOLLIN, EPOLL_CTL_ADD);
+    }
+    for (int i = 0; i < nlinks; i++)
+        link_attach(&workers[all_on_0 ? 0 : i % n], &links[i]);
+    for (int i = 0; i < n; i++)
+        if (pthread_create(&workers[i].th, NULL, worker_main, &workers[i]))
+            return -1;
+    return 0;
+}
+
+static uint32_t workers_stop(void)
+{
+    uint32_t moved = 0;
+    __atomic_store_n(&quit, 1, __ATOMIC_RELAXED);
+    for (int i = 0; i < nworkers; i++) {
+        hub_worker_t *w = &workers[i];
+        pthread_join(w->th, NULL);
+        moved += w->moved;
+        close(w->ep);
+        close(w->evfd);
+        free(w->own);
+        pthread_mutex_destroy(&w->lock);
+    }
+    return moved;
+}
+
+/* ================================================================== */
+/*  Benchmark                                                         */
+/* ================================================================== */
+static uint64_t bench_bytes(void)
+{
+    uint64_t sum = 0;
+    for (int i = 0; i < nlinks; i++)
+        sum += __atomic_load_n(&links[i].rx_total, __ATOMIC_RELAXED);
+    return sum;
+}
+
+static int bench_round(int n, int w, double secs, int all_on_0,
+                       double *kbs, uint32_t *moved)
+{
+    nlinks = n;
+    links  = (hub_link_t*)calloc((size_t)n, sizeof(*links));
+    if (!links) return -1;
+    for (int i = 0; i < n; i += 2) {
+        int sv[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) return -1;
+        set_nonblock(sv[0]);
+        set_nonblock(sv[1]);
+        t_tick = (uint8_t)(now_us() / HUB_TICK_US);
+        if (link_init(&links[i], i, sv[0]) < 0 ||
+            link_init(&links[i + 1], i + 1, sv[1]) < 0) return -1;
+    }
+    if (workers_start(w, all_on_0) < 0) return -1;
+
+    usleep(200000);                                 /* handshakes, steals */
+    uint64_t b0 = bench_bytes(), t0 = now_us();
+    usleep((useconds_t)(secs * 1e6));
+    uint64_t b1 = bench_bytes(), t1 = now_us();
+    *moved = workers_stop();
+
+    int bad = 0;
+    for (int i = 0; i < n; i++) {
+        bad |= links[i].bad;
+        link_free(&links[i]);
+    }
+    free(links);
+    links = (hub_link_t*)0;
+
+    *kbs = (double)(b1 - b0) / 1024.0 / ((double)(t1 - t0) / 1e6);
+    return bad ? -1 : 0;
+}
+
+static int run_bench(int n, int maxw, double secs, int all_on_0)
+{
+    double   base = 0.0, kbs;
+    uint32_t moved;
+    printf(" links  workers   total KB/s  per-link KB/s  moved  speedup\n");
+    for (int w = 1; w <= maxw; w = (w * 2 > maxw && w < maxw) ? maxw : w * 2) {
+        if (bench_round(n, w, secs, all_on_0, &kbs, &moved) < 0) {
+            fprintf(stderr, "benchmark: stream corrupted or setup failed\n");
+            return 1;
+        }
+        if (w == 1) base = kbs;
+        printf("%6d %8d %12.0f %14.1f %6u %7.2fx\n", n, w, kbs, kbs / n,
+               moved, base > 0.0 ? kbs / base : 0.0);
+        fflush(stdout);
+        if (kbs <= 0.0) {
+            fprintf(stderr, "benchmark: no data moved\n");
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* ================================================================== */
+/*  Main                                                              */
+/* ================================================================== */
+static void usage(void)
+{
+    fprintf(stderr,
+        "usage: squid-hub [-w WORKERS] [-s BAUD] [-D DIR] [-c CH,..] DEV...\n"
+        "       squid-hub -B [-n LINKS] [-w MAXWORKERS] [-t SECS] [-0]\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *dir = "/tmp/squid-hub", *chs = "1";
+    long   baud = 115200;
+    int    nw = (int)sysconf(_SC_NPROCESSORS_ONLN), n = 64, all_on_0 = 0;
+    double secs = 2.0;
+    int    opt;
+    while ((opt = getopt(argc, argv, "w:s:D:c:Bn:t:0h")) != -1) {
+        if (opt == 'w')      nw    = atoi(optarg);
+        else if (opt == 's') baud  = strtol(optarg, NULL, 10);
+        else if (opt == 'D') dir   = optarg;
+        else if (opt == 'c') chs   = optarg;
+        else if (opt == 'B') bench = 1;
+        else if (opt == 'n') n     = atoi(optarg);
+        else if (opt == 't') secs  = atof(optarg);
+        else if (opt == '0') all_on_0 = 1;
+        else { usage(); return 2; }
+    }
+    if (nw < 1) nw = 1;
+    if (nw > HUB_MAX_WORKERS) nw = HUB_MAX_WORKERS;
+    signal(SIGPIPE, SIG_IGN);
+
+    if (bench) {
+        if (n < 2) n = 2;
+        return run_bench(n & ~1, nw, secs, all_on_0);
+    }
+    if (optind >= argc) { usage(); return 2; }
+
+    /* channel list shared by every link */
+    uint8_t chlist[HUB_CH_MAX];
+    int     nch = 0;
+    for (const char *p = chs; *p && nch < HUB_CH_MAX; ) {
+        char *end;
+        long ch = strtol(p, &end, 10);
+        if (ch < 1 || ch > SNET_CFG_CH_MAX || (*end && *end != ',')) { usage(); return 2; }
+        chlist[nch++] = (uint8_t)ch;
+        p = *end ? end + 1 : end;
+    }
+    mkdir(dir, 0755);
+
+    nlinks = argc - optind;
+    links  = (hub_link_t*)calloc((size_t)nlinks, sizeof(*links));
+    if (!links) return 1;
+    t_tick = (uint8_t)(now_us() / HUB_TICK_US);
+    for (int i = 0; i < nlinks; i++) {
+        hub_link_t *l = &links[i];
+        const char *dev = argv[optind + i];
+        int fd = open_serial(dev, baud);
+        if (fd < 0) { perror(dev); return 1; }
+        l->nchans = nch;
+        for (int k = 0; k < nch; k++) {
+            l->chans[k].ch  = chlist[k];
+            l->chans[k].cfd = -1;
+            if (open_listener(&l->chans[k], dir, i) < 0) {
+                fprintf(stderr, "link %d: cannot listen on %s\n", i, l->chans[k].path);
+                return 1;
+            }
+        }
+        if (link_init(l, i, fd) < 0) {
+            fprintf(stderr, "link %d: socket setup failed\n", i);
+            return 1;
+        }
+    }
+
+    /* workers inherit the blocked set; the main thread waits for it */
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+    if (nw > nlinks) nw = nlinks;
+    if (workers_start(nw, 0) < 0) { perror("workers"); return 1; }
+    fprintf(stderr, "squid-hub: %d links on %d workers, sockets in %s\n",
+            nlinks, nw, dir);
+
+    int sig;
+    sigwait(&set, &sig);
+    workers_stop();
+    for (int i = 0; i < nlinks; i++) link_free(&links[i]);
+    free(links);
+    return 0;
+}
@@ -0,0 +1,140 @@
+/* src/relay.c – byte buffers and local clients for squid-bridge and
+ * squid-hub; see relay.h.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "squid/snet.h"
+#include "squid/socket.h"
+#include "relay.h"
+
+/* ================================================================== */
+/*  Byte buffers                                                      */
+/* ================================================================== */
+int buf_fill(relay_buf_t *b, int fd)
+{
+    while (buf_room(b)) {
+        uint16_t at  = (uint16_t)(b->head % RELAY_IOBUF);
+        uint16_t run = (uint16_t)(RELAY_IOBUF - at);
+        if (run > buf_room(b)) run = buf_room(b);
+        ssize_t n = read(fd, &b->buf[at], run);
+        if (n > 0) { b->head = (uint16_t)(b->head + n); continue; }
+        if (n == 0) return -1;
+        return (errno == EAGAIN || errno == EINTR) ? 0 : -1;
+    }
+    return 0;
+}
+
+int buf_drain(relay_buf_t *b, int fd)
+{
+    while (buf_used(b)) {
+        uint16_t at  = (uint16_t)(b->tail % RELAY_IOBUF);
+        uint16_t run = (uint16_t)(RELAY_IOBUF - at);
+        if (run > buf_used(b)) run = buf_used(b);
+        ssize_t n = write(fd, &b->buf[at], run);
+        if (n > 0) { b->tail = (uint16_t)(b->tail + n); continue; }
+        return (n < 0 && (errno == EAGAIN || errno == EINTR)) ? 0 : -1;
+    }
+    return 0;
+}
+
+/* in contiguous runs */
+void buf_feed(relay_buf_t *b)
+{
+    while (buf_used(b)) {
+        uint16_t at  = (uint16_t)(b->tail % RELAY_IOBUF);
+        uint16_t run = (uint16_t)(RELAY_IOBUF - at);
+        if (run > buf_used(b)) run = buf_used(b);
+        snet_feed(&b->buf[at], run);
+        b->tail = (uint16_t)(b->tail + run);
+    }
+}
+
+/* ================================================================== */
+/*  Clients                                                           */
+/* ================================================================== */
+static void _arm(int ep, relay_chan_t *c, int op)
+{
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = c->cev;
+    ev.data   = c->ctag;
+    epoll_ctl(ep, op, c->cfd, &ev);
+}
+
+void client_accept(int ep, relay_chan_t *c)
+{
+    int fd = accept(c->lfd, NULL, NULL);
+    if (fd < 0) return;
+    if (c->cfd >= 0) { close(fd); return; }   /* one client per channel */
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    int one = 1;                              /* TCP clients; fails on Unix */
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    c->cfd = fd;
+    c->cev = EPOLLIN | EPOLLRDHUP;
+    _arm(ep, c, EPOLL_CTL_ADD);
+}
+
+void client_close(int ep, relay_chan_t *c)
+{
+    if (c->cfd < 0) return;
+    epoll_ctl(ep, EPOLL_CTL_DEL, c->cfd, NULL);
+    close(c->cfd);
+    c->cfd = -1;
+    c->out.head = c->out.tail = 0;
+    c->in.head  = c->in.tail  = 0;
+    c->tx_full  = 0;
+}
+
+/* a refused chunk waits in c->in; one that can never be queued ends
+ * the client rather than vanish from the stream */
+void client_read(int ep, relay_chan_t *c)
+{
+    for (;;) {
+        if (buf_used(&c->in)) {
+            int r = squid_send(c->sock, &c->in.buf[c->in.tail], buf_used(&c->in));
+            if (r == SQUID_EAGAIN) { c->tx_full = 1; return; }
+            if (r < 0) {
+                fprintf(stderr, "channel %u: send failed, client closed\n", c->ch);
+                client_close(ep, c);
+                return;
+            }
+            c->in.head = c->in.tail = 0;
+        }
+        ssize_t n = read(c->cfd, c->in.buf, sizeof(c->in.buf));
+        if (n > 0) { c->in.head = (uint16_t)n; continue; }
+        if (n == 0 || (errno != EAGAIN && errno != EINTR)) client_close(ep, c);
+        return;
+    }
+}
+
+/* only while the client keeps up */
+void client_write(int ep, relay_chan_t *c)
+{
+    for (;;) {
+        if (buf_drain(&c->out, c->cfd) < 0) { client_close(ep, c); return; }
+        if (buf_used(&c->out)) return;                  /* client is slow */
+        c->out.head = c->out.tail = 0;
+        int n = squid_recv(c->sock, c->out.buf, RELAY_IOBUF);
+        if (n <= 0) return;
+        c->out.head = (uint16_t)n;
+    }
+}
+
+void client_rearm(int ep, relay_chan_t *c)
+{
+    if (c->cfd < 0) return;
+    uint32_t want = EPOLLRDHUP;
+    if (!c->tx_full)                    want |= EPOLLIN;
+    if (buf_used(&c->out))              want |= EPOLLOUT;
+    if (want != c->cev) {
+        c->cev = want;
+        _arm(ep, c, EPOLL_CTL_MOD);
+    }
+}
@@ -0,0 +1,55 @@
+/* src/relay.h – byte buffers and local clients for squid-bridge and
+ * squid-hub (Linux, epoll).
+ *
+ * A relay channel joins one squid socket to one local client.  Both
+ * directions have backpressure:
+ *
+ *   client -> link  the socket's TX queue is capped (SQUID_SO_TXCAP); a
+ *                   chunk it refuses waits in c->in and the client is
+ *                   not read until the tool's squid_on_writable()
+ *                   callback clears tx_full.
+ *   link -> client  the socket's RX queue is not drained while the
+ *                   client has unwritten bytes; at SQUID_SO_RXCAP the
+ *                   engine answers DATA with "busy" and the peer holds off.
+ *
+ * Every client call runs with the channel's engine current.
+ */
+#pragma once
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <sys/un.h>
+
+#define RELAY_IOBUF 4096u     /* serial and per-client buffers */
+
+typedef struct {
+    uint8_t  buf[RELAY_IOBUF];
+    uint16_t head, tail;      /* head = write, tail = read */
+} relay_buf_t;
+
+static inline uint16_t buf_used(const relay_buf_t *b) { return (uint16_t)(b->head - b->tail); }
+static inline uint16_t buf_room(const relay_buf_t *b) { return (uint16_t)(RELAY_IOBUF - buf_used(b)); }
+
+/* move bytes between a buffer and an fd; -1 on EOF/error */
+int  buf_fill(relay_buf_t *b, int fd);
+int  buf_drain(relay_buf_t *b, int fd);
+/* hand every buffered serial byte to the current engine's decoder */
+void buf_feed(relay_buf_t *b);
+
+typedef struct {
+    uint8_t      ch;          /* wire channel 1..SNET_CFG_CH_MAX */
+    int          sock;        /* squid socket */
+    int          lfd;         /* listener */
+    int          cfd;         /* client, -1 when none */
+    uint32_t     cev;         /* epoll events armed on cfd */
+    epoll_data_t ctag;        /* epoll user data for cfd */
+    relay_buf_t  out;         /* link -> client */
+    relay_buf_t  in;          /* client -> link, refused by a full queue */
+    int          tx_full;     /* waiting for the writable callback */
+    char         path[sizeof(((struct sockaddr_un*)0)->sun_path)];
+} relay_chan_t;
+
+void client_accept(int ep, relay_chan_t *c);    /* one client per channel */
+void client_close(int ep, relay_chan_t *c);
+void client_read(int ep, relay_chan_t *c);      /* client -> TX queue */
+void client_write(int ep, relay_chan_t *c);     /* RX queue -> client */
+void client_rearm(int ep, relay_chan_t *c);     /* match both backpressures */
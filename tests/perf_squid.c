@@ -0,0 +1,183 @@
+/* tests/perf_squid.c – CPU cost per frame, as a regression gate.
+ *
+ * Two engines (squid_prof build) stream a fixed pattern both ways over
+ * in-memory wires.  The first run has no clock installed and measures
+ * process CPU time per frame on the wire; it fails when that exceeds
+ * the limit given as argv[1] (ns, default PERF_LIMIT_NS).  A second run
+ * installs a clock and prints the per-probe histograms (count, p99, max
+ * in ns) so a regression can be traced to a code path.
+ *
+ *   squid-perf [limit_ns]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "squid/snet.h"
+#include "squid/socket.h"
+
+#define XFER_BYTES    (64u * 1024u)     /* each way */
+#define FRAME_BYTES   20u
+#define PERF_LIMIT_NS 5000.0            /* about 10x a desktop build: catches big slips */
+
+/* ---- wires ---- */
+#define RING_SIZE 4096u
+
+typedef struct {
+    uint8_t  buf[RING_SIZE];
+    uint32_t head, tail;
+} ring_t;
+
+static ring_t a2b, b2a;
+static uint32_t wire_bytes;
+static uint8_t fake_tick;
+
+static int ring_put(ring_t *r, uint8_t c)
+{
+    if (r->head - r->tail >= RING_SIZE) return -1;
+    r->buf[r->head++ % RING_SIZE] = c;
+    wire_bytes++;
+    return 0;
+}
+
+static int ring_get(ring_t *r)
+{
+    if (r->head == r->tail) return -1;
+    return r->buf[r->tail++ % RING_SIZE];
+}
+
+static int a_send(uint8_t c) { return ring_put(&a2b, c); }
+static int a_recv(void)      { return ring_get(&b2a); }
+static int b_send(uint8_t c) { return ring_put(&b2a, c); }
+static int b_recv(void)      { return ring_get(&a2b); }
+static uint8_t tick(void)    { return fake_tick; }
+static void *xmalloc(uint16_t n) { return malloc(n); }
+
+static const squid_platform_t plat_a = { a_send, a_recv, tick, xmalloc, free };
+static const squid_platform_t plat_b = { b_send, b_recv, tick, xmalloc, free };
+
+static uint32_t ns_clock(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+}
+
+static double cpu_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static uint8_t pattern(uint32_t i, int side) { return (uint8_t)(i * 13u + (uint32_t)side * 71u); }
+
+/* ---- one side's share of a step: top up sends, drain and check ---- */
+typedef struct {
+    squid_engine_t *eng;
+    int fd, side;
+    uint32_t sent, got;
+    int bad;
+} peer_t;
+
+static void pump(peer_t *p)
+{
+    uint8_t buf[256];
+    snet_engine_use(p->eng);
+    snet_burst();
+    if (p->sent < XFER_BYTES) {
+        uint16_t n = (uint16_t)(XFER_BYTES - p->sent > 120u ? 120u : XFER_BYTES - p->sent);
+        for (uint16_t k = 0; k < n; k++) buf[k] = pattern(p->sent + k, p->side);
+        if (squid_send(p->fd, buf, n) == n) p->sent += n;
+    }
+    int r;
+    while ((r = squid_recv(p->fd, buf, sizeof(buf))) > 0) {
+        for (int k = 0; k < r; k++)
+            if (buf[k] != pattern(p->got + (uint32_t)k, !p->side)) p->bad = 1;
+        p->got += (uint32_t)r;
+    }
+}
+
+/* run the workload; returns frames on the wire, 0 on failure */
+static uint32_t run(uint32_t (*clk)(void), double *cpu_ns)
+{
+    squid_timing_t tm = { 50, 1, 0, 10 };
+    peer_t a = { calloc(1, snet_engine_size()), 0, 0, 0, 0, 0 };
+    peer_t b = { calloc(1, snet_engine_size()), 0, 1, 0, 0, 0 };
+    memset(&a2b, 0, sizeof(a2b));
+    memset(&b2a, 0, sizeof(b2a));
+
+    snet_engine_use(a.eng);
+    snet_init(&plat_a, &tm);
+    snet_prof_clock(clk);
+    a.fd = squid_open();
+    squid_connect(a.fd, 1);
+    snet_engine_use(b.eng);
+    snet_init(&plat_b, &tm);
+    snet_prof_clock(clk);
+    b.fd = squid_open();
+    squid_bind(b.fd, 1);
+
+    wire_bytes = 0;
+    double t0 = cpu_now();
+    for (uint32_t step = 0; step < 200000u; step++) {
+        if (a.got >= XFER_BYTES && b.got >= XFER_BYTES) break;
+        fake_tick++;
+        pump(&a);
+        pump(&b);
+    }
+    *cpu_ns = cpu_now() - t0;
+
+    int ok = !a.bad && !b.bad && a.got == XFER_BYTES && b.got == XFER_BYTES;
+    if (clk) {
+        static const char *names[SNET_PROF_N] = { "burst", "rx", "tx", "send", "recv" };
+        snet_prof_stat_t sa, sb;
+        printf("  %-6s %10s %8s %8s\n", "probe", "count", "p99 ns", "max ns");
+        for (uint8_t i = 0; i < SNET_PROF_N; i++) {
+            snet_engine_use(a.eng);
+            snet_prof_get(i, &sa);
+            snet_engine_use(b.eng);
+            snet_prof_get(i, &sb);
+            printf("  %-6s %10u %8u %8u\n", names[i], sa.count + sb.count,
+                   sa.p99 > sb.p99 ? sa.p99 : sb.p99,
+                   sa.max > sb.max ? sa.max : sb.max);
+        }
+    }
+    snet_engine_use(NULL);
+    free(a.eng);
+    free(b.eng);
+    return ok ? wire_bytes / FRAME_BYTES : 0u;
+}
+
+int main(int argc, char **argv)
+{
+    double limit = (argc > 1) ? atof(argv[1]) : PERF_LIMIT_NS;
+    double cpu_ns;
+
+    printf("libsquid per-frame CPU cost\n");
+    printf("===========================\n");
+
+    uint32_t frames = run(NULL, &cpu_ns);
+    if (!frames) {
+        printf("  FAIL: workload did not complete\n");
+        return 1;
+    }
+    double per = cpu_ns / frames;
+    printf("  %u KB each way, %u frames, %.0f ns CPU per frame (limit %.0f)\n",
+           XFER_BYTES / 1024u, frames, per, limit);
+
+    if (!run(ns_clock, &cpu_ns)) {
+        printf("  FAIL: profiled workload did not complete\n");
+        return 1;
+    }
+
+    printf("===========================\n");
+    if (per > limit) {
+        printf("FAIL: per-frame cost over the limit\n");
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
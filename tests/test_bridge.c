@@ -0,0 +1,211 @@
+/* tests/test_bridge.c – squid-bridge end to end over a socketpair.
+ *
+ * Runs the bridge binary (path in argv[1]) with `-d -`, its stdin and
+ * stdout each one end of a socketpair; this process runs the far engine
+ * on the other ends and is the bridge's local client on a Unix socket.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "squid/snet.h"
+#include "squid/socket.h"
+
+static int   ser_tx = -1, ser_rx = -1;  /* to the bridge's stdin, from its stdout */
+static pid_t bridge = -1;
+static char  sock_path[64];
+
+static int ser_send(uint8_t c)
+{
+    return write(ser_tx, &c, 1) == 1 ? 0 : -1;
+}
+
+static int ser_recv(void)
+{
+    uint8_t c;
+    return read(ser_rx, &c, 1) == 1 ? c : -1;
+}
+
+static uint8_t ms_tick(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint8_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void *_alloc(uint16_t n) { return malloc(n); }
+
+static const squid_platform_t plat = { ser_send, ser_recv, ms_tick, _alloc, free };
+
+static uint8_t pattern(uint32_t i) { return (uint8_t)(i * 13u + (i >> 8)); }
+
+/* one engine step, then a short nap so the bridge gets the CPU */
+static void step(void)
+{
+    snet_burst();
+    usleep(200);
+}
+
+/* ================================================================== */
+/*  Test infrastructure                                               */
+/* ================================================================== */
+static int tests_run = 0, tests_passed = 0;
+
+#define TEST(name) static int name(void)
+#define ASSERT(cond, msg) do { \
+    if (!(cond)) { \
+        printf("  FAIL: %s (line %d): %s\n", __func__, __LINE__, msg); \
+        return 0; \
+    } \
+} while(0)
+#define RUN(fn) do { \
+    tests_run++; \
+    printf("  %-40s ", #fn); \
+    fflush(stdout); \
+    if (fn()) { tests_passed++; printf("OK\n"); } \
+    else printf("\n"); \
+} while(0)
+
+static int client_connect(void)
+{
+    struct sockaddr_un su;
+    memset(&su, 0, sizeof(su));
+    su.sun_family = AF_UNIX;
+    strcpy(su.sun_path, sock_path);
+    for (int i = 0; i < 200; i++) {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+        if (connect(fd, (struct sockaddr*)&su, sizeof(su)) == 0) {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            return fd;
+        }
+        close(fd);
+        usleep(10000);
+    }
+    return -1;
+}
+
+TEST(test_bridge_relays_both_ways)
+{
+    enum { UP = 3000, DOWN = 2000 };
+    squid_timing_t tm = { 50, 1, 200, 5 };
+    snet_init(&plat, &tm);
+    int s = squid_open();
+    ASSERT(squid_bind(s, 1) == 0, "bind channel 1");
+    for (double t0 = now(); !snet_link_is_up() && now() - t0 < 5.0; ) step();
+    ASSERT(snet_link_is_up(), "link to the bridge comes up");
+
+    int c = client_connect();
+    ASSERT(c >= 0, "connect to the bridge's socket");
+
+    /* client -> bridge -> link, and link -> bridge -> client at once */
+    static uint8_t buf[UP];
+    uint32_t wr = 0, got = 0, sent = 0, back = 0;
+    for (double t0 = now(); (got < UP || back < DOWN) && now() - t0 < 20.0; ) {
+        while (wr < UP) {
+            uint8_t chunk[256];
+            size_t n = UP - wr > sizeof(chunk) ? sizeof(chunk) : UP - wr;
+            for (size_t k = 0; k < n; k++) chunk[k] = pattern(wr + (uint32_t)k);
+            ssize_t w = write(c, chunk, n);
+            if (w <= 0) break;
+            wr += (uint32_t)w;
+        }
+        if (sent < DOWN) {
+            uint8_t chunk[64];
+            uint16_t n = (uint16_t)(DOWN - sent > sizeof(chunk) ? sizeof(chunk) : DOWN - sent);
+            for (uint16_t k = 0; k < n; k++) chunk[k] = pattern(~(sent + k));
+            if (squid_send(s, chunk, n) == n) sent += n;
+        }
+        step();
+        int r;
+        while ((r = squid_recv(s, buf, sizeof(buf))) > 0) {
+            for (int k = 0; k < r; k++)
+                ASSERT(buf[k] == pattern(got + (uint32_t)k), "client bytes in order");
+            got += (uint32_t)r;
+        }
+        ssize_t n;
+        while ((n = read(c, buf, sizeof(buf))) > 0) {
+            for (ssize_t k = 0; k < n; k++)
+                ASSERT(buf[k] == pattern(~(back + (uint32_t)k)), "link bytes in order");
+            back += (uint32_t)n;
+        }
+    }
+    ASSERT(got == UP, "everything the client wrote crosses the link");
+    ASSERT(back == DOWN, "everything sent on the link reaches the client");
+    close(c);
+    return 1;
+}
+
+TEST(test_bridge_exits_on_serial_eof)
+{
+    close(ser_tx);                      /* stdin at EOF, stdout still open */
+    ser_tx = -1;
+    int st = 0;
+    pid_t r = 0;
+    for (double t0 = now(); r == 0 && now() - t0 < 3.0; usleep(10000))
+        r = waitpid(bridge, &st, WNOHANG);
+    if (r == 0) { kill(bridge, SIGKILL); waitpid(bridge, &st, 0); }
+    bridge = -1;
+    ASSERT(r > 0, "bridge quits instead of spinning on EOF");
+    ASSERT(WIFEXITED(st), "clean exit");
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: squid-test-bridge PATH-TO-squid-bridge\n");
+        return 2;
+    }
+    snprintf(sock_path, sizeof(sock_path), "/tmp/squid-bridge-test-%d", (int)getpid());
+    char map[96];
+    snprintf(map, sizeof(map), "1=unix:%s", sock_path);
+
+    int in[2], out[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, in) < 0 ||
+        socketpair(AF_UNIX, SOCK_STREAM, 0, out) < 0) { perror("socketpair"); return 1; }
+    bridge = fork();
+    if (bridge < 0) { perror("fork"); return 1; }
+    if (bridge == 0) {
+        dup2(in[1], 0);
+        dup2(out[1], 1);
+        close(in[0]); close(in[1]);
+        close(out[0]); close(out[1]);
+        execl(argv[1], "squid-bridge", "-d", "-", map, (char*)0);
+        _exit(127);
+    }
+    close(in[1]);
+    close(out[1]);
+    ser_tx = in[0];
+    ser_rx = out[0];
+    fcntl(ser_tx, F_SETFL, fcntl(ser_tx, F_GETFL) | O_NONBLOCK);
+    fcntl(ser_rx, F_SETFL, fcntl(ser_rx, F_GETFL) | O_NONBLOCK);
+
+    printf("squid-bridge end-to-end test\n");
+    printf("============================\n");
+
+    RUN(test_bridge_relays_both_ways);
+    RUN(test_bridge_exits_on_serial_eof);
+
+    if (bridge > 0) { kill(bridge, SIGKILL); waitpid(bridge, NULL, 0); }
+    unlink(sock_path);
+    printf("============================\n");
+    printf("%d/%d tests passed\n", tests_passed, tests_run);
+    return (tests_passed == tests_run) ? 0 : 1;
+}
@@ -0,0 +1,348 @@
+/* tests/test_bus.c – a controller and three nodes on a simulated bus.
+ *
+ * The shared medium delivers every byte to every other station.  Each
+ * station has its own bus context, swapped in like the engine contexts
+ * in test_squid.c; the controller runs one engine per node.  A station
+ * that transmits while bytes from another are still on its way to it
+ * would have collided on a real half-duplex line.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "squid/snet.h"
+#include "squid/socket.h"
+#include "squid/bus.h"
+#include "squid/internal.h"   /* access g_bus for swapping contexts */
+
+#define NODES    3
+#define STATIONS (NODES + 1)  /* station 0 is the controller */
+
+/* ================================================================== */
+/*  Simulated medium: one RX ring per station                         */
+/* ================================================================== */
+#define RING_SIZE 4096
+
+typedef struct {
+    uint8_t buf[RING_SIZE];
+    uint16_t head, tail;
+} ring_t;
+
+static ring_t  rx_ring[STATIONS];
+static int     cur;                     /* station running now */
+static int     silent[STATIONS];        /* powered off: hears nothing */
+static int     collisions;
+static uint8_t fake_tick = 0;
+
+static int med_send(uint8_t c)
+{
+    if (rx_ring[cur].head != rx_ring[cur].tail) collisions++;
+    for (int s = 0; s < STATIONS; s++) {
+        ring_t *r = &rx_ring[s];
+        uint16_t next = (uint16_t)((r->head + 1) % RING_SIZE);
+        if (s == cur || silent[s] || next == r->tail) continue;
+        r->buf[r->head] = c;
+        r->head = next;
+    }
+    return 0;
+}
+
+static int med_recv(void)
+{
+    ring_t *r = &rx_ring[cur];
+    if (r->head == r->tail) return -1;
+    uint8_t c = r->buf[r->tail];
+    r->tail = (uint16_t)((r->tail + 1) % RING_SIZE);
+    return c;
+}
+
+static uint8_t tick(void)         { return fake_tick; }
+static void *t_malloc(uint16_t n) { return malloc(n); }
+
+static const squid_platform_t phys = { med_send, med_recv, tick, t_malloc, free };
+static const squid_timing_t timing = { .timeout_ticks = 16, .ack_delay_ticks = 1,
+                                       .ping_ticks = 0, .max_retries = 8 };
+
+static squid_platform_t bus_plat[STATIONS];
+static snet_bus_t       bus_ctx[STATIONS];
+static squid_engine_t  *ctrl_eng[NODES + 1];    /* controller, per node */
+static squid_engine_t  *node_eng[NODES + 1];    /* node's own engine */
+
+/* one tick: every powered station bursts its engines, then polls */
+static void step(void)
+{
+    fake_tick++;
+    for (cur = 0; cur < STATIONS; cur++) {
+        if (silent[cur]) continue;
+        g_bus = bus_ctx[cur];
+        if (cur == 0) {
+            for (int a = 1; a <= NODES; a++) { snet_engine_use(ctrl_eng[a]); snet_burst(); }
+        } else {
+            snet_engine_use(node_eng[cur]);
+            snet_burst();
+        }
+        squid_bus_poll();
+        bus_ctx[cur] = g_bus;
+    }
+    snet_engine_use(NULL);
+}
+
+static void steps(int n) { while (n-- > 0) step(); }
+
+/* ================================================================== */
+/*  Test infrastructure                                               */
+/* ================================================================== */
+static int tests_run = 0, tests_passed = 0;
+
+#define TEST(name) static int name(void)
+#define ASSERT(cond, msg) do { \
+    if (!(cond)) { \
+        printf("  FAIL: %s (line %d): %s\n", __func__, __LINE__, msg); \
+        return 0; \
+    } \
+} while(0)
+#define RUN(fn) do { \
+    tests_run++; \
+    printf("  %-40s ", #fn); \
+    if (fn()) { tests_passed++; printf("OK\n"); } \
+    else printf("\n"); \
+} while(0)
+
+static void teardown(void)
+{
+    for (int a = 1; a <= NODES; a++) {
+        if (ctrl_eng[a]) { snet_engine_use(ctrl_eng[a]); snet_init(NULL, NULL); }
+        if (node_eng[a]) { snet_engine_use(node_eng[a]); snet_init(NULL, NULL); }
+        snet_engine_use(NULL);
+        free(ctrl_eng[a]);
+        free(node_eng[a]);
+        ctrl_eng[a] = node_eng[a] = NULL;
+    }
+}
+
+/* controller plus NODES nodes at addresses 1..NODES, engines started */
+static void setup(void)
+{
+    teardown();
+    memset(rx_ring, 0, sizeof(rx_ring));
+    memset(silent, 0, sizeof(silent));
+    collisions = 0;
+    fake_tick = 0;
+
+    squid_bus_init(&phys, SQUID_BUS_CONTROLLER, 0, &bus_plat[0]);
+    for (int a = 1; a <= NODES; a++) {
+        ctrl_eng[a] = calloc(1, snet_engine_size());
+        squid_bus_attach((uint8_t)a, ctrl_eng[a]);
+        snet_engine_use(ctrl_eng[a]);
+        snet_init(&bus_plat[0], &timing);
+    }
+    bus_ctx[0] = g_bus;
+
+    for (int a = 1; a <= NODES; a++) {
+        squid_bus_init(&phys, (uint8_t)a, 0, &bus_plat[a]);
+        node_eng[a] = calloc(1, snet_engine_size());
+        snet_engine_use(node_eng[a]);
+        snet_init(&bus_plat[a], &timing);
+        snet_set_features(SNET_FEAT_PACK | SNET_FEAT_LONG | SNET_FEAT_SHORT);
+        bus_ctx[a] = g_bus;
+    }
+    snet_engine_use(NULL);
+}
+
+static int link_up(squid_engine_t *e)
+{
+    snet_engine_use(e);
+    int up = snet_link_is_up();
+    snet_engine_use(NULL);
+    return up;
+}
+
+/* open channel 1 on an engine and queue len bytes of a pattern */
+static int open_send(squid_engine_t *e, uint8_t seed, int len)
+{
+    uint8_t out[200];
+    for (int i = 0; i < len; i++) out[i] = (uint8_t)(seed + i * 3);
+    snet_engine_use(e);
+    int fd = squid_open();
+    squid_connect(fd, 1);
+    squid_send(fd, out, (uint16_t)len);
+    snet_engine_use(NULL);
+    return fd;
+}
+
+static int read_check(squid_engine_t *e, int fd, uint8_t seed, int len, int *got)
+{
+    uint8_t in[200];
+    snet_engine_use(e);
+    int r = squid_recv(fd, in, sizeof(in));
+    snet_engine_use(NULL);
+    for (int i = 0; i < r; i++)
+        if (in[i] != (uint8_t)(seed + (*got + i) * 3)) return 0;
+    if (r > 0) *got += r;
+    return *got <= len;
+}
+
+/* ================================================================== */
+/*  Tests                                                             */
+/* ================================================================== */
+
+TEST(test_bus_links_every_node)
+{
+    setup();
+    steps(120);
+    for (int a = 1; a <= NODES; a++) {
+        ASSERT(link_up(ctrl_eng[a]) && link_up(node_eng[a]), "session per node");
+        snet_engine_use(node_eng[a]);
+        ASSERT(!(snet_features() & (SNET_FEAT_LONG | SNET_FEAT_SHORT)),
+               "20-byte frames only on the bus");
+        snet_engine_use(NULL);
+    }
+    g_bus = bus_ctx[0];
+    ASSERT(squid_bus_nodes_up() == 0x0Eu, "nodes 1..3 answer their turns");
+
+    /* both directions to every node at once, each its own sequence */
+    int cfd[NODES + 1], nfd[NODES + 1], cgot[NODES + 1] = {0}, ngot[NODES + 1] = {0};
+    for (int a = 1; a <= NODES; a++) {
+        cfd[a] = open_send(ctrl_eng[a], (uint8_t)(a * 40), 150);
+        nfd[a] = open_send(node_eng[a], (uint8_t)(a * 40 + 7), 150);
+    }
+    int done = 0;
+    for (int t = 0; t < 3000 && done < 2 * NODES; t++) {
+        step();
+        done = 0;
+        for (int a = 1; a <= NODES; a++) {
+            ASSERT(read_check(node_eng[a], nfd[a], (uint8_t)(a * 40), 150, &ngot[a]),
+                   "node gets its own bytes in order");
+            ASSERT(read_check(ctrl_eng[a], cfd[a], (uint8_t)(a * 40 + 7), 150, &cgot[a]),
+                   "controller gets each node's bytes in order");
+            done += (ngot[a] == 150) + (cgot[a] == 150);
+        }
+    }
+    ASSERT(done == 2 * NODES, "every transfer completes");
+    ASSERT(collisions == 0, "nobody talks out of turn");
+    teardown();
+    return 1;
+}
+
+TEST(test_bus_skips_silent_node)
+{
+    setup();
+    silent[2] = 1;                      /* node 2 is powered off */
+    steps(150);
+    ASSERT(link_up(ctrl_eng[1]) && link_up(ctrl_eng[3]), "others come up");
+    ASSERT(!link_up(ctrl_eng[2]), "no session with the silent node");
+    g_bus = bus_ctx[0];
+    ASSERT(squid_bus_nodes_up() == 0x0Au, "node 2 misses its turns");
+
+    int cfd = open_send(ctrl_eng[3], 9, 100);
+    int nfd = open_send(node_eng[3], 9, 100);
+    (void)cfd;
+    int got = 0;
+    for (int t = 0; t < 2000 && got < 100; t++) {
+        step();
+        ASSERT(read_check(node_eng[3], nfd, 9, 100, &got), "in order");
+    }
+    ASSERT(got == 100, "node 3 served around the gap");
+
+    /* node 2 powers up and joins */
+    silent[2] = 0;
+    steps(150);
+    ASSERT(link_up(ctrl_eng[2]) && link_up(node_eng[2]), "late node links");
+    g_bus = bus_ctx[0];
+    ASSERT(squid_bus_nodes_up() == 0x0Eu, "all nodes answer again");
+    ASSERT(collisions == 0, "nobody talks out of turn");
+    teardown();
+    return 1;
+}
+
+/* a point-to-point link run by the controller next to its bus engines */
+static ring_t p2p[2];                   /* 0: A->B, 1: B->A */
+
+static int p2p_put(ring_t *r, uint8_t c)
+{
+    uint16_t next = (uint16_t)((r->head + 1) % RING_SIZE);
+    if (next == r->tail) return -1;
+    r->buf[r->head] = c;
+    r->head = next;
+    return 0;
+}
+
+static int p2p_get(ring_t *r)
+{
+    if (r->head == r->tail) return -1;
+    uint8_t c = r->buf[r->tail];
+    r->tail = (uint16_t)((r->tail + 1) % RING_SIZE);
+    return c;
+}
+
+static int pa_send(uint8_t c) { return p2p_put(&p2p[0], c); }
+static int pb_send(uint8_t c) { return p2p_put(&p2p[1], c); }
+static int pa_recv(void)      { return p2p_get(&p2p[1]); }
+static int pb_recv(void)      { return p2p_get(&p2p[0]); }
+
+static const squid_platform_t plat_pa = { pa_send, pa_recv, tick, t_malloc, free };
+static const squid_platform_t plat_pb = { pb_send, pb_recv, tick, t_malloc, free };
+
+TEST(test_bus_scoped_to_its_engines)
+{
+    uint8_t feat = SNET_FEAT_LONG | SNET_FEAT_SHORT;
+    setup();
+    memset(p2p, 0, sizeof(p2p));
+    squid_engine_t *pe[2] = { calloc(1, snet_engine_size()), calloc(1, snet_engine_size()) };
+    const squid_platform_t *pp[2] = { &plat_pa, &plat_pb };
+    for (int i = 0; i < 2; i++) {
+        snet_engine_use(pe[i]);
+        snet_init(pp[i], &timing);
+        snet_set_features(feat);
+    }
+    g_bus = bus_ctx[0];                 /* the controller's bus exists */
+    for (int t = 0; t < 60; t++) {
+        fake_tick++;
+        for (int i = 0; i < 2; i++) { snet_engine_use(pe[i]); snet_burst(); }
+    }
+    int ok = 1;
+    for (int i = 0; i < 2; i++) {
+        snet_engine_use(pe[i]);
+        ok = ok && snet_link_is_up() && (snet_features() & feat) == feat;
+        snet_init(NULL, NULL);
+        snet_engine_use(NULL);
+        free(pe[i]);
+    }
+    ASSERT(ok, "a non-bus engine keeps long and short frames");
+    teardown();
+    return 1;
+}
+
+TEST(test_bus_rejects_bad_setup)
+{
+    squid_platform_t out;
+    ASSERT(squid_bus_init(&phys, 32, 0, &out) == -1, "address out of range");
+    ASSERT(squid_bus_init(&phys, 5, 0, &out) == 0, "node");
+    ASSERT(squid_bus_attach(1, NULL) == -1, "attach is for the controller");
+    squid_bus_init(&phys, SQUID_BUS_CONTROLLER, 0, &out);
+    ASSERT(squid_bus_attach(0, NULL) == -1, "node address 0");
+    for (uint8_t a = 1; a <= SNET_CFG_BUS; a++)
+        ASSERT(squid_bus_attach(a, NULL) == 0, "fill the links");
+    ASSERT(SNET_CFG_BUS == SQUID_BUS_ADDR_MAX ||
+           squid_bus_attach(SNET_CFG_BUS + 1, NULL) == -1, "no free link");
+    memset(&g_bus, 0, sizeof(g_bus));
+    return 1;
+}
+
+/* ================================================================== */
+int main(void)
+{
+    printf("libsquid bus test suite\n");
+    printf("=======================\n");
+
+    RUN(test_bus_links_every_node);
+    RUN(test_bus_skips_silent_node);
+    RUN(test_bus_scoped_to_its_engines);
+    RUN(test_bus_rejects_bad_setup);
+
+    printf("=======================\n");
+    printf("%d/%d tests passed\n", tests_passed, tests_run);
+
+    return (tests_passed == tests_run) ? 0 : 1;
+}
@@ -0,0 +1,163 @@
+/* tests/test_shm.c – two processes over the shared-memory link.
+ *
+ * Forks a peer; both open the same segment (whoever comes first creates
+ * it) and stream a pattern both ways through a socket on channel 1.
+ * Prints the duplex rate as a rough benchmark.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "squid/snet.h"
+#include "squid/socket.h"
+#include "squid/shm.h"
+
+#define XFER_BYTES (256u * 1024u)
+
+static uint8_t ms_tick(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint8_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void *xmalloc(uint16_t n) { return malloc(n); }
+
+static const squid_platform_t host = {
+    NULL, NULL, ms_tick, xmalloc, free
+};
+
+static uint8_t pattern(uint32_t i, int side) { return (uint8_t)(i * 7u + (uint32_t)side * 101u); }
+
+/* one side: send XFER_BYTES, check XFER_BYTES from the peer; 0 = ok */
+static int run_side(const char *name, double limit)
+{
+    squid_platform_t plat;
+    int side = -1;
+    for (int i = 0; i < 200 && side < 0; i++) {
+        side = squid_shm_open(name, &host, &plat);
+        if (side < 0) usleep(5000);
+    }
+    if (side < 0) return 1;
+
+    squid_timing_t tm = { 50, 1, 0, 10 };
+    snet_init(&plat, &tm);
+    int s = squid_open();               /* bound before the peer can send */
+    squid_bind(s, 1);
+
+    uint32_t sent = 0, got = 0;
+    uint8_t buf[512];
+    double t0 = now();
+    while ((got < XFER_BYTES || sent < XFER_BYTES) && now() - t0 < limit) {
+        size_t in = squid_shm_feed();
+        snet_burst();
+        if (!snet_link_is_up()) { squid_shm_wait(1); continue; }
+
+        while (sent < XFER_BYTES) {
+            uint16_t n = (uint16_t)(XFER_BYTES - sent > 240 ? 240 : XFER_BYTES - sent);
+            for (uint16_t k = 0; k < n; k++) buf[k] = pattern(sent + k, side);
+            if (squid_send(s, buf, n) != n) break;
+            sent += n;
+            if (sent % 4096u == 0u) break;      /* keep the queue short */
+        }
+        int r;
+        while ((r = squid_recv(s, buf, sizeof(buf))) > 0) {
+            for (int k = 0; k < r; k++)
+                if (buf[k] != pattern(got + (uint32_t)k, !side)) return 2;
+            got += (uint32_t)r;
+        }
+        if (!in && got < XFER_BYTES && sent >= XFER_BYTES) squid_shm_wait(1);
+    }
+    double dt = now() - t0;
+    /* let the peer collect our last ACKs */
+    for (double t1 = now(); now() - t1 < 0.2; ) {
+        squid_shm_feed();
+        snet_burst();
+        squid_shm_wait(1);
+    }
+    if (side == 0)
+        printf("  duplex %u KB each way in %.3f s (%.0f KB/s total)\n",
+               XFER_BYTES / 1024u, dt, 2.0 * XFER_BYTES / 1024.0 / dt);
+    squid_shm_close();
+    return got == XFER_BYTES ? 0 : 3;
+}
+
+/* ================================================================== */
+/*  Test infrastructure                                               */
+/* ================================================================== */
+static int tests_run = 0, tests_passed = 0;
+
+#define TEST(name) static int name(void)
+#define ASSERT(cond, msg) do { \
+    if (!(cond)) { \
+        printf("  FAIL: %s (line %d): %s\n", __func__, __LINE__, msg); \
+        return 0; \
+    } \
+} while(0)
+#define RUN(fn) do { \
+    tests_run++; \
+    printf("  %-40s ", #fn); \
+    fflush(stdout); \
+    if (fn()) { tests_passed++; printf("OK\n"); } \
+    else printf("\n"); \
+} while(0)
+
+static char seg_name[64];
+
+TEST(test_shm_roles)
+{
+    squid_platform_t a, b;
+    squid_shm_unlink(seg_name);
+    ASSERT(squid_shm_open(seg_name, &host, &a) == 0, "first open creates");
+    ASSERT(a.send_char && a.recv_char && a.get_tick, "hooks set");
+    ASSERT(squid_shm_open(seg_name, &host, &b) == -1, "one link per process");
+    ASSERT(a.recv_char() == -1, "empty ring");
+    ASSERT(squid_shm_wait(5) == 0, "wait times out on an empty ring");
+    squid_shm_close();
+    ASSERT(squid_shm_unlink(seg_name) != 0, "creator close unlinks");
+    return 1;
+}
+
+TEST(test_shm_duplex_processes)
+{
+    squid_shm_unlink(seg_name);
+    printf("\n");
+    fflush(stdout);
+    pid_t pid = fork();
+    ASSERT(pid >= 0, "fork");
+    if (pid == 0) _exit(run_side(seg_name, 20.0));
+
+    int rc = run_side(seg_name, 20.0);
+    int st = 0;
+    waitpid(pid, &st, 0);
+    squid_shm_unlink(seg_name);
+    ASSERT(rc == 0, "this side should get the peer's stream");
+    ASSERT(WIFEXITED(st) && WEXITSTATUS(st) == 0, "peer should get ours");
+    printf("  %-40s ", "");
+    return 1;
+}
+
+int main(void)
+{
+    snprintf(seg_name, sizeof(seg_name), "/squid-test-%d", (int)getpid());
+    printf("libsquid shm link test\n");
+    printf("======================\n");
+
+    RUN(test_shm_roles);
+    RUN(test_shm_duplex_processes);
+
+    printf("======================\n");
+    printf("%d/%d tests passed\n", tests_passed, tests_run);
+    return (tests_passed == tests_run) ? 0 : 1;
+}
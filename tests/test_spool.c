@@ -0,0 +1,311 @@
+/* tests/test_spool.c – disk-backed TX spool over the loopback wire.
+ *
+ * Same back-to-back setup as test_squid.c.  A writes into a spool file
+ * in /tmp instead of its TX queue; B reads from a plain socket.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "squid/snet.h"
+#include "squid/socket.h"
+#include "squid/spool.h"
+#include "squid/internal.h"   /* access g_snet for swapping contexts */
+
+/* ================================================================== */
+/*  Simulated wire: two ring buffers (A→B and B→A)                    */
+/* ================================================================== */
+#define RING_SIZE 4096
+
+typedef struct {
+    uint8_t buf[RING_SIZE];
+    uint16_t head, tail;
+} ring_t;
+
+static ring_t wire_a2b, wire_b2a;
+static uint8_t fake_tick = 0;
+
+static int ring_put(ring_t *r, uint8_t c)
+{
+    uint16_t next = (uint16_t)((r->head + 1) % RING_SIZE);
+    if (next == r->tail) return -1;
+    r->buf[r->head] = c;
+    r->head = next;
+    return 0;
+}
+
+static int ring_get(ring_t *r)
+{
+    if (r->head == r->tail) return -1;
+    uint8_t c = r->buf[r->tail];
+    r->tail = (uint16_t)((r->tail + 1) % RING_SIZE);
+    return c;
+}
+
+static int a_send(uint8_t c) { return ring_put(&wire_a2b, c); }
+static int a_recv(void)      { return ring_get(&wire_b2a); }
+static int b_send(uint8_t c) { return ring_put(&wire_b2a, c); }
+static int b_recv(void)      { return ring_get(&wire_a2b); }
+static uint8_t tick(void)    { return fake_tick; }
+static void *t_malloc(uint16_t n) { return malloc(n); }
+
+static const squid_platform_t plat_a = { a_send, a_recv, tick, t_malloc, free };
+static const squid_platform_t plat_b = { b_send, b_recv, tick, t_malloc, free };
+static const squid_timing_t   timing = { .timeout_ticks = 3, .ack_delay_ticks = 1,
+                                         .ping_ticks = 0, .max_retries = 5 };
+
+static snet_ctx_t ctx_a, ctx_b;
+
+static void load_a(void) { g_snet = ctx_a; }
+static void load_b(void) { g_snet = ctx_b; }
+static void save_a(void) { ctx_a = g_snet; }
+static void save_b(void) { ctx_b = g_snet; }
+
+/* ================================================================== */
+/*  Test infrastructure                                               */
+/* ================================================================== */
+static int tests_run = 0, tests_passed = 0;
+
+#define TEST(name) static int name(void)
+#define ASSERT(cond, msg) do { \
+    if (!(cond)) { \
+        printf("  FAIL: %s (line %d): %s\n", __func__, __LINE__, msg); \
+        return 0; \
+    } \
+} while(0)
+#define RUN(fn) do { \
+    tests_run++; \
+    printf("  %-40s ", #fn); \
+    if (fn()) { tests_passed++; printf("OK\n"); } \
+    else printf("\n"); \
+} while(0)
+
+static squid_spool_t spool;
+static char spool_path[] = "/tmp/squid-spool-XXXXXX";
+static int sa, sb;
+
+/* fresh engines and an empty spool file; sa on A, sb bound on B */
+static void setup(void)
+{
+    wire_a2b.head = wire_a2b.tail = 0;
+    wire_b2a.head = wire_b2a.tail = 0;
+    fake_tick = 0;
+    memset(&g_snet, 0, sizeof(g_snet));
+    snet_init(&plat_a, &timing);
+    sa = squid_open();
+    squid_connect(sa, 1);
+    save_a();
+    memset(&g_snet, 0, sizeof(g_snet));
+    snet_init(&plat_b, &timing);
+    sb = squid_open();
+    squid_bind(sb, 1);
+    save_b();
+
+    strcpy(spool_path, "/tmp/squid-spool-XXXXXX");
+    close(mkstemp(spool_path));         /* empty: open creates the ring */
+}
+
+/* one tick on both sides; A polls its spool; B collects into in[] */
+static int32_t step(uint8_t *in, int *got, int max)
+{
+    fake_tick++;
+    load_a(); snet_burst(); int32_t left = squid_spool_poll(&spool); save_a();
+    load_b(); snet_burst();
+    int r = squid_recv(sb, in + *got, (uint16_t)(max - *got));
+    if (r > 0) *got += r;
+    save_b();
+    return left;
+}
+
+static uint8_t pattern(uint32_t i) { return (uint8_t)(i * 31u + (i >> 8)); }
+
+/* ================================================================== */
+/*  Tests                                                             */
+/* ================================================================== */
+
+TEST(test_backlog_outside_the_heap)
+{
+    enum { CAP = 1024, TOTAL = 3000 };
+    static uint8_t out[TOTAL], in[TOTAL];
+    for (uint32_t i = 0; i < TOTAL; i++) out[i] = pattern(i);
+    setup();
+
+    load_a();
+    ASSERT(squid_spool_open(&spool, spool_path, CAP) == 0, "create");
+    ASSERT(squid_spool_attach(&spool, sa) == 0, "attach");
+    ASSERT(squid_spool_write(&spool, out, CAP + 1) == -1, "never fits");
+    ASSERT(squid_spool_write(&spool, out, CAP) == CAP, "fill the ring");
+    ASSERT(squid_spool_write(&spool, out, 1) == SQUID_EAGAIN, "full");
+    save_a();
+
+    /* the link comes up and drains it; writes follow as room frees */
+    int sent = CAP, got = 0;
+    uint32_t peak = 0;
+    for (int t = 0; t < 20000 && got < TOTAL; t++) {
+        load_a();
+        int n = TOTAL - sent > 100 ? 100 : TOTAL - sent;
+        if (n && squid_spool_write(&spool, out + sent, (uint32_t)n) == n) sent += n;
+        if (squid_mem_used() > peak) peak = squid_mem_used();
+        save_a();
+        step(in, &got, TOTAL);
+    }
+    ASSERT(got == TOTAL && memcmp(in, out, TOTAL) == 0, "backlog arrives in order");
+    ASSERT(peak == 0u, "nothing queued on A's heap");
+    for (int t = 0; t < 20; t++) step(in, &got, TOTAL);
+    load_a();
+    ASSERT(squid_spool_poll(&spool) == 0, "every byte ACKed and released");
+    squid_spool_close(&spool);
+    save_a();
+    unlink(spool_path);
+    return 1;
+}
+
+TEST(test_backlog_survives_restart)
+{
+    enum { CAP = 4096, TOTAL = 2000 };
+    static uint8_t out[TOTAL], in[2 * TOTAL];
+    for (uint32_t i = 0; i < TOTAL; i++) out[i] = pattern(i);
+    setup();
+
+    load_a();
+    squid_spool_open(&spool, spool_path, CAP);
+    squid_spool_attach(&spool, sa);
+    ASSERT(squid_spool_write(&spool, out, TOTAL) == TOTAL, "spooled");
+    save_a();
+    int got = 0;
+    int32_t left = TOTAL;
+    for (int t = 0; t < 2000 && left > TOTAL / 2; t++) left = step(in, &got, TOTAL);
+    ASSERT(left > 0 && left <= TOTAL / 2, "half way through");
+
+    /* A's process dies: engine and mapping gone, the file stays */
+    load_a();
+    squid_spool_close(&spool);
+    memset(&g_snet, 0, sizeof(g_snet));
+    snet_init(&plat_a, &timing);
+    sa = squid_open();
+    squid_connect(sa, 1);
+    ASSERT(squid_spool_open(&spool, spool_path, 0) == 0, "reopen");
+    ASSERT(squid_spool_poll(&spool) == -1, "not attached yet");
+    ASSERT(squid_spool_attach(&spool, sa) == 0, "attach after restart");
+    save_a();
+
+    /* resent from the oldest unACKed byte: at most the last frame twice */
+    int before = got;
+    uint32_t head = (uint32_t)(TOTAL - left);
+    ASSERT((uint32_t)before >= head && before - (int)head <= SNET_CFG_LONG,
+           "B is at most one frame ahead of the spool");
+    for (int t = 0; t < 20000 && got < before + left; t++) step(in, &got, 2 * TOTAL);
+    ASSERT(got == before + left, "the rest arrives");
+    ASSERT(memcmp(in, out, head) == 0 &&
+           memcmp(in + before, out + head, (size_t)left) == 0,
+           "resend starts at the spool head");
+    load_a();
+    squid_spool_close(&spool);
+    save_a();
+    unlink(spool_path);
+    return 1;
+}
+
+TEST(test_resend_after_new_session)
+{
+    enum { CAP = 2048, TOTAL = 1500 };
+    static uint8_t out[TOTAL], in[2 * TOTAL];
+    for (uint32_t i = 0; i < TOTAL; i++) out[i] = pattern(i);
+    setup();
+    load_a();
+    squid_spool_open(&spool, spool_path, CAP);
+    squid_spool_attach(&spool, sa);
+    squid_spool_write(&spool, out, TOTAL);
+    save_a();
+    int got = 0;
+    int32_t left = TOTAL;
+    for (int t = 0; t < 2000 && left > TOTAL / 2; t++) left = step(in, &got, TOTAL);
+
+    /* B restarts: A's session is new, its stream stops, poll resends */
+    load_b();
+    memset(&g_snet, 0, sizeof(g_snet));
+    snet_init(&plat_b, &timing);
+    sb = squid_open();
+    squid_bind(sb, 1);
+    save_b();
+    int before = got;
+    for (int t = 0; t < 20000 && left > 0; t++) left = step(in, &got, 2 * TOTAL);
+    ASSERT(left == 0, "spool drained after the new session");
+    ASSERT(got > before && memcmp(in + got - 64, out + TOTAL - 64, 64) == 0,
+           "ends with the spool's last bytes");
+    load_a();
+    squid_spool_close(&spool);
+    save_a();
+    unlink(spool_path);
+    return 1;
+}
+
+TEST(test_poll_on_closed_socket)
+{
+    enum { CAP = 1024, TOTAL = 800 };
+    static uint8_t out[TOTAL], in[2 * TOTAL];
+    for (uint32_t i = 0; i < TOTAL; i++) out[i] = pattern(i);
+    setup();
+    load_a();
+    squid_spool_open(&spool, spool_path, CAP);
+    squid_spool_attach(&spool, sa);
+    squid_spool_write(&spool, out, TOTAL);
+    save_a();
+    int got = 0;
+    int32_t left = TOTAL;
+    for (int t = 0; t < 2000 && left > TOTAL / 2; t++) left = step(in, &got, TOTAL);
+    ASSERT(left > 0 && left < TOTAL, "part of the backlog ACKed");
+
+    /* the socket goes away under the spool: poll fails, head stays */
+    load_a();
+    squid_close(sa);
+    ASSERT(squid_spool_poll(&spool) == -1, "no socket");
+    ASSERT(squid_spool_write(&spool, out, (uint32_t)(CAP - left + 1)) == SQUID_EAGAIN,
+           "room unchanged");
+    sa = squid_open();
+    squid_connect(sa, 1);
+    ASSERT(squid_spool_attach(&spool, sa) == 0, "attach a new socket");
+    ASSERT(squid_spool_poll(&spool) == left, "same backlog as before");
+    save_a();
+
+    for (int t = 0; t < 20000 && left > 0; t++) left = step(in, &got, 2 * TOTAL);
+    ASSERT(left == 0, "backlog drains on the new socket");
+    load_a();
+    squid_spool_close(&spool);
+    save_a();
+    unlink(spool_path);
+    return 1;
+}
+
+TEST(test_rejects_bad_file)
+{
+    setup();
+    ASSERT(squid_spool_open(&spool, spool_path, 1000) == -1, "not a power of 2");
+    FILE *f = fopen(spool_path, "w");
+    fputs("definitely not a spool header, but long enough to look like one "
+          "and then some", f);
+    fclose(f);
+    ASSERT(squid_spool_open(&spool, spool_path, 1024) == -1, "foreign file");
+    unlink(spool_path);
+    return 1;
+}
+
+/* ================================================================== */
+int main(void)
+{
+    printf("libsquid spool test suite\n");
+    printf("=========================\n");
+
+    RUN(test_backlog_outside_the_heap);
+    RUN(test_backlog_survives_restart);
+    RUN(test_resend_after_new_session);
+    RUN(test_poll_on_closed_socket);
+    RUN(test_rejects_bad_file);
+
+    printf("=========================\n");
+    printf("%d/%d tests passed\n", tests_passed, tests_run);
+
+    return (tests_passed == tests_run) ? 0 : 1;
+}
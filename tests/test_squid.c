@@ -14,6 +14,8 @@
 
 #include "squid/snet.h"
 #include "squid/socket.h"
+#include "squid/bond.h"
+#include "squid/rpc.h"
 #include "squid/internal.h"   /* access g_snet for swapping contexts */
 
 /* ================================================================== */
@@ -52,16 +54,52 @@ static int ring_get(ring_t *r)
 /*  Platform hooks — one set for each side                            */
 /* ================================================================== */
 static uint8_t fake_tick = 0;
+static uint32_t a_tx_bytes = 0;   /* bytes A has put on the wire */
+static uint32_t b_tx_bytes = 0;   /* bytes B has put on the wire */
+static int a_drop = 0;            /* drop the next N bytes A sends */
+static int b_drop = 0;            /* drop the next N bytes B sends */
+static int b_legacy = 0;          /* strip the ACK stamp from B's frames */
+static uint8_t b_unstamp;         /* CTRL bits stripped, fixed up in HSH */
+static int cut_a2b = 0, cut_b2a = 0; /* unplugged wire directions */
+static uint8_t a_flip[SNET_FRAME_BYTES]; /* XOR into each byte of A's frames */
+static int a_flip_frames = 0;     /* frames to damage, -1 = all */
+static int a_room = -1;           /* bytes A's UART takes until refilled, -1 = any */
 
 /* Side A: sends into wire_a2b, receives from wire_b2a */
-static int a_send(uint8_t c)  { return ring_put(&wire_a2b, c); }
+static int a_send(uint8_t c)
+{
+    if (a_room == 0) return -1;               /* FIFO full: try later */
+    if (a_room > 0) a_room--;
+    uint8_t pos = (uint8_t)(a_tx_bytes % SNET_FRAME_BYTES);
+    a_tx_bytes++;
+    if (a_flip_frames) {
+        c ^= a_flip[pos];
+        if (pos == SNET_FRAME_BYTES - 1u && a_flip_frames > 0) a_flip_frames--;
+    }
+    if (a_drop > 0) { a_drop--; return 0; }   /* lost on the line */
+    if (cut_a2b) return 0;
+    return ring_put(&wire_a2b, c);
+}
 static int a_recv(void)       { return ring_get(&wire_b2a); }
 static uint8_t a_tick(void)   { return fake_tick; }
-static void* a_malloc(uint16_t n) { return malloc(n); }
-static void  a_free(void *p)      { free(p); }
+static int a_live = 0;            /* A's allocations not yet freed */
+static void* a_malloc(uint16_t n) { a_live++; return malloc(n); }
+static void  a_free(void *p)      { if (p) a_live--; free(p); }
 
 /* Side B: sends into wire_b2a, receives from wire_a2b */
-static int b_send(uint8_t c)  { return ring_put(&wire_b2a, c); }
+static int b_send(uint8_t c)
+{
+    uint8_t pos = (uint8_t)(b_tx_bytes % SNET_FRAME_BYTES);
+    b_tx_bytes++;
+    if (b_legacy && pos == 2u) {           /* CTRL: an older peer leaves 2..1 clear */
+        b_unstamp = (uint8_t)(c & (SNET_CTRL_ACK_MASK | SNET_CTRL_ASEQ_MASK));
+        c ^= b_unstamp;
+    } else if (b_legacy && pos == SNET_FRAME_BYTES - 2u) {   /* HSH */
+        c ^= b_unstamp;
+    }
+    if (b_drop > 0) { b_drop--; return 0; }   /* lost on the line */
+    return cut_b2a ? 0 : ring_put(&wire_b2a, c);
+}
 static int b_recv(void)       { return ring_get(&wire_a2b); }
 static uint8_t b_tick(void)   { return fake_tick; }
 static void* b_malloc(uint16_t n) { return malloc(n); }
@@ -76,15 +114,45 @@ static const squid_platform_t plat_b = {
     .malloc = b_malloc, .free = b_free
 };
 
+/* Bonded sides: two member links per direction */
+static ring_t bond_a2b[2], bond_b2a[2];
+static int bond_cut[2];             /* member link unplugged (both ways) */
+static int a0_refuse;               /* A's member 0 refuses its n-th byte */
+
+static int bput(ring_t *r, int i, uint8_t c) { return bond_cut[i] ? 0 : ring_put(r, c); }
+static int a0_send(uint8_t c)
+{
+    if (a0_refuse && --a0_refuse == 0) return -1;   /* UART busy */
+    return bput(&bond_a2b[0], 0, c);
+}
+static int a1_send(uint8_t c) { return bput(&bond_a2b[1], 1, c); }
+static int b0_send(uint8_t c) { return bput(&bond_b2a[0], 0, c); }
+static int b1_send(uint8_t c) { return bput(&bond_b2a[1], 1, c); }
+static int a0_recv(void)      { return ring_get(&bond_b2a[0]); }
+static int a1_recv(void)      { return ring_get(&bond_b2a[1]); }
+static int b0_recv(void)      { return ring_get(&bond_a2b[0]); }
+static int b1_recv(void)      { return ring_get(&bond_a2b[1]); }
+
+static const squid_platform_t links_a[2] = {
+    { a0_send, a0_recv, a_tick, a_malloc, a_free },
+    { a1_send, a1_recv, a_tick, a_malloc, a_free },
+};
+static const squid_platform_t links_b[2] = {
+    { b0_send, b0_recv, b_tick, b_malloc, b_free },
+    { b1_send, b1_recv, b_tick, b_malloc, b_free },
+};
+static squid_platform_t plat_bond_a, plat_bond_b;
+
 /* ================================================================== */
 /*  Context swapping — save/restore g_snet for each side              */
 /* ================================================================== */
 static snet_ctx_t ctx_a, ctx_b;
+static snet_bond_t bctx_a, bctx_b;
 
-static void load_a(void) { g_snet = ctx_a; }
-static void load_b(void) { g_snet = ctx_b; }
-static void save_a(void) { ctx_a = g_snet; }
-static void save_b(void) { ctx_b = g_snet; }
+static void load_a(void) { g_snet = ctx_a; g_bond = bctx_a; }
+static void load_b(void) { g_snet = ctx_b; g_bond = bctx_b; }
+static void save_a(void) { ctx_a = g_snet; bctx_a = g_bond; }
+static void save_b(void) { ctx_b = g_snet; bctx_b = g_bond; }
 
 /* ================================================================== */
 /*  Helper: pump both sides for N ticks                               */
@@ -131,9 +199,20 @@ static void setup(void)
     ring_reset(&wire_a2b);
     ring_reset(&wire_b2a);
     fake_tick = 0;
+    a_tx_bytes = 0;
+    b_tx_bytes = 0;
+    a_drop = 0;
+    b_drop = 0;
+    b_legacy = 0;
+    cut_a2b = cut_b2a = 0;
+    a_flip_frames = 0;                  /* a_flip is set per test */
+    a_room = -1;
     memset(&ctx_a, 0, sizeof(ctx_a));
     memset(&ctx_b, 0, sizeof(ctx_b));
+    memset(&bctx_a, 0, sizeof(bctx_a));
+    memset(&bctx_b, 0, sizeof(bctx_b));
     memset(&g_snet, 0, sizeof(g_snet));
+    memset(&g_bond, 0, sizeof(g_bond));
 
     squid_timing_t tm = { .timeout_ticks = 3, .ack_delay_ticks = 1,
                           .ping_ticks = 0, .max_retries = 5 };
@@ -410,8 +489,1928 @@ TEST(test_two_sockets_isolated)
     return 1;
 }
 
-/* ================================================================== */
-/*  Main                                                              */
+TEST(test_sendv_recvv)
+{
+    setup();
+    pump(20);
+
+    load_a();
+    int sa = squid_open();
+    ASSERT(sa >= 1, "A fd valid");
+    ASSERT(squid_connect(sa, 1) == 0, "A connect ch1");
+    save_a();
+
+    load_b();
+    int sb = squid_open();
+    ASSERT(sb >= 1, "B fd valid");
+    ASSERT(squid_bind(sb, 1) == 0, "B bind ch1");
+    save_b();
+
+    /* header struct + payload gathered into one message */
+    uint8_t hdr[3] = { 0xC0, 0x01, 0x14 };
+    uint8_t pay[20];
+    for (int i = 0; i < 20; i++) pay[i] = (uint8_t)(0x40 + i);
+    squid_iovec_t tx[3] = { { hdr, 3 }, { NULL, 0 }, { pay, 20 } };
+
+    load_a();
+    ASSERT(squid_sendv(sa, tx, 3) == 23, "sendv should queue 23 bytes");
+    save_a();
+
+    pump(100);
+
+    /* scatter back into header + payload buffers */
+    load_b();
+    uint8_t rh[3], rp[32];
+    squid_iovec_t rx[2] = { { rh, 3 }, { rp, sizeof(rp) } };
+    int got = squid_recvv(sb, rx, 2);
+    ASSERT(got == 23, "recvv should return 23");
+    ASSERT(memcmp(rh, hdr, 3) == 0, "header segment should match");
+    ASSERT(memcmp(rp, pay, 20) == 0, "payload segment should match");
+    save_b();
+
+    return 1;
+}
+
+TEST(test_sendv_atomic_cap)
+{
+    setup();
+    pump(20);
+
+    load_a();
+    int sa = squid_open();
+    ASSERT(squid_connect(sa, 1) == 0, "A connect ch1");
+    snet_chan_t *c = g_snet.chan_head;
+    ASSERT(c && c->fd == (uint8_t)sa, "socket should be list head");
+    c->tx_cap = 10;
+
+    uint8_t a[6] = { 0 }, b[6] = { 0 };
+    squid_iovec_t iov[2] = { { a, 6 }, { b, 6 } };
+    ASSERT(squid_sendv(sa, iov, 2) == -1, "over-cap iovec should be rejected");
+    ASSERT(c->tx_bytes == 0, "nothing should be queued");
+    ASSERT(squid_sendv(sa, iov, 1) == 6, "in-cap iovec should be accepted");
+    ASSERT(c->tx_bytes == 6, "6 bytes should be queued");
+    save_a();
+
+    return 1;
+}
+
+TEST(test_packed_frames)
+{
+    setup();
+    load_a(); snet_set_features(SNET_FEAT_PACK); save_a();
+    load_b(); snet_set_features(SNET_FEAT_PACK); save_b();
+    pump(20);
+
+    int sa[4], sb[4];
+    load_a();
+    ASSERT(snet_features() == SNET_FEAT_PACK, "A should negotiate PACK");
+    for (int i = 0; i < 4; i++) {
+        sa[i] = squid_open();
+        ASSERT(squid_connect(sa[i], (uint8_t)(i + 1)) == 0, "A connect");
+    }
+    save_a();
+    load_b();
+    ASSERT(snet_features() == SNET_FEAT_PACK, "B should negotiate PACK");
+    for (int i = 0; i < 4; i++) {
+        sb[i] = squid_open();
+        ASSERT(squid_bind(sb[i], (uint8_t)(i + 1)) == 0, "B bind");
+    }
+    save_b();
+
+    /* four small writers, 2 bytes each: one packed frame */
+    load_a();
+    for (int i = 0; i < 4; i++) {
+        uint8_t msg[2] = { (uint8_t)(0x10 * (i + 1)), (uint8_t)i };
+        ASSERT(squid_send(sa[i], msg, 2) == 2, "send should queue");
+    }
+    save_a();
+
+    uint32_t before = a_tx_bytes;
+    pump(20);
+    ASSERT(a_tx_bytes - before == 20u, "A should send a single frame");
+
+    load_b();
+    for (int i = 0; i < 4; i++) {
+        uint8_t buf[8];
+        int got = squid_recv(sb[i], buf, sizeof(buf));
+        ASSERT(got == 2, "each channel should receive 2 bytes");
+        ASSERT(buf[0] == (uint8_t)(0x10 * (i + 1)) && buf[1] == (uint8_t)i,
+               "record should land on its own channel");
+    }
+    save_b();
+    return 1;
+}
+
+TEST(test_pack_needs_both_peers)
+{
+    setup();
+    load_a(); snet_set_features(SNET_FEAT_PACK); save_a();
+    pump(20);
+
+    load_a();
+    ASSERT(snet_link_is_up(), "A link should be up");
+    ASSERT(snet_features() == 0u, "PACK must not be active one-sided");
+    save_a();
+    return 1;
+}
+
+/* open + attach channel 1 on both sides; returns 0 on failure */
+static int connect_pair(int *sa, int *sb)
+{
+    load_a();
+    *sa = squid_open();
+    int ok = (*sa >= 1 && squid_connect(*sa, 1) == 0);
+    save_a();
+    load_b();
+    *sb = squid_open();
+    ok = ok && (*sb >= 1 && squid_bind(*sb, 1) == 0);
+    save_b();
+    return ok;
+}
+
+TEST(test_idle_tracks_timers)
+{
+    setup();
+    load_a(); ASSERT(!snet_idle(), "handshake pending"); save_a();
+    pump(20);
+    int sa, sb;
+    ASSERT(connect_pair(&sa, &sb), "connect pair");
+    pump(5);
+    load_a(); ASSERT(snet_idle(), "connected and quiet"); save_a();
+
+    load_a();
+    ASSERT(squid_send(sa, (const uint8_t*)"x", 1) == 1, "send");
+    snet_burst();
+    ASSERT(!snet_idle(), "DATA in flight");
+    save_a();
+    pump(10);
+    load_a(); ASSERT(snet_idle(), "quiet again once ACKed"); save_a();
+    return 1;
+}
+
+TEST(test_recvv_segments_sum_past_64k)
+{
+    setup();
+    pump(20);
+    int sa, sb;
+    ASSERT(connect_pair(&sa, &sb), "connect pair");
+
+    uint8_t msg[23];
+    for (int i = 0; i < 23; i++) msg[i] = (uint8_t)(0x60 + i);
+    load_a(); ASSERT(squid_send(sa, msg, 23) == 23, "send 23"); save_a();
+    pump(100);
+
+    /* 2 x 32 KB: a 16-bit sum would be 0 and read as "no room" */
+    static uint8_t big[2][0x8000];
+    squid_iovec_t rx[2] = { { big[0], 0x8000 }, { big[1], 0x8000 } };
+    load_b();
+    ASSERT(squid_recvv(sb, rx, 2) == 23, "recvv should return 23");
+    ASSERT(memcmp(big[0], msg, 23) == 0, "bytes land in the first segment");
+    save_b();
+    return 1;
+}
+
+/* ---- extended channel ids ---- */
+static const uint8_t xch_ids[4] = { 14, 15, 200, 255 };
+
+/* open xch_ids on both sides after a handshake with the given offers */
+static int xch_pair(uint8_t feat_a, uint8_t feat_b, int *sa, int *sb)
+{
+    setup();
+    load_a(); snet_set_features(feat_a); save_a();
+    load_b(); snet_set_features(feat_b); save_b();
+    pump(20);
+    int ok = 1;
+    load_a();
+    for (int i = 0; i < 4; i++) {
+        sa[i] = squid_open();
+        ok = ok && squid_connect(sa[i], xch_ids[i]) == 0;
+    }
+    save_a();
+    load_b();
+    for (int i = 0; i < 4; i++) {
+        sb[i] = squid_open();
+        ok = ok && squid_bind(sb[i], xch_ids[i]) == 0;
+    }
+    save_b();
+    return ok;
+}
+
+TEST(test_extended_channels)
+{
+    int sa[4], sb[4];
+    uint8_t feat = SNET_FEAT_XCH | SNET_FEAT_LONG;
+    ASSERT(xch_pair(feat, feat, sa, sb), "open 14, 15, 200, 255");
+
+    /* 40 bytes each: frames, short and long, give one byte to the id */
+    load_a();
+    for (int i = 0; i < 4; i++) {
+        uint8_t msg[40];
+        for (int k = 0; k < 40; k++) msg[k] = (uint8_t)(xch_ids[i] + k);
+        ASSERT(squid_send(sa[i], msg, 40) == 40, "send should queue");
+    }
+    save_a();
+    pump(200);
+
+    load_b();
+    for (int i = 0; i < 4; i++) {
+        uint8_t buf[64];
+        ASSERT(squid_recv(sb[i], buf, sizeof(buf)) == 40, "each channel gets 40 bytes");
+        for (int k = 0; k < 40; k++)
+            ASSERT(buf[k] == (uint8_t)(xch_ids[i] + k), "bytes land on their channel");
+    }
+    save_b();
+    return 1;
+}
+
+TEST(test_extended_channels_packed)
+{
+    int sa[4], sb[4];
+    uint8_t feat = SNET_FEAT_XCH | SNET_FEAT_PACK;
+    ASSERT(xch_pair(feat, feat, sa, sb), "open 14, 15, 200, 255");
+
+    /* 1 + 2 + 2 + 2 header bytes and 4 x 2 data: one packed frame */
+    load_a();
+    for (int i = 0; i < 4; i++) {
+        uint8_t msg[2] = { xch_ids[i], (uint8_t)i };
+        ASSERT(squid_send(sa[i], msg, 2) == 2, "send should queue");
+    }
+    save_a();
+    uint32_t before = a_tx_bytes;
+    pump(20);
+    ASSERT(a_tx_bytes - before == 20u, "A should send a single frame");
+
+    load_b();
+    for (int i = 0; i < 4; i++) {
+        uint8_t buf[8];
+        ASSERT(squid_recv(sb[i], buf, sizeof(buf)) == 2, "2 bytes per channel");
+        ASSERT(buf[0] == xch_ids[i] && buf[1] == (uint8_t)i, "record on its channel");
+    }
+    save_b();
+    return 1;
+}
+
+TEST(test_extended_channels_need_both_peers)
+{
+    int sa[4], sb[4];
+    ASSERT(xch_pair(SNET_FEAT_XCH, 0, sa, sb), "open 14, 15, 200, 255");
+    load_a();
+    ASSERT(!(snet_features() & SNET_FEAT_XCH), "one-sided offer: no XCH");
+    for (int i = 0; i < 4; i++)
+        ASSERT(squid_send(sa[i], (const uint8_t*)"xy", 2) == 2, "send should queue");
+    save_a();
+    pump(50);
+
+    /* 14 and 15 fit the 4-bit field; 200 and 255 wait in the queue */
+    load_b();
+    uint8_t buf[8];
+    ASSERT(squid_recv(sb[0], buf, sizeof(buf)) == 2, "channel 14 delivered");
+    ASSERT(squid_recv(sb[1], buf, sizeof(buf)) == 2, "channel 15 delivered");
+    ASSERT(squid_recv(sb[2], buf, sizeof(buf)) <= 0, "channel 200 not addressable");
+    save_b();
+    load_a();
+    uint16_t q = 0;
+    squid_getsockopt(sa[3], SQUID_SO_TXQUEUED, &q);
+    ASSERT(q == 2u, "channel 255 data stays queued");
+    save_a();
+    return 1;
+}
+
+/* pump until A->B (and optionally B->A) delivered n bytes; returns ticks */
+static int ticks_to_deliver(int sa, int sb, int n, int duplex)
+{
+    int got_a = 0, got_b = 0;
+    uint8_t buf[64];
+    for (int t = 1; t <= 5000; t++) {
+        pump(1);
+        load_b();
+        int r = squid_recv(sb, buf, sizeof(buf));
+        if (r > 0) got_b += r;
+        save_b();
+        load_a();
+        r = squid_recv(sa, buf, sizeof(buf));
+        if (r > 0) got_a += r;
+        save_a();
+        if (got_b >= n && (!duplex || got_a >= n)) return t;
+    }
+    return -1;
+}
+
+TEST(test_full_duplex_throughput)
+{
+    uint8_t data[300];
+    memset(data, 0x5A, sizeof(data));
+    int sa, sb;
+
+    /* one direction only */
+    setup();
+    pump(20);
+    ASSERT(connect_pair(&sa, &sb), "connect one-way pair");
+    load_a(); squid_send(sa, data, sizeof(data)); save_a();
+    int one_way = ticks_to_deliver(sa, sb, (int)sizeof(data), 0);
+    ASSERT(one_way > 0, "one-way transfer should complete");
+
+    /* both directions at once */
+    setup();
+    pump(20);
+    ASSERT(connect_pair(&sa, &sb), "connect duplex pair");
+    load_a(); squid_send(sa, data, sizeof(data)); save_a();
+    load_b(); squid_send(sb, data, sizeof(data)); save_b();
+    int duplex = ticks_to_deliver(sa, sb, (int)sizeof(data), 1);
+    ASSERT(duplex > 0, "duplex transfer should complete");
+
+    /* twice the bytes in about the same time */
+    ASSERT(duplex * 4 <= one_way * 5, "directions should not serialize");
+    return 1;
+}
+
+TEST(test_acks_from_unstamping_peer)
+{
+    setup();
+    b_legacy = 1;                       /* B's ACKs look like an older peer's */
+    pump(20);
+    int sa, sb;
+    ASSERT(connect_pair(&sa, &sb), "connect pair");
+
+    uint8_t data[100], back[30];
+    for (int i = 0; i < 100; i++) data[i] = (uint8_t)(i * 3 + 1);
+    memset(back, 0x42, sizeof(back));
+    load_a(); squid_send(sa, data, sizeof(data)); save_a();
+    load_b(); squid_send(sb, back, sizeof(back)); save_b();
+
+    uint8_t buf[128];
+    int got_b = 0, got_a = 0, drops = 0;
+    for (int t = 0; t < 600 && (got_b < 100 || got_a < 30); t++) {
+        pump(1);
+        load_b();
+        int n = squid_recv(sb, buf + got_b, (uint16_t)(sizeof(buf) - got_b));
+        if (n > 0) got_b += n;
+        save_b();
+        load_a();
+        uint8_t tmp[32];
+        n = squid_recv(sa, tmp, sizeof(tmp));
+        if (n > 0) got_a += n;
+        if (!snet_link_is_up()) drops++;
+        save_a();
+    }
+    ASSERT(got_b == 100 && memcmp(buf, data, 100) == 0, "A->B stream intact");
+    ASSERT(got_a == 30, "B->A data arrives");
+    ASSERT(drops == 0, "unstamped ACKs keep the link up");
+    ASSERT(a_tx_bytes < 20u * SNET_FRAME_BYTES, "no resends"); /* 7 DATA + ACKs */
+    pump(40);                           /* the last ACKs */
+    load_a();
+    ASSERT(g_snet.eng == SNET_ENG_CONNECTED, "nothing left unacknowledged");
+    save_a();
+    return 1;
+}
+
+TEST(test_duplex_lost_frame)
+{
+    setup();
+    pump(20);
+    int sa, sb;
+    ASSERT(connect_pair(&sa, &sb), "connect pair");
+
+    uint8_t ma[10], mb[10];
+    for (int i = 0; i < 10; i++) { ma[i] = (uint8_t)i; mb[i] = (uint8_t)(0xA0 + i); }
+    load_a(); squid_send(sa, ma, 10); save_a();
+    load_b(); squid_send(sb, mb, 10); save_b();
+
+    /* A's first DATA is lost; B's DATA must not count as its ACK */
+    a_drop = SNET_FRAME_BYTES;
+    pump(40);
+
+    uint8_t buf[32];
+    load_b();
+    ASSERT(squid_recv(sb, buf, sizeof(buf)) == 10, "B should get A's data");
+    ASSERT(memcmp(buf, ma, 10) == 0, "A->B data should match");
+    save_b();
+    load_a();
+    ASSERT(squid_recv(sa, buf, sizeof(buf)) == 10, "A should get B's data");
+    ASSERT(memcmp(buf, mb, 10) == 0, "B->A data should match");
+    ASSERT(snet_link_is_up(), "link should stay up");
+    save_a();
+    return 1;
+}
+
+/* transfer 200 bytes A->B with a wire cut in the middle */
+static int wiggle_transfer(int cut_fwd, int cut_back)
+{
+    setup();
+    load_a(); snet_set_features(SNET_FEAT_RESUME); save_a();
+    load_b(); snet_set_features(SNET_FEAT_RESUME); save_b();
+    pump(20);
+    int sa, sb;
+    if (!connect_pair(&sa, &sb)) return 0;
+
+    uint8_t data[200];
+    for (int i = 0; i < 200; i++) data[i] = (uint8_t)(i * 7);
+    load_a(); squid_send(sa, data, sizeof(data)); save_a();
+
+    pump(8);                            /* cut with A's DATA in flight */
+    cut_a2b = cut_fwd;
+    cut_b2a = cut_back;
+    pump(60);                           /* retries run out on A */
+    load_a();
+    int was_down = !snet_link_is_up();
+    save_a();
+    cut_a2b = cut_b2a = 0;
+
+    uint8_t got[256];
+    int n = 0;
+    for (int t = 0; t < 400; t++) {
+        pump(1);
+        load_b();
+        int r = squid_recv(sb, got + n, (uint16_t)(sizeof(got) - n));
+        if (r > 0) n += r;
+        save_b();
+    }
+    return was_down && n == 200 && memcmp(got, data, 200) == 0;
+}
+
+TEST(test_resume_after_cut)
+{
+    ASSERT(wiggle_transfer(1, 1), "cut both ways: exact stream expected");
+    return 1;
+}
+
+TEST(test_resume_lost_ack)
+{
+    /* DATA arrives but ACKs are lost: no duplicate after resume */
+    ASSERT(wiggle_transfer(0, 1), "cut B->A: exact stream expected");
+    return 1;
+}
+
+TEST(test_no_resume_after_peer_restart)
+{
+    setup();
+    load_a(); snet_set_features(SNET_FEAT_RESUME); save_a();
+    load_b(); snet_set_features(SNET_FEAT_RESUME); save_b();
+    pump(20);
+
+    /* B restarts: new session token, no memory of A */
+    load_b();
+    snet_init(&plat_b, NULL);
+    snet_set_features(SNET_FEAT_RESUME);
+    save_b();
+    pump(40);
+
+    load_a();
+    ASSERT(snet_link_is_up(), "A should reconnect");
+    ASSERT(!g_snet.resumed, "A must not resume a restarted peer");
+    save_a();
+
+    int sa, sb;
+    ASSERT(connect_pair(&sa, &sb), "connect after restart");
+    uint8_t msg[3] = { 1, 2, 3 }, buf[8];
+    load_a(); squid_send(sa, msg, 3); save_a();
+    pump(20);
+    load_b();
+    ASSERT(squid_recv(sb, buf, sizeof(buf)) == 3, "data should flow again");
+    save_b();
+    return 1;
+}
+
+/* B's HELLO_ACK is lost: B is up, A keeps sending the same HELLO */
+static int lost_hello_ack(uint8_t feat)
+{
+    setup();
+    load_a(); snet_set_features(feat); save_a();
+    load_b(); snet_set_features(feat); save_b();
+    b_drop = SNET_FRAME_BYTES;          /* B's first frame: the answer */
+    int a_up = 0, b_up = 0;
+    for (int t = 0; t < 20 && !b_up; t++) {
+        pump(1);
+        load_b(); b_up = snet_link_is_up(); save_b();
+    }
+    load_a(); a_up = snet_link_is_up(); save_a();
+    if (!b_up || a_up || b_drop) return 0;  /* not the case under test */
+    pump(40);
+    load_a(); a_up = snet_link_is_up(); save_a();
+    load_b(); b_up = snet_link_is_up(); save_b();
+    return a_up && b_up;
+}
+
+TEST(test_lost_hello_ack_answered_again)
+{
+    ASSERT(lost_hello_ack(0u), "plain: A should come up");
+    ASSERT(lost_hello_ack(SNET_FEAT_RESUME), "resume: A should come up");
+
+    int sa, sb;
+    ASSERT(connect_pair(&sa, &sb), "connect pair");
+    uint8_t buf[8];
+    load_a(); squid_send(sa, (const uint8_t*)"late", 4); save_a();
+    pump(20);
+    load_b();
+    ASSERT(squid_recv(sb, buf, sizeof(buf)) == 4, "data flows after the retry");
+    save_b();
+    return 1;
+}
+
+TEST(test_rx_cap_backpressure)
+{
+    setup();
+    pump(20);
+    int sa, sb;
+    ASSERT(connect_pair(&sa, &sb), "connect pair");
+    load_b(); g_snet.chan_head->rx_cap = 30; save_b();
+
+    uint8_t data[200], got[200];
+    for (int i = 0; i < 200; i++) data[i] = (uint8_t)(i + 3);
+    load_a(); squid_send(sa, data, sizeof(data)); save_a();
+
+    /* nobody reads on B: far longer than timeout * max_retries */
+    pump(300);
+    load_a(); ASSERT(snet_link_is_up(), "busy receiver must not drop link"); save_a();
+    load_b(); ASSERT(g_snet.chan_head->rx_bytes <= 30, "rx_cap respected"); save_b();
+
+    int have = 0;
+    for (int t = 0; t < 600 && have < 200; t++) {
+        pump(1);
+        load_b();
+        int r = squid_recv(sb, got + have, 10);
+        if (r > 0) have += r;
+        save_b();
+    }
+    ASSERT(have == 200, "all bytes should arrive once B reads");
+    ASSERT(memcmp(got, data, 200) == 0, "nothing lost while busy");
+    return 1;
+}
+
+static int writable_fd, writable_calls;
+static void on_writable(int fd, void *arg)
+{
+    (void)arg;
+    writable_fd = fd;
+    writable_calls++;
+}
+
+TEST(test_sockopt_get_set)
+{
+    setup();
+    load_a();
+    int sa = squid_open();
+    squid_connect(sa, 1);
+    uint16_t v = 1;
+    ASSERT(squid_getsockopt(sa, SQUID_SO_TXCAP, &v) == 0 && v == 0, "no cap by default");
+    ASSERT(squid_setsockopt(sa, SQUID_SO_TXCAP, 100) == 0, "set TXCAP");
+    ASSERT(squid_setsockopt(sa, SQUID_SO_RXCAP, 200) == 0, "set RXCAP");
+    ASSERT(squid_getsockopt(sa, SQUID_SO_TXCAP, &v) == 0 && v == 100, "get TXCAP");
+    ASSERT(squid_getsockopt(sa, SQUID_SO_RXCAP, &v) == 0 && v == 200, "get RXCAP");
+    ASSERT(squid_setsockopt(sa, SQUID_SO_TXQUEUED, 5) == -1, "TXQUEUED is read-only");
+    ASSERT(squid_setsockopt(sa, 99, 5) == -1, "unknown option");
+    ASSERT(squid_setsockopt(sa + 1, SQUID_SO_TXCAP, 5) == -1, "unopened fd");
+
+    squid_send(sa, (const uint8_t*)"abc", 3);
+    ASSERT(squid_getsockopt(sa, SQUID_SO_TXQUEUED, &v) == 0 && v == 3, "TXQUEUED");
+    ASSERT(squid_send(sa, (const uint8_t*)"x", 0) == -1, "empty send is an error");
+    save_a();
+    return 1;
+}
+
+TEST(test_send_would_block_then_writable)
+{
+    setup();
+    pump(20);
+    int sa, sb;
+    ASSERT(connect_pair(&sa, &sb), "connect pair");
+
+    uint8_t data[40];
+    memset(data, 0x33, sizeof(data));
+    writable_calls = 0;
+    load_a();
+    squid_on_writable(on_writable, NULL);
+    squid_setsockopt(sa, SQUID_SO_TXCAP, 50);
+    squid_setsockopt(sa, SQUID_SO_TXLOWAT, 10);
+    ASSERT(squid_send(sa, data, 51) == -1, "larger than the cap never fits");
+    ASSERT(squid_send(sa, data, 40) == 40, "first send fits");
+    ASSERT(squid_send(sa, data, 20) == SQUID_EAGAIN, "second would block");
+    ASSERT(g_snet.chan_head->tx_bytes == 40, "refused send queues nothing");
+    save_a();
+
+    /* the callback waits for the low watermark, not just for room */
+    for (int t = 0; t < 200 && !writable_calls; t++) {
+        pump(1);
+        load_a();
+        uint16_t q = 0;
+        squid_getsockopt(sa, SQUID_SO_TXQUEUED, &q);
+        save_a();
+        if (!writable_calls) ASSERT(q > 10, "no callback above TXLOWAT");
+    }
+    ASSERT(writable_calls == 1 && writable_fd == sa, "one callback for sa");
+    load_a();
+    ASSERT(squid_send(sa, data, 20) == 20, "send fits after the callback");
+    save_a();
+    pump(100);
+    ASSERT(writable_calls == 1, "no callback without a refused send");
+    return 1;
+}
+
+TEST(test_memory_budget)
+{
+    setup();
+    pump(20);
+    int sa, sb;
+    ASSERT(connect_pair(&sa, &sb), "connect pair");
+
+    /* A: total queued memory bounded, headers included */
+    uint8_t data[30];
+    memset(data, 0x44, sizeof(data));
+    load_a();
+    squid_set_budget(200);
+    int ok = 0, rc;
+    while ((rc = squid_send(sa, data, sizeof(data))) == (int)sizeof(data)) ok++;
+    ASSERT(rc == SQUID_EAGAIN, "budget gives would-block");
+    ASSERT(ok >= 3 && squid_mem_used() <= 200, "queued memory within budget");
+    save_a();
+
+    /* B: a stalled reader holds the peer off instead of growing */
+    load_b(); squid_set_budget(100); save_b();
+    pump(400);
+    load_b();
+    ASSERT(squid_mem_used() <= 100, "RX stays within budget");
+    uint8_t buf[256];
+    int got = squid_recv(sb, buf, sizeof(buf));
+    ASSERT(got > 0 && squid_mem_used() == 0, "recv releases the memory");
+    save_b();
+    load_a();
+    ASSERT(snet_link_is_up(), "busy peer keeps the link up");
+    save_a();
+
+    for (int t = 0; t < 400 && got < ok * 30; t++) {
+        pump(1);
+        load_b();
+        int r = squid_recv(sb, buf, sizeof(buf));
+        if (r > 0) got += r;
+        save_b();
+    }
+    ASSERT(got == ok * 30, "everything arrives once B reads");
+    return 1;
+}
+
+/* B: every subscriber reads the whole payload from the shared queue */
+static int sub_read_all(int fd, uint8_t *buf, int want)
+{
+    int got = 0, r;
+    while (got < want && (r = squid_recv(fd, buf + got, 7)) > 0) got += r;
+    return got;
+}
+
+TEST(test_subscribe_fan_out)
+{
+    setup();
+    pump(20);
+    uint8_t out[60], in1[60], in2[60];
+    for (int i = 0; i < 60; i++) out[i] = (uint8_t)(i * 7 + 3);
+
+    load_a();
+    int sa = squid_open();
+    ASSERT(squid_connect(sa, 2) == 0, "A connect");
+    save_a();
+
+    /* reference: a plain bound socket's queued memory for the payload */
+    load_b();
+    int plain = squid_open();
+    ASSERT(squid_bind(plain, 2) == 0, "plain bind");
+    save_b();
+    load_a(); squid_send(sa, out, 60); save_a();
+    pump(60);
+    load_b();
+    uint32_t one_copy = squid_mem_used();
+    ASSERT(one_copy > 60u && sub_read_all(plain, in1, 60) == 60, "plain receive");
+    int s1 = squid_open(), s2 = squid_open();
+    ASSERT(squid_subscribe(s1, 2) == -1, "bound channel is not shared");
+    ASSERT(squid_subscribe(s1, 3) == 0 && squid_subscribe(s2, 3) == 0,
+           "two subscribers on one channel");
+    ASSERT(squid_bind(plain, 3) == -1, "subscribed channel cannot be bound");
+    save_b();
+
+    load_a(); squid_connect(sa, 3); squid_send(sa, out, 60); save_a();
+    pump(60);
+    load_b();
+    uint16_t q1 = 0, q2 = 0;
+    squid_getsockopt(s1, SQUID_SO_RXQUEUED, &q1);
+    squid_getsockopt(s2, SQUID_SO_RXQUEUED, &q2);
+    ASSERT(q1 == 60 && q2 == 60, "each subscriber counts the whole payload");
+    ASSERT(squid_mem_used() == one_copy, "payload stored once");
+
+    ASSERT(sub_read_all(s1, in1, 60) == 60 && memcmp(in1, out, 60) == 0,
+           "first subscriber reads everything");
+    ASSERT(squid_mem_used() == one_copy, "kept for the second reader");
+    ASSERT(squid_recv(s2, in2, 30) == 30, "second reader, first half");
+    ASSERT(squid_mem_used() < one_copy, "blocks both read are freed");
+    ASSERT(sub_read_all(s2, in2 + 30, 30) == 30 && memcmp(in2, out, 60) == 0,
+           "second subscriber reads everything");
+    ASSERT(squid_mem_used() == 0u, "freed after the last reader");
+    save_b();
+    return 1;
+}
+
+TEST(test_subscribe_join_leave_and_pacing)
+{
+    setup();
+    pump(20);
+    uint8_t out[90], buf[90];
+    for (int i = 0; i < 90; i++) out[i] = (uint8_t)(i + 1);
+    load_a();
+    int sa = squid_open();
+    squid_connect(sa, 4);
+    save_a();
+    load_b();
+    int s1 = squid_open(), s2 = squid_open(), s3 = squid_open();
+    squid_subscribe(s1, 4);
+    squid_subscribe(s2, 4);
+    save_b();
+
+    load_a(); squid_send(sa, out, 30); save_a();
+    pump(40);
+
+    /* a late subscriber starts at the next payload; the first
+       subscriber leaving hands the shared queue on */
+    load_b();
+    ASSERT(squid_subscribe(s3, 4) == 0, "late subscriber");
+    squid_close(s1);
+    ASSERT(squid_setsockopt(s3, SQUID_SO_RXCAP, 30) == 0, "cap the new one");
+    save_b();
+    load_a(); squid_send(sa, out + 30, 60); save_a();
+    pump(100);
+
+    load_b();
+    uint16_t q2 = 0, q3 = 0;
+    squid_getsockopt(s2, SQUID_SO_RXQUEUED, &q2);
+    squid_getsockopt(s3, SQUID_SO_RXQUEUED, &q3);
+    ASSERT(q3 <= 30 && q2 == 30 + q3, "slowest subscriber paces the channel");
+    ASSERT(sub_read_all(s2, buf, 90) == q2 && memcmp(buf, out, q2) == 0,
+           "old subscriber keeps its backlog after the handover");
+    ASSERT(sub_read_all(s3, buf, 90) == q3 && memcmp(buf, out + 30, q3) == 0,
+           "late subscriber sees only later payloads");
+    save_b();
+
+    int got2 = q2, got3 = q3;
+    for (int t = 0; t < 400 && got3 < 60; t++) {
+        pump(1);
+        load_b();
+        int r = squid_recv(s3, buf + got3, 90);
+        if (r > 0) got3 += r;
+        r = squid_recv(s2, buf, 90);
+        if (r > 0) got2 += r;
+        save_b();
+    }
+    ASSERT(got3 == 60 && got2 == 90, "rest arrives once the slow one reads");
+    load_b();
+    squid_close(s2);
+    squid_close(s3);
+    ASSERT(squid_mem_used() == 0u, "nothing left queued");
+    ASSERT(squid_bind(squid_open(), 4) == 0, "channel free after the last one");
+    save_b();
+    return 1;
+}
+
+static int delivered_calls;
+static uint32_t delivered_upto;
+static void on_delivered(int fd, uint32_t upto, void *arg)
+{
+    (void)fd; (void)arg;
+    delivered_calls++;
+    delivered_upto = upto;
+}
+
+TEST(test_confirmed_send)
+{
+    setup();
+    pump(20);
+    int sa, sb;
+    ASSERT(connect_pair(&sa, &sb), "connect pair");
+
+    uint8_t msg[40], buf[64];
+    memset(msg, 0x66, sizeof(msg));
+    uint32_t t1 = 0, t2 = 0;
+    delivered_calls = 0;
+    load_a();
+    squid_on_delivered(on_delivered, NULL);
+    ASSERT(squid_send_confirmed(sa, msg, 40, &t1) == 40, "first send");
+    ASSERT(squid_send_confirmed(sa, msg, 10, &t2) == 10, "second send");
+    ASSERT(t1 == 40 && t2 == 50, "tickets are end offsets");
+    ASSERT(squid_delivered(sa, t1) == 0, "not delivered before any ACK");
+    save_a();
+
+    int seen_t1_first = 0;
+    for (int t = 0; t < 100; t++) {
+        pump(1);
+        load_a();
+        int d1 = squid_delivered(sa, t1), d2 = squid_delivered(sa, t2);
+        save_a();
+        if (d1 == 1 && d2 == 0) seen_t1_first = 1;
+        if (d2 == 1) break;
+    }
+    ASSERT(seen_t1_first, "t1 completes before t2");
+    ASSERT(delivered_calls >= 2 && delivered_upto == 50, "callback up to t2");
+    load_b();
+    ASSERT(squid_recv(sb, buf, sizeof(buf)) == 50, "peer has all bytes");
+    save_b();
+
+    /* plain sends do not call back */
+    int calls = delivered_calls;
+    load_a(); squid_send(sa, msg, 20); save_a();
+    pump(40);
+    ASSERT(delivered_calls == calls, "no callback without a confirmed send");
+    load_a(); ASSERT(squid_delivered(sa, 70) == 1, "plain bytes still count"); save_a();
+    return 1;
+}
+
+TEST(test_confirmed_lost_on_new_session)
+{
+    setup();
+    pump(20);
+    int sa, sb;
+    ASSERT(connect_pair(&sa, &sb), "connect pair");
+
+    uint8_t msg[30];
+    memset(msg, 0x77, sizeof(msg));
+    uint32_t t1 = 0;
+    delivered_calls = 0;
+    load_a();
+    squid_on_delivered(on_delivered, NULL);
+    squid_send_confirmed(sa, msg, 30, &t1);
+    save_a();
+
+    /* first DATA goes out, its ACK never comes back; B restarts */
+    cut_b2a = 1;
+    pump(2);
+    load_b(); snet_init(&plat_b, NULL); save_b();
+    cut_b2a = 0;
+    pump(60);
+
+    load_a();
+    ASSERT(snet_link_is_up(), "link should come back");
+    ASSERT(squid_delivered(sa, t1) == -1, "ticket over the dropped frame is lost");
+    save_a();
+    ASSERT(delivered_calls >= 1, "loss is reported through the callback");
+
+    load_b(); sb = squid_open(); squid_bind(sb, 1); save_b();
+    uint32_t t2 = 0;
+    load_a(); squid_send_confirmed(sa, msg, 5, &t2); save_a();
+    pump(60);
+    load_a();
+    ASSERT(squid_delivered(sa, t2) == 1, "later sends deliver normally");
+    ASSERT(squid_delivered(sa, t1) == -1, "lost stays lost");
+    save_a();
+    return 1;
+}
+
+/* A's DATA in flight, B's ACK cut, B restarts: a fresh session drops it */
+static void lose_in_flight(void)
+{
+    cut_b2a = 1;
+    pump(2);
+    load_b(); snet_init(&plat_b, NULL); save_b();
+    cut_b2a = 0;
+    pump(60);
+}
+
+TEST(test_confirmed_lost_twice)
+{
+    setup();
+    pump(20);
+    int sa, sb;
+    ASSERT(connect_pair(&sa, &sb), "connect pair");
+
+    uint8_t msg[30];
+    memset(msg, 0x66, sizeof(msg));
+    uint32_t t1 = 0, t2 = 0;
+    load_a(); squid_send_confirmed(sa, msg, 30, &t1); save_a();
+    lose_in_flight();
+    load_a();
+    ASSERT(squid_delivered(sa, t1) == -1, "first loss");
+    squid_send_confirmed(sa, msg, 30, &t2);
+    save_a();
+    lose_in_flight();
+
+    load_a();
+    ASSERT(snet_link_is_up(), "link should come back");
+    ASSERT(squid_delivered(sa, t2) == -1, "second loss");
+    ASSERT(squid_delivered(sa, t1) == -1, "first loss is not confirmed later");
+    save_a();
+    return 1;
+}
+
+/* ================================================================== */
+/*  Tests: bonded links                                               */
+/* ================================================================== */
+static void setup_bond(void)
+{
+    setup();
+    for (int i = 0; i < 2; i++) {
+        ring_reset(&bond_a2b[i]);
+        ring_reset(&bond_b2a[i]);
+        bond_cut[i] = 0;
+    }
+    a0_refuse = 0;
+    squid_timing_t tm = { .timeout_ticks = 3, .ack_delay_ticks = 1,
+                          .ping_ticks = 0, .max_retries = 5 };
+    load_a();
+    squid_bond_init(links_a, 2, 0, 0, &plat_bond_a);
+    snet_init(&plat_bond_a, &tm);
+    save_a();
+    load_b();
+    squid_bond_init(links_b, 2, 0, 0, &plat_bond_b);
+    snet_init(&plat_bond_b, &tm);
+    save_b();
+}
+
+/* transfer n bytes A->B over the bond; cut member 1 after cut_at ticks */
+static int bond_transfer(int n, int cut_at)
+{
+    int sa, sb;
+    if (!connect_pair(&sa, &sb)) return 0;
+
+    uint8_t data[300], got[300];
+    for (int i = 0; i < n; i++) data[i] = (uint8_t)(i ^ 0x3C);
+    load_a(); squid_send(sa, data, (uint16_t)n); save_a();
+
+    int have = 0;
+    for (int t = 0; t < 600 && have < n; t++) {
+        if (t == cut_at) bond_cut[1] = 1;
+        pump(1);
+        load_b();
+        int r = squid_recv(sb, got + have, (uint16_t)(sizeof(got) - have));
+        if (r > 0) have += r;
+        save_b();
+    }
+    return have == n && memcmp(got, data, (size_t)n) == 0;
+}
+
+TEST(test_bond_spreads_frames)
+{
+    setup_bond();
+    pump(20);
+    load_a(); ASSERT(snet_link_is_up(), "A link up over bond"); save_a();
+    load_b(); ASSERT(snet_link_is_up(), "B link up over bond"); save_b();
+
+    ASSERT(bond_transfer(300, -1), "300 bytes should arrive in order");
+    ASSERT(bond_a2b[0].head > 200 && bond_a2b[1].head > 200,
+           "both member links should carry frames");
+    return 1;
+}
+
+TEST(test_bond_survives_member_failure)
+{
+    setup_bond();
+    pump(20);
+    ASSERT(bond_transfer(300, 15), "transfer should finish on one member");
+
+    load_a();
+    ASSERT(snet_link_is_up(), "session should stay up");
+    ASSERT(squid_bond_links_up() == 0x01u, "member 1 should be down");
+    save_a();
+    return 1;
+}
+
+TEST(test_bond_resumes_cut_envelope)
+{
+    setup_bond();
+    pump(20);
+    a0_refuse = 11;                     /* mid-envelope on member 0 */
+    ASSERT(bond_transfer(300, -1), "300 bytes should arrive in order");
+    pump(40);
+    ASSERT(a0_refuse == 0, "member 0 refused a byte");
+    ASSERT(bond_a2b[0].head % SNET_BOND_ENV == 0,
+           "member 0 should carry whole envelopes only");
+    return 1;
+}
+
+TEST(test_bond_scoped_to_its_engine)
+{
+    uint8_t feat = SNET_FEAT_LONG | SNET_FEAT_SHORT;
+    setup_bond();
+    load_a(); snet_set_features(feat); save_a();
+    load_b(); snet_set_features(feat); save_b();
+    pump(40);
+    load_a();
+    ASSERT(snet_link_is_up(), "link up over bond");
+    ASSERT((g_snet.feat & feat) == 0u, "bonded engine keeps 20-byte frames");
+    save_a();
+
+    /* a bond set up in this thread but not used by these engines */
+    setup();
+    load_a();
+    squid_bond_init(links_a, 2, 0, 0, &plat_bond_a);
+    snet_set_features(feat);
+    save_a();
+    load_b(); snet_set_features(feat); save_b();
+    pump(40);
+    load_a();
+    ASSERT(snet_link_is_up(), "plain link up");
+    ASSERT((g_snet.feat & feat) == feat, "plain engine still negotiates both");
+    save_a();
+    return 1;
+}
+
+/* put one bond envelope carrying a dummy frame tagged with seq */
+static void put_env(ring_t *r, uint8_t seq)
+{
+    ring_put(r, seq);
+    for (int i = 0; i < SNET_FRAME_BYTES; i++)
+        ring_put(r, (uint8_t)(i == 0 ? SNET_STX : (seq << 4) + i));
+}
+
+TEST(test_bond_reorders)
+{
+    setup_bond();
+    load_b();
+
+    /* 4 syncs the window; 6 overtakes 5 on the other member; the
+       second copy of 5 is a late duplicate */
+    put_env(&bond_a2b[0], 4);
+    put_env(&bond_a2b[0], 6);
+    put_env(&bond_a2b[1], 5);
+    put_env(&bond_a2b[0], 5);
+
+    uint8_t out[4 * SNET_FRAME_BYTES];
+    int n = 0, c;
+    while (n < (int)sizeof(out) && (c = plat_bond_b.recv_char()) >= 0)
+        out[n++] = (uint8_t)c;
+    ASSERT(n == 3 * SNET_FRAME_BYTES, "three frames, duplicate dropped");
+    for (int f = 0; f < 3; f++)
+        ASSERT(out[f * SNET_FRAME_BYTES + 1] == (uint8_t)(((4 + f) << 4) + 1),
+               "frames should come out in bond order");
+    save_b();
+    return 1;
+}
+
+/* ================================================================== */
+/*  Main                                                              */
+/* ================================================================== */
+/*  Tests: buffered receive (snet_feed)                               */
+/* ================================================================== */
+
+/* Like pump(), but B takes A's bytes through snet_feed() in chunks of
+ * `chunk`, with a false STX between chunks when `noise` is set. */
+static void pump_feed(int ticks, int chunk, int noise)
+{
+    static const uint8_t junk[3] = { 0x7E, 0x00, 0x7E };
+    for (int t = 0; t < ticks; t++) {
+        fake_tick++;
+
+        load_a();
+        snet_burst();
+        save_a();
+
+        uint8_t buf[RING_SIZE];
+        int n = 0, c;
+        while ((c = ring_get(&wire_a2b)) >= 0) buf[n++] = (uint8_t)c;
+
+        load_b();
+        for (int off = 0; off < n; off += chunk) {
+            int run = (n - off < chunk) ? n - off : chunk;
+            snet_feed(buf + off, (size_t)run);
+            if (noise) snet_feed(junk, sizeof(junk));
+        }
+        snet_burst();
+        save_b();
+    }
+}
+
+static int feed_transfer(int chunk, int noise)
+{
+    setup();
+    pump_feed(20, chunk, noise);
+    int sa, sb;
+    if (!connect_pair(&sa, &sb)) return 0;
+
+    uint8_t out[300], in[300];
+    for (int i = 0; i < 300; i++) out[i] = (uint8_t)(i * 7 + 3);
+    load_a();
+    int ok = squid_send(sa, out, sizeof(out)) == (int)sizeof(out);
+    save_a();
+
+    pump_feed(1500, chunk, noise);
+
+    load_b();
+    ok = ok && squid_recv(sb, in, sizeof(in)) == (int)sizeof(in);
+    save_b();
+    return ok && memcmp(in, out, sizeof(out)) == 0;
+}
+
+TEST(test_feed_whole_buffers)
+{
+    ASSERT(feed_transfer(RING_SIZE, 0), "stream via whole buffers");
+    return 1;
+}
+
+TEST(test_feed_split_frames)
+{
+    ASSERT(feed_transfer(1, 0), "stream via single bytes");
+    ASSERT(feed_transfer(7, 0), "stream via frames split at odd offsets");
+    return 1;
+}
+
+TEST(test_feed_resyncs_after_noise)
+{
+    /* a false STX after a partial frame costs that frame; resends and
+       the duplicate check still deliver the stream intact */
+    ASSERT(feed_transfer(RING_SIZE, 1), "noise between whole buffers");
+    ASSERT(feed_transfer(33, 1), "noise inside the stream");
+    return 1;
+}
+
+/* ================================================================== */
+/*  Tests: forward error correction                                   */
+/* ================================================================== */
+
+/* A sends 300 bytes to B with FEC on both sides, frames damaged as set
+ * in a_flip for `frames` frames; returns bytes A put on the wire, or 0
+ * when the data did not arrive intact */
+static uint32_t fec_transfer(int frames, int feed)
+{
+    setup();
+    load_a(); snet_set_features(SNET_FEAT_FEC); save_a();
+    load_b(); snet_set_features(SNET_FEAT_FEC); save_b();
+    pump(20);
+    int sa, sb;
+    if (!connect_pair(&sa, &sb)) return 0;
+    load_b();
+    int ok = snet_features() == SNET_FEAT_FEC;
+    save_b();
+
+    uint8_t out[300], in[300];
+    for (int i = 0; i < 300; i++) out[i] = (uint8_t)(i * 11 + 5);
+    load_a();
+    ok = ok && squid_send(sa, out, sizeof(out)) == (int)sizeof(out);
+    save_a();
+
+    uint32_t before = a_tx_bytes;
+    a_flip_frames = frames;
+    if (feed) pump_feed(200, 64, 0);
+    else      pump(200);
+    a_flip_frames = 0;
+
+    load_b();
+    ok = ok && squid_recv(sb, in, sizeof(in)) == (int)sizeof(in);
+    save_b();
+    return (ok && memcmp(in, out, sizeof(out)) == 0) ? a_tx_bytes - before : 0u;
+}
+
+TEST(test_fec_repairs_without_resend)
+{
+    uint32_t clean = fec_transfer(0, 0);
+    ASSERT(clean > 0u, "clean transfer should complete");
+    ASSERT(clean >= (300u / SNET_PAY_FEC) * SNET_FRAME_BYTES,
+           "coded frames should carry 11 bytes at most");
+
+    /* two bytes of every frame, payload and header */
+    a_flip[2] = 0x40; a_flip[9] = 0xFF;
+    ASSERT(fec_transfer(-1, 0) == clean, "CTRL+payload damage: no resend");
+    memset(a_flip, 0, sizeof(a_flip));
+    a_flip[1] = 0x01; a_flip[SNET_FRAME_BYTES - 2] = 0x80;
+    ASSERT(fec_transfer(-1, 0) == clean, "CHLEN+HSH damage: no resend");
+    memset(a_flip, 0, sizeof(a_flip));
+    a_flip[16] = 0x33; a_flip[SNET_FRAME_BYTES - 1] = 0x01;
+    ASSERT(fec_transfer(-1, 1) == clean, "parity+ETX damage via snet_feed");
+    return 1;
+}
+
+TEST(test_fec_resends_past_two_bytes)
+{
+    uint32_t clean = fec_transfer(0, 0);
+    memset(a_flip, 0, sizeof(a_flip));
+    a_flip[4] = 0x01; a_flip[7] = 0x02; a_flip[10] = 0x04;
+    uint32_t hurt = fec_transfer(3, 0);
+    ASSERT(hurt > clean, "three bad bytes should fall back to resends");
+    return 1;
+}
+
+/* ================================================================== */
+/*  Tests: short control frames                                       */
+/* ================================================================== */
+
+/* A sends 300 bytes to B, both offering feat; returns the bytes B put
+ * on the wire (ACKs only), 0 when the data did not arrive intact */
+static uint32_t ack_bytes(uint8_t feat)
+{
+    setup();
+    load_a(); snet_set_features(feat); save_a();
+    load_b(); snet_set_features(feat); save_b();
+    pump(20);
+    int sa, sb;
+    if (!connect_pair(&sa, &sb)) return 0;
+
+    uint8_t out[300], in[300];
+    for (int i = 0; i < 300; i++) out[i] = (uint8_t)(i * 5 + 1);
+    load_a();
+    int ok = squid_send(sa, out, sizeof(out)) == (int)sizeof(out);
+    save_a();
+    uint32_t before = b_tx_bytes;
+    pump(200);
+    load_b();
+    ok = ok && squid_recv(sb, in, sizeof(in)) == (int)sizeof(in);
+    save_b();
+    return (ok && memcmp(in, out, sizeof(out)) == 0) ? b_tx_bytes - before : 0u;
+}
+
+TEST(test_short_acks)
+{
+    uint32_t plain = ack_bytes(0);
+    uint32_t small = ack_bytes(SNET_FEAT_SHORT);
+    ASSERT(plain > 0u && small > 0u, "transfers should complete");
+    ASSERT(small * 4u == plain, "each ACK should shrink from 20 to 5 bytes");
+    return 1;
+}
+
+TEST(test_short_pings_through_feed)
+{
+    setup();
+    load_a(); snet_set_features(SNET_FEAT_SHORT); save_a();
+    load_b(); snet_set_features(SNET_FEAT_SHORT); save_b();
+    pump(20);
+    load_a();
+    ASSERT(snet_features() == SNET_FEAT_SHORT, "A should negotiate SHORT");
+    g_snet.ping_ticks = 2;
+    save_a();
+
+    uint32_t a0 = a_tx_bytes, b0 = b_tx_bytes;
+    pump_feed(40, 3, 0);                /* split across snet_feed calls */
+    ASSERT(a_tx_bytes - a0 >= 5u * SNET_SHORT_BYTES, "A should keep pinging");
+    ASSERT((a_tx_bytes - a0) % SNET_SHORT_BYTES == 0u, "PINGs are short frames");
+    ASSERT(b_tx_bytes - b0 >= 5u * SNET_SHORT_BYTES, "B should answer them");
+    load_a(); ASSERT(snet_link_is_up(), "A link stays up"); save_a();
+    load_b(); ASSERT(snet_link_is_up(), "B link stays up"); save_b();
+    return 1;
+}
+
+/* ================================================================== */
+/*  Tests: non-blocking transmit                                      */
+/* ================================================================== */
+static int a_kicks;
+static void a_tx_ready(void) { a_kicks++; }
+
+/* A sends 300 bytes to B over a UART taking `room` bytes per tick:
+ * through send_char, or with isr set through snet_tx_pull() as a
+ * TX-empty interrupt would.  Returns bytes A put on the wire, 0 when
+ * the data did not arrive intact. */
+static uint32_t slow_transfer(int room, int isr)
+{
+    setup();
+    pump(20);
+    int sa, sb;
+    if (!connect_pair(&sa, &sb)) return 0;
+
+    uint8_t out[300], in[300];
+    for (int i = 0; i < 300; i++) out[i] = (uint8_t)(i * 7 + 3);
+    a_kicks = 0;
+    load_a();
+    if (isr) snet_on_tx_ready(a_tx_ready);
+    int ok = squid_send(sa, out, sizeof(out)) == (int)sizeof(out);
+    save_a();
+
+    uint32_t before = a_tx_bytes;
+    for (int t = 0; t < 600; t++) {
+        if (isr) {
+            load_a();
+            int c;
+            for (int n = 0; n < room && (c = snet_tx_pull()) >= 0; n++)
+                a_send((uint8_t)c);
+            save_a();
+        } else {
+            a_room = room;
+        }
+        pump(1);
+    }
+    a_room = -1;
+
+    load_b();
+    ok = ok && squid_recv(sb, in, sizeof(in)) == (int)sizeof(in);
+    save_b();
+    return (ok && memcmp(in, out, sizeof(out)) == 0) ? a_tx_bytes - before : 0u;
+}
+
+TEST(test_short_writes_resume)
+{
+    uint32_t frames = (300u + SNET_PAY_MAX - 1u) / SNET_PAY_MAX;
+    ASSERT(slow_transfer(7, 0) == frames * SNET_FRAME_BYTES,
+           "partial frames should resume, with no resend");
+    ASSERT(slow_transfer(1, 0) == frames * SNET_FRAME_BYTES,
+           "one byte per tick: timers run from the end of the frame");
+
+    /* a UART that never takes a byte must not stall the link state */
+    int sa, sb;
+    setup();
+    pump(20);
+    ASSERT(connect_pair(&sa, &sb), "connect pair");
+    load_a(); squid_send(sa, (const uint8_t*)"stuck", 5); save_a();
+    a_room = 0;
+    pump(200);
+    a_room = -1;
+    load_a();
+    ASSERT(!snet_link_is_up(), "stuck frames should be dropped and retried");
+    save_a();
+    return 1;
+}
+
+TEST(test_tx_pull_from_interrupt)
+{
+    uint32_t frames = (300u + SNET_PAY_MAX - 1u) / SNET_PAY_MAX;
+    ASSERT(slow_transfer(5, 1) == frames * SNET_FRAME_BYTES,
+           "interrupt-driven transmit should carry every frame once");
+    ASSERT(a_kicks >= (int)frames, "callback once per frame at least");
+    load_a();
+    ASSERT(snet_tx_pull() < 0, "nothing left to pull when idle");
+    snet_on_tx_ready(NULL);
+    save_a();
+    return 1;
+}
+
+/* ================================================================== */
+/*  Tests: adaptive frame size                                        */
+/* ================================================================== */
+#define LONG_BYTES 3000
+
+/* A streams LONG_BYTES to B with SNET_FEAT_LONG offered by A and, when
+ * both is set, by B; chunk > 0 feeds B through snet_feed().  Returns
+ * the wire bytes A used, 0 when the data did not arrive intact. */
+static uint32_t long_transfer(int both, int chunk, uint8_t *pay_max)
+{
+    setup();
+    load_a(); snet_set_features(SNET_FEAT_LONG); save_a();
+    if (both) { load_b(); snet_set_features(SNET_FEAT_LONG); save_b(); }
+    pump(20);
+    int sa, sb;
+    if (!connect_pair(&sa, &sb)) return 0;
+
+    static uint8_t out[LONG_BYTES], in[LONG_BYTES];
+    for (int i = 0; i < LONG_BYTES; i++) out[i] = (uint8_t)(i * 29 + (i >> 7));
+    load_a();
+    int ok = squid_send(sa, out, sizeof(out)) == (int)sizeof(out);
+    save_a();
+
+    uint32_t before = a_tx_bytes;
+    int got = 0;
+    *pay_max = 0;
+    for (int t = 0; t < 1500 && got < LONG_BYTES; t++) {
+        if (chunk) pump_feed(1, chunk, 0);
+        else       pump(1);
+        load_a();
+        if (snet_tx_payload() > *pay_max) *pay_max = snet_tx_payload();
+        save_a();
+        load_b();
+        int r = squid_recv(sb, in + got, (uint16_t)(LONG_BYTES - got));
+        if (r > 0) got += r;
+        save_b();
+    }
+    ok = ok && got == LONG_BYTES && memcmp(in, out, sizeof(out)) == 0;
+    return ok ? a_tx_bytes - before : 0u;
+}
+
+TEST(test_long_frames_grow_on_clean_line)
+{
+    uint8_t pay;
+    uint32_t wire = long_transfer(1, 0, &pay);
+    ASSERT(wire > 0u, "transfer should complete");
+    ASSERT(pay == SNET_CFG_LONG, "payload should grow to the negotiated limit");
+    ASSERT(wire < LONG_BYTES * 12u / 10u, "long frames should cut the overhead");
+
+    uint32_t plain = long_transfer(0, 0, &pay);
+    ASSERT(plain > 0u && pay == SNET_PAY_MAX, "one-sided offer keeps short frames");
+    ASSERT(plain > wire * 12u / 10u, "short frames should cost more wire");
+    return 1;
+}
+
+TEST(test_long_frames_through_feed)
+{
+    uint8_t pay;
+    ASSERT(long_transfer(1, 7, &pay) > 0u, "long frames split at odd offsets");
+    ASSERT(pay == SNET_CFG_LONG, "payload should grow via snet_feed too");
+    return 1;
+}
+
+TEST(test_long_frames_shrink_on_loss)
+{
+    setup();
+    load_a(); snet_set_features(SNET_FEAT_LONG); save_a();
+    load_b(); snet_set_features(SNET_FEAT_LONG); save_b();
+    pump(20);
+    int sa, sb;
+    ASSERT(connect_pair(&sa, &sb), "connect pair");
+
+    static uint8_t out[LONG_BYTES], in[LONG_BYTES];
+    for (int i = 0; i < LONG_BYTES; i++) out[i] = (uint8_t)(i ^ 0x5A);
+    load_a(); squid_send(sa, out, sizeof(out)); save_a();
+
+    int got = 0;
+    uint8_t grown = 0, after = 0;
+    for (int t = 0; t < 2000 && got < LONG_BYTES; t++) {
+        pump(1);
+        load_a();
+        if (!grown && snet_tx_payload() == SNET_CFG_LONG) {
+            grown = 1;
+            a_drop = 3;                 /* damage the next frame */
+        } else if (grown && !after && snet_tx_payload() < SNET_CFG_LONG) {
+            after = snet_tx_payload();
+        }
+        save_a();
+        load_b();
+        int r = squid_recv(sb, in + got, (uint16_t)(LONG_BYTES - got));
+        if (r > 0) got += r;
+        save_b();
+    }
+    ASSERT(grown, "payload should first grow");
+    ASSERT(after == SNET_CFG_LONG / 2, "a resend should halve the payload");
+    ASSERT(got == LONG_BYTES && memcmp(in, out, sizeof(out)) == 0,
+           "stream should arrive intact");
+    return 1;
+}
+
+/* ================================================================== */
+/*  Tests: TX pacing                                                  */
+/* ================================================================== */
+
+TEST(test_pace_negotiated_in_hello)
+{
+    setup();
+    load_a(); snet_set_pace(30, 1); save_a();
+    load_b(); snet_set_pace(8, 0); save_b();
+    ASSERT(ctx_a.tx_rate == 30 && ctx_a.tx_gap == 1, "own setting at once");
+    pump(40);
+    load_a();
+    ASSERT(snet_link_is_up(), "paced link comes up");
+    ASSERT(g_snet.tx_rate == 8 && g_snet.tx_gap == 1, "A: lower rate, longer gap");
+    save_a();
+    load_b();
+    ASSERT(g_snet.tx_rate == 8 && g_snet.tx_gap == 1, "B: the same");
+    snet_set_pace(0, 0);
+    ASSERT(g_snet.tx_rate == 30 && g_snet.tx_gap == 1, "peer's limit still holds");
+    save_b();
+    return 1;
+}
+
+/* A's host sleeps 256 ticks (the 8-bit tick wraps) as soon as
+ * snet_idle() allows; the next frame must still start at once */
+TEST(test_pace_after_long_sleep)
+{
+    setup();
+    load_b(); snet_set_pace(1, 4); save_b();
+    pump(400);
+    int sa, sb;
+    ASSERT(connect_pair(&sa, &sb), "connect pair");
+    load_a(); ASSERT(squid_send(sa, (const uint8_t*)"x", 1) == 1, "send"); save_a();
+
+    int t, idle = 0;
+    for (t = 0; t < 400 && !idle; t++) {
+        pump(1);
+        load_a(); idle = snet_idle(); save_a();
+    }
+    ASSERT(idle, "A settles");
+    load_a();
+    ASSERT(g_snet.pace_credit == (int16_t)g_snet.tx_rate, "bucket full before sleeping");
+    save_a();
+
+    fake_tick = (uint8_t)(fake_tick + 256u);    /* asleep, no bursts */
+    uint32_t before = a_tx_bytes;
+    load_a();
+    ASSERT(squid_send(sa, (const uint8_t*)"y", 1) == 1, "send after sleep");
+    snet_burst();
+    save_a();
+    ASSERT(a_tx_bytes > before, "frame starts right after the sleep");
+    return 1;
+}
+
+/* B asks for pacing; A's host loop spins fast_bursts times a tick and
+ * B's receiver keeps one frame a tick, losing the rest (UART overrun).
+ * Duplex transfer of len bytes each way; returns the ticks it took, 0 if
+ * it failed, with A's busiest tick and its back-to-back ticks. */
+static int paced_transfer(uint8_t rate, uint8_t gap, int len, int fast_bursts,
+                            int *max_tick, int *busy_ticks)
+{
+    setup();
+    load_b(); snet_set_pace(rate, gap); save_b();
+    pump(40);
+    int sa, sb;
+    if (!connect_pair(&sa, &sb)) return 0;
+
+    uint8_t out[400], in_a[400], in_b[400];
+    for (int i = 0; i < len; i++) out[i] = (uint8_t)(i * 5 + 1);
+    load_a(); squid_send(sa, out, (uint16_t)len); save_a();
+    load_b(); squid_send(sb, out, (uint16_t)len); save_b();
+
+    int got_a = 0, got_b = 0, t, last = -2, prev = 0;
+    *max_tick = *busy_ticks = 0;
+    for (t = 1; t < 4000 && (got_a < len || got_b < len); t++) {
+        fake_tick++;
+        uint32_t before = a_tx_bytes;
+        load_a();
+        for (int k = 0; k < fast_bursts; k++) snet_burst();
+        int r = squid_recv(sa, in_a + got_a, (uint16_t)(len - got_a));
+        if (r > 0) got_a += r;
+        save_a();
+
+        int sent = (int)(a_tx_bytes - before);
+        if (sent > *max_tick) *max_tick = sent;
+        if (sent && last == t - 1 && prev) (*busy_ticks)++;
+        if (sent) last = t;
+        prev = sent;
+        uint16_t queued = (uint16_t)((wire_a2b.head + RING_SIZE - wire_a2b.tail) % RING_SIZE);
+        if (queued > SNET_FRAME_BYTES)   /* overrun: only one frame fits */
+            wire_a2b.head = (uint16_t)((wire_a2b.tail + SNET_FRAME_BYTES) % RING_SIZE);
+
+        load_b();
+        snet_burst();
+        r = squid_recv(sb, in_b + got_b, (uint16_t)(len - got_b));
+        if (r > 0) got_b += r;
+        save_b();
+    }
+    if (memcmp(in_a, out, (size_t)got_a) || memcmp(in_b, out, (size_t)got_b)) return 0;
+    return (got_a == len && got_b == len) ? t : 0;
+}
+
+TEST(test_pace_spreads_frames)
+{
+    int max_tick, busy;
+    int t = paced_transfer(20, 2, 200, 4, &max_tick, &busy);
+    ASSERT(t > 0, "paced transfer completes");
+    ASSERT(max_tick <= SNET_FRAME_BYTES, "at most one frame a tick");
+    ASSERT(busy == 0, "gap: never frames in two ticks in a row");
+    return 1;
+}
+
+/* ================================================================== */
+/*  Tests: streams                                                    */
+/* ================================================================== */
+#define FILE_BYTES 3000
+static uint8_t file_src[FILE_BYTES], file_dst[FILE_BYTES];
+
+static int mem_read(void *ctx, uint32_t off, uint8_t *buf, uint16_t max)
+{
+    (void)ctx;
+    memcpy(buf, file_src + off, max);
+    return max;
+}
+
+static int mem_write(void *ctx, uint32_t off, const uint8_t *buf, uint16_t len)
+{
+    (void)ctx;
+    if (off + len > FILE_BYTES) return -1;
+    memcpy(file_dst + off, buf, len);
+    return 0;
+}
+
+static void file_reset(void)
+{
+    for (int i = 0; i < FILE_BYTES; i++) file_src[i] = (uint8_t)(i * 31 + i / 256);
+    memset(file_dst, 0, sizeof(file_dst));
+}
+
+/* pump until A's stream is acked to the end (or ticks run out) */
+static int stream_done(int sa, int ticks)
+{
+    for (int t = 0; t < ticks; t++) {
+        pump(1);
+        load_a();
+        int r = squid_stream_pos(sa, NULL, NULL);
+        save_a();
+        if (r <= 0) return r == 0;
+    }
+    return 0;
+}
+
+TEST(test_stream_constant_memory)
+{
+    setup();
+    pump(20);
+    int sa, sb;
+    ASSERT(connect_pair(&sa, &sb), "connect pair");
+    file_reset();
+
+    load_a();
+    int live = a_live;
+    ASSERT(squid_stream_send(sa, mem_read, NULL, 0, FILE_BYTES) == 0, "source");
+    save_a();
+    load_b();
+    ASSERT(squid_stream_recv(sb, mem_write, NULL, 0) == 0, "sink");
+    save_b();
+
+    int peak = 0;
+    for (int t = 0; t < 1000; t++) {
+        pump(1);
+        if (a_live - live > peak) peak = a_live - live;
+        load_a();
+        int r = squid_stream_pos(sa, NULL, NULL);
+        save_a();
+        if (r == 0) break;
+    }
+    ASSERT(peak == 0, "streaming should not allocate");
+
+    uint32_t acked, written;
+    load_a(); squid_stream_pos(sa, &acked, NULL); save_a();
+    load_b();
+    squid_stream_pos(sb, NULL, &written);
+    ASSERT(g_snet.chan_head->rx_bytes == 0, "sink bypasses the RX queue");
+    save_b();
+    ASSERT(acked == FILE_BYTES && written == FILE_BYTES, "all bytes delivered");
+    ASSERT(memcmp(file_src, file_dst, FILE_BYTES) == 0, "file should match");
+    return 1;
+}
+
+TEST(test_stream_after_queue)
+{
+    setup();
+    pump(20);
+    int sa, sb;
+    ASSERT(connect_pair(&sa, &sb), "connect pair");
+    file_reset();
+
+    /* a header sent the normal way goes out before the stream */
+    load_a();
+    squid_send(sa, (const uint8_t*)"HDR", 3);
+    squid_stream_send(sa, mem_read, NULL, 0, 40);
+    save_a();
+    ASSERT(stream_done(sa, 200), "stream should finish");
+
+    uint8_t buf[64];
+    load_b();
+    ASSERT(squid_recv(sb, buf, sizeof(buf)) == 43, "header + stream queued");
+    ASSERT(memcmp(buf, "HDR", 3) == 0, "header first");
+    ASSERT(memcmp(buf + 3, file_src, 40) == 0, "then the stream");
+    save_b();
+    return 1;
+}
+
+static int bad_read(void *ctx, uint32_t off, uint8_t *buf, uint16_t max)
+{
+    (void)ctx; (void)off; (void)buf; (void)max;
+    return -1;
+}
+
+/* a failing source packed behind queued sockets: the records after it
+ * still arrive, and a lone failing source sends no empty DATA frame */
+TEST(test_failing_source_in_pack)
+{
+    setup();
+    load_a(); snet_set_features(SNET_FEAT_PACK); save_a();
+    load_b(); snet_set_features(SNET_FEAT_PACK); save_b();
+    pump(20);
+
+    int sa[4], sb[4];
+    load_a();
+    for (int i = 0; i < 4; i++) {
+        sa[i] = squid_open();
+        ASSERT(squid_connect(sa[i], (uint8_t)(i + 1)) == 0, "A connect");
+    }
+    save_a();
+    load_b();
+    for (int i = 0; i < 4; i++) {
+        sb[i] = squid_open();
+        ASSERT(squid_bind(sb[i], (uint8_t)(i + 1)) == 0, "B bind");
+    }
+    save_b();
+
+    load_a();
+    ASSERT(squid_stream_send(sa[1], bad_read, NULL, 0, 40) == 0, "source");
+    for (int i = 0; i < 4; i++) {
+        uint8_t msg[2] = { (uint8_t)(0x10 * (i + 1)), (uint8_t)i };
+        if (i != 1) ASSERT(squid_send(sa[i], msg, 2) == 2, "send should queue");
+    }
+    save_a();
+    pump(40);
+
+    load_a();
+    ASSERT(squid_stream_pos(sa[1], NULL, NULL) == -1, "source reports its error");
+    save_a();
+    load_b();
+    for (int i = 0; i < 4; i++) {
+        if (i == 1) continue;
+        uint8_t buf[8];
+        ASSERT(squid_recv(sb[i], buf, sizeof(buf)) == 2,
+               "records behind the failed source should arrive");
+        ASSERT(buf[0] == (uint8_t)(0x10 * (i + 1)), "on their own channel");
+    }
+    save_b();
+
+    load_a();
+    ASSERT(squid_stream_send(sa[2], bad_read, NULL, 0, 40) == 0, "lone source");
+    save_a();
+    uint32_t before = a_tx_bytes;
+    pump(20);
+    ASSERT(a_tx_bytes == before, "a failed pull sends nothing");
+    return 1;
+}
+
+TEST(test_stream_resume_after_restart)
+{
+    setup();
+    pump(20);
+    int sa, sb;
+    ASSERT(connect_pair(&sa, &sb), "connect pair");
+    file_reset();
+
+    load_a(); squid_stream_send(sa, mem_read, NULL, 0, FILE_BYTES); save_a();
+    load_b(); squid_stream_recv(sb, mem_write, NULL, 0); save_b();
+    pump(100);
+
+    /* receiver restarts mid-transfer; its file keeps what was written */
+    uint32_t acked, written;
+    load_a(); squid_stream_pos(sa, &acked, NULL); save_a();
+    load_b(); squid_stream_pos(sb, NULL, &written); save_b();
+    ASSERT(written > 0 && written < FILE_BYTES, "transfer should be midway");
+    ASSERT(acked <= written && written - acked <= SNET_PAY_MAX,
+           "acked trails written by at most one frame");
+
+    load_b(); snet_init(&plat_b, NULL); save_b();
+    pump(40);
+    load_a();
+    ASSERT(snet_link_is_up(), "link should come back");
+    ASSERT(squid_stream_pos(sa, NULL, NULL) == -1, "new session stops the source");
+    save_a();
+
+    /* both ends restart from the receiver's offset */
+    load_b();
+    sb = squid_open(); squid_bind(sb, 1);
+    squid_stream_recv(sb, mem_write, NULL, written);
+    save_b();
+    load_a(); squid_stream_send(sa, mem_read, NULL, written, FILE_BYTES); save_a();
+    ASSERT(stream_done(sa, 1000), "resumed stream should finish");
+    ASSERT(memcmp(file_src, file_dst, FILE_BYTES) == 0, "file should match");
+    return 1;
+}
+
+/* ================================================================== */
+/*  Tests: RPC                                                        */
+/* ================================================================== */
+static squid_rpc_t rpc_a, rpc_b;
+static uint16_t rpc_held[8];            /* requests B answers later */
+static int rpc_nheld;
+static int rpc_order[16], rpc_status[16], rpc_ndone;
+static uint8_t rpc_data[16][4];
+
+/* method 1: answer now with the payload reversed; method 2: later */
+static void rpc_server(squid_rpc_t *r, uint16_t id, uint8_t method,
+                       const uint8_t *data, uint16_t len, void *arg)
+{
+    (void)arg;
+    if (method == 2u) { rpc_held[rpc_nheld++] = id; return; }
+    uint8_t out[4];
+    for (uint16_t i = 0; i < len && i < 4u; i++) out[i] = data[len - 1u - i];
+    squid_rpc_reply(r, id, SQUID_RPC_ST_OK, out, len);
+}
+
+/* arg is the call's index */
+static void rpc_done(squid_rpc_t *r, uint16_t id, int status,
+                     const uint8_t *data, uint16_t len, void *arg)
+{
+    (void)r; (void)id;
+    int k = (int)(intptr_t)arg;
+    rpc_order[rpc_ndone++] = k;
+    rpc_status[k] = status;
+    memset(rpc_data[k], 0, 4);
+    if (data) memcpy(rpc_data[k], data, len < 4u ? len : 4u);
+}
+
+static void rpc_setup(int serve)
+{
+    int sa, sb;
+    setup();
+    pump(20);
+    connect_pair(&sa, &sb);
+    squid_rpc_init(&rpc_a, sa);
+    squid_rpc_init(&rpc_b, sb);
+    if (serve) squid_rpc_serve(&rpc_b, rpc_server, NULL);
+    rpc_nheld = rpc_ndone = 0;
+}
+
+/* one tick: both engines, then both RPC ends; returns A's calls in flight */
+static int rpc_pump(uint32_t now)
+{
+    pump(1);
+    load_b(); squid_rpc_poll(&rpc_b, now); save_b();
+    load_a(); int busy = squid_rpc_poll(&rpc_a, now); save_a();
+    return busy;
+}
+
+TEST(test_rpc_pipelined_out_of_order)
+{
+    rpc_setup(1);
+
+    /* fill every slot before anything is answered */
+    load_a();
+    for (int k = 0; k < SNET_CFG_RPC_SLOTS; k++) {
+        uint8_t req[2] = { (uint8_t)k, (uint8_t)(k + 100) };
+        uint8_t method = (k & 1) ? 2u : 1u;
+        ASSERT(squid_rpc_call(&rpc_a, method, req, 2, 0, 0, rpc_done,
+                              (void*)(intptr_t)k) > 0, "call should queue");
+    }
+    ASSERT(squid_rpc_call(&rpc_a, 1, NULL, 0, 0, 0, rpc_done, NULL) == -1,
+           "no slot left");
+    save_a();
+
+    uint32_t t;
+    for (t = 1; t < 200 && rpc_ndone < SNET_CFG_RPC_SLOTS / 2; t++) rpc_pump(t);
+    ASSERT(rpc_ndone == SNET_CFG_RPC_SLOTS / 2, "immediate answers arrive first");
+    ASSERT(rpc_nheld == SNET_CFG_RPC_SLOTS / 2, "held requests reached B");
+
+    /* answer the held ones newest first */
+    load_b();
+    for (int i = rpc_nheld - 1; i >= 0; i--)
+        squid_rpc_reply(&rpc_b, rpc_held[i], 7, (const uint8_t*)"ok", 2);
+    save_b();
+    int busy = 1;
+    for (; t < 400 && busy; t++) busy = rpc_pump(t);
+    ASSERT(!busy && rpc_ndone == SNET_CFG_RPC_SLOTS, "every call completes");
+
+    for (int k = 0; k < SNET_CFG_RPC_SLOTS; k++) {
+        if (k & 1) {
+            ASSERT(rpc_status[k] == 7 && rpc_data[k][0] == 'o', "held answer");
+        } else {
+            ASSERT(rpc_status[k] == SQUID_RPC_ST_OK, "immediate answer");
+            ASSERT(rpc_data[k][0] == (uint8_t)(k + 100) && rpc_data[k][1] == (uint8_t)k,
+                   "payload reversed by the server");
+        }
+    }
+    ASSERT(rpc_order[SNET_CFG_RPC_SLOTS / 2] == SNET_CFG_RPC_SLOTS - 1,
+           "held calls complete in the order B answered them");
+    return 1;
+}
+
+TEST(test_rpc_timeout_and_nomethod)
+{
+    rpc_setup(0);
+    load_a();
+    ASSERT(squid_rpc_call(&rpc_a, 9, NULL, 0, 0, 0, rpc_done, (void*)0) > 0, "call");
+    save_a();
+    for (uint32_t t = 1; t < 50 && !rpc_ndone; t++) rpc_pump(t);
+    ASSERT(rpc_ndone == 1 && rpc_status[0] == SQUID_RPC_ST_NOMETHOD,
+           "no server: NOMETHOD");
+
+    /* held forever: the deadline completes it, the late answer is dropped */
+    rpc_setup(1);
+    load_a();
+    ASSERT(squid_rpc_call(&rpc_a, 2, NULL, 0, 100, 30, rpc_done, (void*)1) > 0, "call");
+    save_a();
+    uint32_t t = 100;
+    while (t < 129) ASSERT(rpc_pump(++t) == 1, "in flight until the deadline");
+    ASSERT(rpc_ndone == 0 && rpc_nheld == 1, "held, not answered");
+    ASSERT(rpc_pump(++t) == 0 && rpc_ndone == 1, "expired at the deadline");
+    ASSERT(rpc_status[1] == SQUID_RPC_TIMEOUT, "timeout status");
+    load_b(); squid_rpc_reply(&rpc_b, rpc_held[0], 0, NULL, 0); save_b();
+    for (int i = 0; i < 20; i++) rpc_pump(++t);
+    ASSERT(rpc_ndone == 1, "late answer ignored");
+    return 1;
+}
+
+/* ================================================================== */
+/*  Tests: engine instances                                           */
+/* ================================================================== */
+
+TEST(test_engine_instances)
+{
+    setup();                            /* built-in context holds B */
+    squid_timing_t tm = { .timeout_ticks = 3, .ack_delay_ticks = 1,
+                          .ping_ticks = 0, .max_retries = 5 };
+    squid_engine_t *ea = calloc(1, snet_engine_size());
+    squid_engine_t *eb = calloc(1, snet_engine_size());
+
+    snet_engine_use(ea);
+    snet_init(&plat_a, &tm);
+    snet_engine_use(eb);
+    snet_init(&plat_b, &tm);
+    ASSERT(snet_engine_current() == eb, "eb should be current");
+
+    for (int t = 0; t < 20; t++) {
+        fake_tick++;
+        snet_engine_use(ea); snet_burst();
+        snet_engine_use(eb); snet_burst();
+    }
+
+    snet_engine_use(ea);
+    ASSERT(snet_link_is_up(), "engine A should be up");
+    int sa = squid_open();
+    ASSERT(squid_connect(sa, 1) == 0, "A connect ch1");
+    ASSERT(squid_send(sa, (const uint8_t*)"two engines", 11) == 11, "A send");
+    snet_engine_use(eb);
+    int sb = squid_open();
+    ASSERT(squid_bind(sb, 1) == 0, "B bind ch1");
+
+    for (int t = 0; t < 60; t++) {
+        fake_tick++;
+        snet_engine_use(ea); snet_burst();
+        snet_engine_use(eb); snet_burst();
+    }
+
+    uint8_t buf[16];
+    ASSERT(squid_recv(sb, buf, sizeof(buf)) == 11, "B should get 11 bytes");
+    ASSERT(memcmp(buf, "two engines", 11) == 0, "payload should match");
+
+    snet_engine_use(NULL);
+    ASSERT(snet_engine_current() == NULL, "built-in should be current");
+    ASSERT(g_snet.plat == &plat_b && !snet_link_is_up(),
+           "built-in context should be untouched");
+
+    snet_engine_use(ea); snet_init(NULL, NULL);     /* frees channels */
+    snet_engine_use(eb); snet_init(NULL, NULL);
+    snet_engine_use(NULL);
+    free(ea);
+    free(eb);
+    return 1;
+}
+
 /* ================================================================== */
 int main(void)
 {
@@ -431,6 +2430,70 @@ int main(void)
     RUN(test_bidirectional);
     RUN(test_large_transfer);
     RUN(test_two_sockets_isolated);
+    RUN(test_sendv_recvv);
+    RUN(test_idle_tracks_timers);
+    RUN(test_recvv_segments_sum_past_64k);
+    RUN(test_sendv_atomic_cap);
+    RUN(test_packed_frames);
+    RUN(test_pack_needs_both_peers);
+    RUN(test_extended_channels);
+    RUN(test_extended_channels_packed);
+    RUN(test_extended_channels_need_both_peers);
+    RUN(test_full_duplex_throughput);
+    RUN(test_duplex_lost_frame);
+    RUN(test_acks_from_unstamping_peer);
+    RUN(test_resume_after_cut);
+    RUN(test_resume_lost_ack);
+    RUN(test_no_resume_after_peer_restart);
+    RUN(test_lost_hello_ack_answered_again);
+    RUN(test_rx_cap_backpressure);
+    RUN(test_sockopt_get_set);
+    RUN(test_send_would_block_then_writable);
+    RUN(test_memory_budget);
+    RUN(test_subscribe_fan_out);
+    RUN(test_subscribe_join_leave_and_pacing);
+    RUN(test_confirmed_send);
+    RUN(test_confirmed_lost_on_new_session);
+    RUN(test_confirmed_lost_twice);
+
+    /* bonded links */
+    RUN(test_bond_spreads_frames);
+    RUN(test_bond_survives_member_failure);
+    RUN(test_bond_reorders);
+    RUN(test_bond_resumes_cut_envelope);
+    RUN(test_bond_scoped_to_its_engine);
+
+    /* buffered receive */
+    RUN(test_feed_whole_buffers);
+    RUN(test_feed_split_frames);
+    RUN(test_feed_resyncs_after_noise);
+    RUN(test_fec_repairs_without_resend);
+    RUN(test_fec_resends_past_two_bytes);
+    RUN(test_short_acks);
+    RUN(test_short_pings_through_feed);
+    RUN(test_short_writes_resume);
+    RUN(test_tx_pull_from_interrupt);
+    RUN(test_long_frames_grow_on_clean_line);
+    RUN(test_long_frames_through_feed);
+    RUN(test_long_frames_shrink_on_loss);
+
+    /* TX pacing */
+    RUN(test_pace_negotiated_in_hello);
+    RUN(test_pace_after_long_sleep);
+    RUN(test_pace_spreads_frames);
+
+    /* streams */
+    RUN(test_stream_constant_memory);
+    RUN(test_stream_after_queue);
+    RUN(test_stream_resume_after_restart);
+    RUN(test_failing_source_in_pack);
+
+    /* RPC */
+    RUN(test_rpc_pipelined_out_of_order);
+    RUN(test_rpc_timeout_and_nomethod);
+
+    /* engine instances */
+    RUN(test_engine_instances);
 
     printf("===================\n");
     printf("%d/%d tests passed\n", tests_passed, tests_run);
@@ -0,0 +1,345 @@
+/* tests/test_tiny.c – loopback test for the squid_tiny profile.
+ *
+ * Same back-to-back setup as test_squid.c, built against the 8-bit
+ * configuration: static queues (no malloc/free hooks), two sockets,
+ * SNET_CFG_QUEUE_BYTES rings, no keepalive sender, list-order TX and
+ * the interrupt RX ring.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "squid/snet.h"
+#include "squid/socket.h"
+#include "squid/internal.h"   /* access g_snet for swapping contexts */
+
+#if !SNET_CFG_STATIC || SNET_CFG_CHANNELS != 2
+#error "test_tiny.c expects the squid_tiny profile"
+#endif
+
+/* ================================================================== */
+/*  Simulated wire: two ring buffers (A→B and B→A)                    */
+/* ================================================================== */
+#define RING_SIZE 1024
+
+typedef struct {
+    uint8_t buf[RING_SIZE];
+    uint16_t head, tail;
+} ring_t;
+
+static ring_t wire_a2b, wire_b2a;
+static uint8_t fake_tick = 0;
+
+static int ring_put(ring_t *r, uint8_t c)
+{
+    uint16_t next = (uint16_t)((r->head + 1) % RING_SIZE);
+    if (next == r->tail) return -1;
+    r->buf[r->head] = c;
+    r->head = next;
+    return 0;
+}
+
+static int ring_get(ring_t *r)
+{
+    if (r->head == r->tail) return -1;
+    uint8_t c = r->buf[r->tail];
+    r->tail = (uint16_t)((r->tail + 1) % RING_SIZE);
+    return c;
+}
+
+static int a_send(uint8_t c) { return ring_put(&wire_a2b, c); }
+static int a_recv(void)      { return ring_get(&wire_b2a); }
+static int b_send(uint8_t c) { return ring_put(&wire_b2a, c); }
+static int b_recv(void)      { return ring_get(&wire_a2b); }
+static uint8_t tick(void)    { return fake_tick; }
+
+/* no allocator at all */
+static const squid_platform_t plat_a = { a_send, a_recv, tick, NULL, NULL };
+static const squid_platform_t plat_b = { b_send, b_recv, tick, NULL, NULL };
+/* B receiving only through its interrupt ring */
+static const squid_platform_t plat_b_isr = { b_send, NULL, tick, NULL, NULL };
+
+static snet_ctx_t ctx_a, ctx_b;
+
+static void load_a(void) { g_snet = ctx_a; }
+static void load_b(void) { g_snet = ctx_b; }
+static void save_a(void) { ctx_a = g_snet; }
+static void save_b(void) { ctx_b = g_snet; }
+
+static void pump(int ticks)
+{
+    for (int t = 0; t < ticks; t++) {
+        fake_tick++;
+        load_a(); snet_burst(); save_a();
+        load_b(); snet_burst(); save_b();
+    }
+}
+
+/* ================================================================== */
+/*  Test infrastructure                                               */
+/* ================================================================== */
+static int tests_run = 0, tests_passed = 0;
+
+#define TEST(name) static int name(void)
+#define ASSERT(cond, msg) do { \
+    if (!(cond)) { \
+        printf("  FAIL: %s (line %d): %s\n", __func__, __LINE__, msg); \
+        return 0; \
+    } \
+} while(0)
+#define RUN(fn) do { \
+    tests_run++; \
+    printf("  %-40s ", #fn); \
+    if (fn()) { tests_passed++; printf("OK\n"); } \
+    else printf("\n"); \
+} while(0)
+
+static void setup(void)
+{
+    wire_a2b.head = wire_a2b.tail = 0;
+    wire_b2a.head = wire_b2a.tail = 0;
+    fake_tick = 0;
+    memset(&g_snet, 0, sizeof(g_snet));
+
+    squid_timing_t tm = { .timeout_ticks = 3, .ack_delay_ticks = 1,
+                          .ping_ticks = 0, .max_retries = 5 };
+    snet_init(&plat_a, &tm);
+    save_a();
+    snet_init(&plat_b, &tm);
+    save_b();
+}
+
+/* one socket per side on channel 1, link up */
+static void connect_pair(int *sa, int *sb)
+{
+    setup();
+    pump(20);
+    load_a(); *sa = squid_open(); squid_connect(*sa, 1); save_a();
+    load_b(); *sb = squid_open(); squid_bind(*sb, 1);    save_b();
+}
+
+/* ================================================================== */
+/*  Tests                                                             */
+/* ================================================================== */
+
+TEST(test_no_allocator_handshake)
+{
+    setup();
+    load_a();
+    ASSERT(g_snet.eng == SNET_ENG_STARTUP, "NULL malloc/free should be accepted");
+    save_a();
+    pump(20);
+    load_a(); ASSERT(snet_link_is_up(), "A should be up"); save_a();
+    load_b(); ASSERT(snet_link_is_up(), "B should be up"); save_b();
+    return 1;
+}
+
+TEST(test_socket_pool_limit)
+{
+    setup();
+    load_a();
+    int f1 = squid_open(), f2 = squid_open();
+    ASSERT(f1 == 1 && f2 == 2, "two sockets from the pool");
+    ASSERT(squid_open() == -1, "third socket should fail");
+    squid_close(f1);
+    ASSERT(squid_open() == 1, "closed slot should be reused");
+    save_a();
+    return 1;
+}
+
+TEST(test_tx_ring_all_or_nothing)
+{
+    int sa, sb;
+    connect_pair(&sa, &sb);
+
+    load_a();
+    uint8_t big[SNET_CFG_QUEUE_BYTES + 1];
+    memset(big, 0x5A, sizeof(big));
+    ASSERT(squid_send(sa, big, sizeof(big)) == -1, "over-ring send rejected");
+    ASSERT(squid_send(sa, big, SNET_CFG_QUEUE_BYTES) == SNET_CFG_QUEUE_BYTES,
+           "full-ring send accepted");
+    ASSERT(squid_send(sa, big, 1) == SQUID_EAGAIN, "full ring: would block");
+    save_a();
+    return 1;
+}
+
+TEST(test_stream_through_rings)
+{
+    int sa, sb;
+    connect_pair(&sa, &sb);
+
+    /* 400 bytes through 48-byte rings; B reads slowly so its RX ring
+       fills and the engine holds the sender off with busy ACKs */
+    uint8_t out[400], in[400];
+    for (int i = 0; i < 400; i++) out[i] = (uint8_t)(i * 13 + 1);
+    int sent = 0, got = 0;
+    for (int t = 0; t < 4000 && got < 400; t++) {
+        load_a();
+        while (sent < 400) {
+            int n = 400 - sent > 20 ? 20 : 400 - sent;
+            if (squid_send(sa, out + sent, (uint16_t)n) != n) break;
+            sent += n;
+        }
+        save_a();
+        pump(1);
+        if (t % 8 == 0) {
+            load_b();
+            ASSERT(g_snet.chan_head->rx_bytes <= SNET_CFG_QUEUE_BYTES,
+                   "RX ring bound");
+            int n = squid_recv(sb, in + got, 16);
+            if (n > 0) got += n;
+            save_b();
+        }
+    }
+    ASSERT(got == 400, "all bytes should arrive");
+    ASSERT(memcmp(in, out, 400) == 0, "stream should be intact and ordered");
+    return 1;
+}
+
+TEST(test_list_order_scheduling)
+{
+    setup();
+    pump(20);
+    load_a();
+    int s1 = squid_open(); squid_connect(s1, 1);
+    int s2 = squid_open(); squid_connect(s2, 2);
+    squid_send(s1, (const uint8_t*)"1111111111111111", 16);
+    squid_send(s2, (const uint8_t*)"2", 1);
+    save_a();
+    load_b();
+    int r1 = squid_open(); squid_bind(r1, 1);
+    int r2 = squid_open(); squid_bind(r2, 2);
+    save_b();
+
+    /* newest socket (s2) is served first, then s1 */
+    uint8_t buf[20];
+    int n1 = 0, n2 = 0;
+    for (int t = 0; t < 40 && !n2; t++) {
+        pump(1);
+        load_b();
+        n1 = g_snet.chan_pool[r1 - 1].rx_bytes;
+        n2 = g_snet.chan_pool[r2 - 1].rx_bytes;
+        save_b();
+    }
+    ASSERT(n2 == 1 && n1 == 0, "ch2 should arrive before ch1");
+    pump(40);
+    load_b();
+    ASSERT(squid_recv(r2, buf, sizeof(buf)) == 1, "ch2 delivered");
+    ASSERT(squid_recv(r1, buf, sizeof(buf)) == 16, "ch1 delivered");
+    save_b();
+    return 1;
+}
+
+TEST(test_subscribe_copies_per_ring)
+{
+    setup();
+    pump(20);
+    load_a();
+    int sa = squid_open(); squid_connect(sa, 3);
+    squid_send(sa, (const uint8_t*)"telemetry", 9);
+    save_a();
+    load_b();
+    int r1 = squid_open(), r2 = squid_open();
+    ASSERT(squid_subscribe(r1, 3) == 0 && squid_subscribe(r2, 3) == 0,
+           "two subscribers");
+    save_b();
+    pump(40);
+
+    /* no shared storage here: each ring holds its own copy */
+    uint8_t b1[16], b2[16];
+    load_b();
+    ASSERT(squid_mem_used() == 18u, "one copy per subscriber ring");
+    ASSERT(squid_recv(r1, b1, sizeof(b1)) == 9 &&
+           squid_recv(r2, b2, sizeof(b2)) == 9, "both receive");
+    ASSERT(memcmp(b1, "telemetry", 9) == 0 && memcmp(b2, b1, 9) == 0,
+           "same payload");
+    save_b();
+    return 1;
+}
+
+/* "UART interrupt": move up to n bytes of A's output into B's ring;
+   returns bytes that did not fit (overrun) */
+static int isr_deliver(int n)
+{
+    int lost = 0, c;
+    load_b();
+    while (n-- > 0 && (c = ring_get(&wire_a2b)) >= 0)
+        if (snet_rx_isr_push((uint8_t)c) != 0) lost++;
+    save_b();
+    return lost;
+}
+
+TEST(test_isr_ring_receive)
+{
+    setup();
+    squid_timing_t tm = { .timeout_ticks = 3, .ack_delay_ticks = 1,
+                          .ping_ticks = 0, .max_retries = 5 };
+    load_b();
+    snet_init(&plat_b_isr, &tm);
+    ASSERT(g_snet.eng == SNET_ENG_STARTUP, "NULL recv_char with the ring");
+    save_b();
+
+    /* B's main loop runs every other tick; 20 bytes arrive per tick */
+    int lost = 0;
+    for (int t = 0; t < 40; t++) {
+        fake_tick++;
+        load_a(); snet_burst(); save_a();
+        lost += isr_deliver(20);
+        if (t & 1) { load_b(); snet_burst(); save_b(); }
+    }
+    load_a(); ASSERT(snet_link_is_up(), "A should be up"); save_a();
+
+    load_a();
+    int sa = squid_open(); squid_connect(sa, 1);
+    ASSERT(squid_send(sa, (const uint8_t*)"interrupt-fed", 13) == 13, "send");
+    save_a();
+    load_b(); int sb = squid_open(); squid_bind(sb, 1); save_b();
+    for (int t = 0; t < 60; t++) {
+        fake_tick++;
+        load_a(); snet_burst(); save_a();
+        lost += isr_deliver(20);
+        load_b(); snet_burst(); save_b();
+    }
+    uint8_t buf[16];
+    load_b();
+    ASSERT(squid_recv(sb, buf, sizeof(buf)) == 13, "B should get 13 bytes");
+    ASSERT(memcmp(buf, "interrupt-fed", 13) == 0, "payload should match");
+    save_b();
+    ASSERT(lost == 0, "the ring should absorb a skipped burst");
+    return 1;
+}
+
+TEST(test_isr_ring_full)
+{
+    setup();
+    load_b();
+    for (int i = 0; i < SNET_CFG_ISR_RING; i++)
+        ASSERT(snet_rx_isr_push(0x00) == 0, "push into free space");
+    ASSERT(snet_rx_isr_push(0x00) == -1, "full ring refuses");
+    snet_burst();                       /* drains the noise */
+    ASSERT(snet_rx_isr_push(0x7E) == 0, "drained ring takes bytes again");
+    save_b();
+    return 1;
+}
+
+/* ================================================================== */
+int main(void)
+{
+    printf("libsquid tiny-profile test suite\n");
+    printf("================================\n");
+
+    RUN(test_no_allocator_handshake);
+    RUN(test_socket_pool_limit);
+    RUN(test_tx_ring_all_or_nothing);
+    RUN(test_stream_through_rings);
+    RUN(test_list_order_scheduling);
+    RUN(test_subscribe_copies_per_ring);
+    RUN(test_isr_ring_receive);
+    RUN(test_isr_ring_full);
+
+    printf("================================\n");
+    printf("%d/%d tests passed\n", tests_passed, tests_run);
+
+    return (tests_passed == tests_run) ? 0 : 1;
+}